@@ -0,0 +1,160 @@
+#ifndef GABBY_CHAT_COMPLETIONS_H_
+#define GABBY_CHAT_COMPLETIONS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "json/bind.h"
+
+// the requests and responses of the chat completions api, in the same
+// format as openai's, bound to json. see json/bind.h.
+
+namespace gabby {
+
+struct ChatMessage {
+    std::string role;
+    std::string content;
+
+    static constexpr std::tuple kJsonFields = {
+        json::Field{"role", &ChatMessage::role},
+        json::Field{"content", &ChatMessage::content},
+    };
+};
+
+struct ChatCompletionRequest {
+    std::string model;
+    std::vector<ChatMessage> messages;
+    bool stream = false;
+
+    static constexpr std::tuple kJsonFields = {
+        json::Field{"model", &ChatCompletionRequest::model},
+        json::Field{"messages", &ChatCompletionRequest::messages},
+        json::Field{"stream", &ChatCompletionRequest::stream},
+    };
+};
+
+struct CompletionTokensDetails {
+    int reasoning_tokens = 0;
+    int accepted_prediction_tokens = 0;
+    int rejected_prediction_tokens = 0;
+
+    static constexpr std::tuple kJsonFields = {
+        json::Field{"reasoning_tokens",
+                    &CompletionTokensDetails::reasoning_tokens},
+        json::Field{"accepted_prediction_tokens",
+                    &CompletionTokensDetails::accepted_prediction_tokens},
+        json::Field{"rejected_prediction_tokens",
+                    &CompletionTokensDetails::rejected_prediction_tokens},
+    };
+};
+
+struct Usage {
+    int prompt_tokens = 0;
+    int completion_tokens = 0;
+    int total_tokens = 0;
+    CompletionTokensDetails completion_tokens_details;
+
+    static constexpr std::tuple kJsonFields = {
+        json::Field{"prompt_tokens", &Usage::prompt_tokens},
+        json::Field{"completion_tokens", &Usage::completion_tokens},
+        json::Field{"total_tokens", &Usage::total_tokens},
+        json::Field{"completion_tokens_details",
+                    &Usage::completion_tokens_details},
+    };
+};
+
+struct ChatCompletionChoice {
+    int index = 0;
+    std::nullptr_t logprobs = nullptr;
+    std::string_view finish_reason = "stop";
+    ChatMessage message;
+
+    static constexpr std::tuple kJsonFields = {
+        json::Field{"index", &ChatCompletionChoice::index},
+        json::Field{"logprobs", &ChatCompletionChoice::logprobs},
+        json::Field{"finish_reason", &ChatCompletionChoice::finish_reason},
+        json::Field{"message", &ChatCompletionChoice::message},
+    };
+};
+
+// the id, times and counts are placeholders until the generator
+// reports them
+struct ChatCompletionResponse {
+    std::string_view id = "gabby-completion-123";
+    std::string_view object = "chat.completion";
+    int64_t created = 1111111111;
+    std::string_view model = "gabby-model";
+    std::string_view system_fingerprint = "fp_1111111111";
+    std::vector<ChatCompletionChoice> choices;
+    Usage usage = {
+        .prompt_tokens = 1,
+        .completion_tokens = 1,
+        .total_tokens = 1,
+        .completion_tokens_details = {.reasoning_tokens = 1},
+    };
+
+    static constexpr std::tuple kJsonFields = {
+        json::Field{"id", &ChatCompletionResponse::id},
+        json::Field{"object", &ChatCompletionResponse::object},
+        json::Field{"created", &ChatCompletionResponse::created},
+        json::Field{"model", &ChatCompletionResponse::model},
+        json::Field{"system_fingerprint",
+                    &ChatCompletionResponse::system_fingerprint},
+        json::Field{"choices", &ChatCompletionResponse::choices},
+        json::Field{"usage", &ChatCompletionResponse::usage},
+    };
+};
+
+// what a chunk adds to the message being streamed
+struct ChatDelta {
+    std::optional<std::string_view> role;
+    std::optional<std::string_view> content;
+
+    static constexpr std::tuple kJsonFields = {
+        json::Field{"role", &ChatDelta::role, json::IfEmpty::OMIT},
+        json::Field{"content", &ChatDelta::content, json::IfEmpty::OMIT},
+    };
+};
+
+struct ChatCompletionChunkChoice {
+    int index = 0;
+    std::nullptr_t logprobs = nullptr;
+    std::optional<std::string_view> finish_reason;
+    ChatDelta delta;
+
+    static constexpr std::tuple kJsonFields = {
+        json::Field{"index", &ChatCompletionChunkChoice::index},
+        json::Field{"logprobs", &ChatCompletionChunkChoice::logprobs},
+        json::Field{"finish_reason",
+                    &ChatCompletionChunkChoice::finish_reason},
+        json::Field{"delta", &ChatCompletionChunkChoice::delta},
+    };
+};
+
+struct ChatCompletionChunk {
+    std::string_view id = "gabby-completion-123";
+    std::string_view object = "chat.completion.chunk";
+    int64_t created = 1111111111;
+    std::string_view model = "gabby-model";
+    std::string_view system_fingerprint = "fp_1111111111";
+    std::vector<ChatCompletionChunkChoice> choices;
+
+    static constexpr std::tuple kJsonFields = {
+        json::Field{"id", &ChatCompletionChunk::id},
+        json::Field{"object", &ChatCompletionChunk::object},
+        json::Field{"created", &ChatCompletionChunk::created},
+        json::Field{"model", &ChatCompletionChunk::model},
+        json::Field{"system_fingerprint",
+                    &ChatCompletionChunk::system_fingerprint},
+        json::Field{"choices", &ChatCompletionChunk::choices},
+    };
+};
+
+}  // namespace gabby
+
+#endif  // GABBY_CHAT_COMPLETIONS_H_
@@ -0,0 +1,222 @@
+#include "http/epoll_loop.h"
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "utils/logging.h"
+
+namespace gabby {
+namespace http {
+
+namespace {
+
+constexpr int kMaxEvents = 64;
+constexpr size_t kReadChunkSize = 4096;
+// the most we read at once of a body that's known to be large
+constexpr size_t kMaxReadChunkSize = 256 * 1024;
+
+void AddFd(int epoll, int fd, uint32_t events) {
+    struct epoll_event ev;
+    ev.events = events;
+    ev.data.fd = fd;
+    if (epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        throw SystemError(errno);
+    }
+}
+
+OwnedFd MakeEpoll() {
+    int fd = epoll_create1(EPOLL_CLOEXEC);
+    if (fd < 0) throw SystemError(errno);
+    return Own(fd);
+}
+
+std::array<OwnedFd, 2> MakePipe() {
+    int fds[2];
+    if (::pipe2(fds, O_NONBLOCK | O_CLOEXEC) < 0) throw SystemError(errno);
+    return {Own(fds[0]), Own(fds[1])};
+}
+
+}  // namespace
+
+EpollLoop::EpollLoop(OwnedFd listener, const ServerConfig& config,
+                     Dispatch dispatch)
+    : EventLoop(config, std::move(dispatch)),
+      listener_(std::move(listener)),
+      epoll_(MakeEpoll()),
+      pipe_(MakePipe()) {
+    AddFd(*epoll_, *listener_, EPOLLIN);
+    AddFd(*epoll_, *pipe_[0], EPOLLIN);
+}
+
+void EpollLoop::Notify() {
+    char wake = 1;
+    write(*pipe_[1], &wake, 1);
+}
+
+void EpollLoop::Run() {
+    LOG(DEBUG) << "event loop started";
+    struct epoll_event events[kMaxEvents];
+    while (running()) {
+        int n = epoll_wait(*epoll_, events, kMaxEvents, NextTimeoutMillis());
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) throw SystemError(errno);
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (listener_ && fd == *listener_) {
+                Accept();
+            } else if (fd == *pipe_[0]) {
+                char buf[64];
+                while (::read(*pipe_[0], buf, sizeof(buf)) > 0);
+                Wake();
+            } else if (auto it = conns_.find(fd); it != conns_.end()) {
+                Connection& conn = *it->second;
+                if (conn.phase == Connection::Phase::Write) Write(conn);
+                else Read(conn);
+            }
+        }
+        Expire();
+    }
+    LOG(DEBUG) << "event loop finished, closing " << conns_.size()
+               << " connections";
+    for (auto& [fd, conn] : conns_) timers_.Cancel(&conn->timer);
+    conns_.clear();
+}
+
+void EpollLoop::Accept() {
+    while (true) {
+        struct sockaddr_storage client_addr;
+        socklen_t addr_len = sizeof(client_addr);
+        int fd = ::accept4(*listener_, (struct sockaddr*)&client_addr,
+                           &addr_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            return AcceptFailed(*listener_, errno);
+        }
+        if (auto conn = Accepted(fd, client_addr)) Continue(std::move(conn));
+    }
+}
+
+void EpollLoop::Watch(std::unique_ptr<Connection> conn) {
+    int fd = *conn->fd;
+    AddFd(*epoll_, fd, EPOLLIN | EPOLLRDHUP | EPOLLET);
+    conns_.emplace(fd, std::move(conn));
+}
+
+void EpollLoop::StartWrite(std::unique_ptr<Connection> conn) {
+    int fd = *conn->fd;
+    Connection& ref = *conn;
+    Arm(ref, Connection::Phase::Write);
+    AddFd(*epoll_, fd, EPOLLOUT | EPOLLET);
+    conns_.emplace(fd, std::move(conn));
+    Write(ref);
+}
+
+void EpollLoop::Read(Connection& conn) {
+    int fd = *conn.fd;
+    // edge-triggered, so drain the socket. each read is parsed before
+    // the next, so a client is turned away as soon as its request is
+    // too large, and we never buffer more than the request.
+    while (true) {
+        ssize_t n;
+        if (conn.phase == Connection::Phase::Linger) {
+            // the client has been answered, and the rest is dropped
+            char discard[kReadChunkSize];
+            n = ::recv(fd, discard, sizeof(discard), 0);
+        } else {
+            size_t size = conn.buf.size();
+            // the rest of a large body takes a few big reads rather
+            // than many small ones
+            size_t chunk = std::clamp(conn.parser.remaining(size),
+                                      kReadChunkSize, kMaxReadChunkSize);
+            conn.buf.resize(size + chunk);
+            n = ::recv(fd, conn.buf.data() + size, chunk, 0);
+            conn.buf.resize(size + std::max(n, ssize_t(0)));
+        }
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+        }
+        switch (Parse(conn, n <= 0)) {
+            case ReadResult::Wait: continue;
+            case ReadResult::Close: return Close(conn);
+            case ReadResult::Ready: return HandOff(Release(conn));
+        }
+    }
+}
+
+void EpollLoop::Write(Connection& conn) {
+    int fd = *conn.fd;
+    bool progress = false;
+    while (conn.out_sent < conn.out.size()) {
+        ssize_t n = ::send(fd, conn.out.data() + conn.out_sent,
+                           conn.out.size() - conn.out_sent, MSG_NOSIGNAL);
+        if (n >= 0) {
+            conn.out_sent += n;
+            progress = true;
+            continue;
+        }
+        if (errno == EINTR) continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            LOG(DEBUG) << "failed to send response to " << conn.addr << ": "
+                       << strerror(errno);
+            return Close(conn);
+        }
+        // the client only has to keep taking some of it
+        if (progress) Arm(conn, Connection::Phase::Write);
+        return;
+    }
+    // don't hold on to a large response for the life of the connection
+    conn.out = std::string();
+    conn.out_sent = 0;
+    Continue(Release(conn));
+}
+
+std::unique_ptr<Connection> EpollLoop::Release(Connection& conn) {
+    int fd = *conn.fd;
+    epoll_ctl(*epoll_, EPOLL_CTL_DEL, fd, nullptr);
+    timers_.Cancel(&conn.timer);
+    auto it = conns_.find(fd);
+    auto owned = std::move(it->second);
+    conns_.erase(it);
+    return owned;
+}
+
+void EpollLoop::StopAccepting() {
+    epoll_ctl(*epoll_, EPOLL_CTL_DEL, *listener_, nullptr);
+    // clients still in the backlog are refused when it's closed
+    listener_.reset();
+}
+
+void EpollLoop::CloseIdle() {
+    for (auto it = conns_.begin(); it != conns_.end();) {
+        Connection& conn = *(it++)->second;
+        if (conn.phase == Connection::Phase::Idle && conn.buf.empty()) {
+            Close(conn);
+        }
+    }
+}
+
+void EpollLoop::PauseAccepting() {
+    if (listener_) epoll_ctl(*epoll_, EPOLL_CTL_DEL, *listener_, nullptr);
+}
+
+void EpollLoop::ResumeAccepting() {
+    if (listener_) AddFd(*epoll_, *listener_, EPOLLIN);
+}
+
+void EpollLoop::Close(Connection& conn) {
+    LOG(DEBUG) << "closing client " << conn.addr << ":" << conn.port;
+    timers_.Cancel(&conn.timer);
+    conns_.erase(*conn.fd);
+}
+
+}  // namespace http
+}  // namespace gabby
@@ -0,0 +1,52 @@
+#ifndef GABBY_HTTP_EPOLL_LOOP_H_
+#define GABBY_HTTP_EPOLL_LOOP_H_
+
+#include <array>
+#include <memory>
+#include <unordered_map>
+
+#include "http/event_loop.h"
+#include "utils/pointers.h"
+
+namespace gabby {
+namespace http {
+
+// an edge-triggered epoll reactor. sockets are read and written as soon
+// as they're ready, and resumed connections are picked up through a
+// pipe.
+class EpollLoop : public EventLoop {
+public:
+    // |config| must outlive the constructed instance
+    EpollLoop(OwnedFd listener, const ServerConfig& config, Dispatch dispatch);
+
+    void Run() override;
+
+private:
+    void Notify() override;
+    void Watch(std::unique_ptr<Connection> conn) override;
+    void StartWrite(std::unique_ptr<Connection> conn) override;
+    void Close(Connection& conn) override;
+    void StopAccepting() override;
+    void CloseIdle() override;
+    void PauseAccepting() override;
+    void ResumeAccepting() override;
+
+    void Accept();
+    void Read(Connection& conn);
+    void Write(Connection& conn);
+    // stops watching |conn| and returns it
+    std::unique_ptr<Connection> Release(Connection& conn);
+
+    OwnedFd listener_;  // null once we've stopped accepting
+    OwnedFd epoll_;
+    std::unordered_map<int, std::unique_ptr<Connection>> conns_;
+
+    // we use a pipe to wake the loop up for graceful shutdown and
+    // for resumed connections
+    std::array<OwnedFd, 2> pipe_;  // [read, write]
+};
+
+}  // namespace http
+}  // namespace gabby
+
+#endif  // GABBY_HTTP_EPOLL_LOOP_H_
@@ -0,0 +1,381 @@
+#include "http/event_loop.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <optional>
+#include <string_view>
+
+#include "http/epoll_loop.h"
+#include "http/server.h"
+#include "utils/logging.h"
+#include "utils/metrics.h"
+
+namespace gabby {
+namespace http {
+
+namespace {
+
+// returns true once the request head and body have been fully read.
+bool TryParse(Connection& conn) {
+    if (!conn.parser.Parse(conn.buf, &conn.req)) return false;
+    conn.req.addr = conn.addr;
+    LOG(DEBUG) << "parsed request: " << conn.req;
+    return true;
+}
+
+// an empty request that allocates from |arena|
+Request EmptyRequest(std::pmr::memory_resource* arena) {
+    return Request{
+        .headers = Headers(arena),
+        .params = PathParams(arena),
+        .arena = arena,
+    };
+}
+
+// drops the last request handled on |conn|, keeping any bytes that were
+// pipelined behind it
+void Consume(Connection& conn) {
+    conn.buf.erase(0, conn.parser.size());
+    conn.parser.Reset();
+    conn.req = EmptyRequest(&conn.arena);
+    // nothing that was allocated from it is left
+    conn.arena.release();
+}
+
+// what |conn| is waiting on while its next request is read
+Connection::Phase ReadPhase(const Connection& conn) {
+    using enum Connection::Phase;
+    if (conn.buf.empty()) return conn.requests > 0 ? Idle : Head;
+    return conn.parser.head_parsed() ? Body : Head;
+}
+
+Counter& ConnectionsAccepted() {
+    static Counter& counter = GlobalMetrics().counter(
+        "http_connections_accepted_total", "client connections accepted");
+    return counter;
+}
+
+Counter& ConnectionsOpen() {
+    static Counter& gauge = GlobalMetrics().gauge(
+        "http_connections_open", "client connections currently open");
+    return gauge;
+}
+
+Counter& RejectedOverLimit() {
+    static Counter& counter = GlobalMetrics().counter(
+        "http_connections_rejected_total",
+        "client connections turned away as soon as they were accepted",
+        {{"reason", "max_connections"}});
+    return counter;
+}
+
+Counter& RejectedOutOfFds() {
+    static Counter& counter = GlobalMetrics().counter(
+        "http_connections_rejected_total",
+        "client connections turned away as soon as they were accepted",
+        {{"reason", "out_of_fds"}});
+    return counter;
+}
+
+Counter& AcceptPauses() {
+    static Counter& counter = GlobalMetrics().counter(
+        "http_accept_pauses_total",
+        "times a listener stopped accepting for a while after an error");
+    return counter;
+}
+
+// how long to stop accepting after a failure, doubling each time it
+// fails again in a row
+constexpr int kMinAcceptBackoffMillis = 10;
+constexpr int kMaxAcceptBackoffMillis = 1000;
+
+OwnedFd OpenReserve() {
+    int fd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) throw SystemError(errno);
+    return Own(fd);
+}
+
+int TimeoutMillis(const ServerConfig& config, Connection::Phase phase) {
+    switch (phase) {
+        case Connection::Phase::Idle: return config.keep_alive_timeout_millis;
+        case Connection::Phase::Head: return config.read_timeout_millis;
+        case Connection::Phase::Body: return config.body_timeout_millis;
+        case Connection::Phase::Write: return config.write_timeout_millis;
+        case Connection::Phase::Linger: return config.read_timeout_millis;
+    }
+    return 0;
+}
+
+}  // namespace
+
+Connection::Connection(OwnedFd fd, int port, std::string addr)
+    : fd(std::move(fd)),
+      port(port),
+      addr(std::move(addr)),
+      arena(arena_buffer.data(), arena_buffer.size()),
+      parser(&arena),
+      req(EmptyRequest(&arena)) {}
+
+Connection::~Connection() {
+    if (loop != nullptr) loop->Closed();
+}
+
+EventLoop::EventLoop(const ServerConfig& config, Dispatch dispatch)
+    : config_(config),
+      dispatch_(std::move(dispatch)),
+      reserve_(OpenReserve()) {}
+
+void EventLoop::Stop() {
+    LOG(DEBUG) << "sending stop notification...";
+    run_ = false;
+    Notify();
+}
+
+void EventLoop::Resume(std::unique_ptr<Connection> conn) {
+    {
+        std::lock_guard guard(mux_);
+        resumed_.push_back(std::move(conn));
+    }
+    Notify();
+}
+
+void EventLoop::Drain(Clock::time_point deadline) {
+    LOG(DEBUG) << "sending drain notification...";
+    {
+        std::lock_guard guard(mux_);
+        if (drain_deadline_.has_value()) return;
+        drain_deadline_ = deadline;
+        drain_ = true;
+    }
+    Notify();
+}
+
+void EventLoop::Closed() {
+    ConnectionsOpen().Add(-1);
+    // the loop may be waiting on the last one to go
+    if (open_.fetch_sub(1) == 1 && drain_ && run_) Notify();
+}
+
+bool EventLoop::running() {
+    if (run_ && draining_.has_value() &&
+        (open_ == 0 || Clock::now() >= *draining_)) {
+        LOG(DEBUG) << "drained, with " << open_ << " connections still open";
+        run_ = false;
+    }
+    return run_;
+}
+
+void EventLoop::Wake() {
+    std::vector<std::unique_ptr<Connection>> resumed;
+    std::optional<Clock::time_point> drain;
+    {
+        std::lock_guard guard(mux_);
+        resumed.swap(resumed_);
+        drain = drain_deadline_;
+    }
+    if (drain.has_value() && !draining_.has_value()) {
+        draining_ = drain;
+        StopAccepting();
+        // clients holding on to a persistent connection mustn't keep us
+        // waiting for it to time out
+        CloseIdle();
+    }
+    for (auto& conn : resumed) {
+        Consume(*conn);
+        if (conn->out.empty()) Continue(std::move(conn));
+        else StartWrite(std::move(conn));
+    }
+}
+
+void EventLoop::Continue(std::unique_ptr<Connection> conn) {
+    if (conn->linger_after_write) {
+        Linger(*conn);
+        return Watch(std::move(conn));
+    }
+    bool ready;
+    try {
+        ready = TryParse(*conn);
+    } catch (const HttpException& e) {
+        LOG(WARN) << "bad request from " << conn->addr << ": " << e.what();
+        Reject(*conn, e.status());
+        return Watch(std::move(conn));
+    }
+    if (ready) return HandOff(std::move(conn));
+    Connection::Phase phase = ReadPhase(*conn);
+    // no more requests are coming on it while we drain
+    if (draining_.has_value() && phase == Connection::Phase::Idle) return;
+    Arm(*conn, phase);
+    Watch(std::move(conn));
+}
+
+EventLoop::ReadResult EventLoop::Parse(Connection& conn, bool eof) {
+    if (conn.phase == Connection::Phase::Linger) {
+        conn.buf.clear();
+        return eof ? ReadResult::Close : ReadResult::Wait;
+    }
+    bool ready;
+    try {
+        ready = TryParse(conn);
+    } catch (const HttpException& e) {
+        LOG(WARN) << "bad request from " << conn.addr << ": " << e.what();
+        Reject(conn, e.status());
+        return eof ? ReadResult::Close : ReadResult::Wait;
+    }
+    if (ready) return ReadResult::Ready;
+    if (eof) return ReadResult::Close;
+    // each part of the request has its own deadline, so that a client
+    // can't trickle it in forever
+    Connection::Phase phase = ReadPhase(conn);
+    if (phase != conn.phase) Arm(conn, phase);
+    return ReadResult::Wait;
+}
+
+int EventLoop::NextTimeoutMillis() const {
+    std::optional<Clock::time_point> next = timers_.NextExpiry();
+    // wake up in time to give up on draining, and to start accepting
+    // again
+    for (const auto& t : {draining_, accept_resume_}) {
+        if (t.has_value()) next = std::min(next.value_or(*t), *t);
+    }
+    if (!next.has_value()) return -1;
+    auto wait = *next - Clock::now();
+    auto millis = std::chrono::ceil<std::chrono::milliseconds>(wait).count();
+    return std::max(0, int(millis));
+}
+
+void EventLoop::Arm(Connection& conn, Connection::Phase phase) {
+    conn.phase = phase;
+    conn.timer.owner = &conn;
+    auto timeout = std::chrono::milliseconds(TimeoutMillis(config_, phase));
+    timers_.Schedule(&conn.timer, Clock::now() + timeout);
+}
+
+void EventLoop::HandOff(std::unique_ptr<Connection> conn) {
+    // workers don't touch the timers, so it mustn't be scheduled
+    timers_.Cancel(&conn->timer);
+    conn->requests++;
+    dispatch_(std::move(conn));
+}
+
+void EventLoop::Expire() {
+    Clock::time_point now = Clock::now();
+    if (accept_resume_.has_value() && now >= *accept_resume_) {
+        LOG(DEBUG) << "accepting clients again";
+        accept_resume_.reset();
+        ResumeAccepting();
+    }
+    timers_.Advance(now, [this](TimerWheel::Timer* timer) {
+        Connection& conn = *static_cast<Connection*>(timer->owner);
+        LOG(DEBUG) << "deadline exceeded for fd " << *conn.fd;
+        // idle persistent connections are closed quietly, and it's too
+        // late to answer a client that's part way through a response
+        bool reading = conn.phase == Connection::Phase::Head ||
+                       conn.phase == Connection::Phase::Body;
+        if (reading && !conn.buf.empty()) {
+            Reply(*conn.fd, StatusCode::RequestTimeout);
+        }
+        Close(conn);
+    });
+}
+
+void EventLoop::Reply(int fd, StatusCode status) {
+    // best effort: the client may have gone away, and we never block
+    std::string resp =
+        std::format("{}Connection: close\r\n\r\n", StatusLine(status));
+    ::send(fd, resp.data(), resp.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+}
+
+void EventLoop::Reject(Connection& conn, StatusCode status) {
+    Reply(*conn.fd, status);
+    Linger(conn);
+}
+
+void EventLoop::Linger(Connection& conn) {
+    // closing a socket with unread data in it resets the connection,
+    // which can throw away the response before the client reads it. so
+    // we only stop sending, and drain the rest of the request.
+    ::shutdown(*conn.fd, SHUT_WR);
+    conn.buf = std::string();
+    Arm(conn, Connection::Phase::Linger);
+}
+
+void EventLoop::AcceptFailed(int listener, int err) {
+    if (err == EMFILE || err == ENFILE) {
+        LOG(WARN) << "out of file descriptors, turning a client away";
+        reserve_.reset();
+        int fd = ::accept4(listener, nullptr, nullptr,
+                           SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd >= 0) {
+            Reply(fd, StatusCode::ServiceUnavailable);
+            ::close(fd);
+            RejectedOutOfFds().Add();
+        }
+        int reserve = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+        if (reserve >= 0) reserve_ = Own(reserve);
+    } else {
+        LOG(ERROR) << "failed to accept client: " << strerror(err);
+    }
+    if (accept_resume_.has_value()) return;
+    accept_backoff_millis_ =
+        std::clamp(accept_backoff_millis_ * 2, kMinAcceptBackoffMillis,
+                   kMaxAcceptBackoffMillis);
+    LOG(WARN) << "not accepting clients for " << accept_backoff_millis_
+              << " ms";
+    accept_resume_ =
+        Clock::now() + std::chrono::milliseconds(accept_backoff_millis_);
+    AcceptPauses().Add();
+    PauseAccepting();
+}
+
+std::unique_ptr<Connection> EventLoop::Accepted(
+    int fd, const sockaddr_storage& addr) {
+    accept_backoff_millis_ = 0;
+    if (max_connections_ > 0 && open_ >= max_connections_) {
+        LOG(DEBUG) << "at " << max_connections_
+                   << " connections, turning a client away";
+        Reply(fd, StatusCode::ServiceUnavailable);
+        ::close(fd);
+        RejectedOverLimit().Add();
+        return nullptr;
+    }
+    int port = 0;
+    std::string peer = "unix";
+    if (addr.ss_family == AF_INET) {
+        // streamed responses are sent in small pieces that shouldn't
+        // wait on the client's delayed acks
+        int nodelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+        const auto& in = reinterpret_cast<const sockaddr_in&>(addr);
+        char ip[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &in.sin_addr, ip, INET_ADDRSTRLEN);
+        port = ntohs(in.sin_port);
+        peer = ip;
+    }
+    auto conn = std::make_unique<Connection>(Own(fd), port, std::move(peer));
+    conn->loop = this;
+    conn->parser.set_max_body_len(config_.max_body_bytes);
+    open_++;
+    ConnectionsAccepted().Add();
+    ConnectionsOpen().Add(1);
+    LOG(DEBUG) << "accepted client " << conn->addr << ":" << conn->port;
+    return conn;
+}
+
+std::unique_ptr<EventLoop> MakeEventLoop(OwnedFd listener,
+                                         const ServerConfig& config,
+                                         EventLoop::Dispatch dispatch) {
+    return std::make_unique<EpollLoop>(std::move(listener), config,
+                                       std::move(dispatch));
+}
+
+}  // namespace http
+}  // namespace gabby
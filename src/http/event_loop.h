@@ -0,0 +1,243 @@
+#ifndef GABBY_HTTP_EVENT_LOOP_H_
+#define GABBY_HTTP_EVENT_LOOP_H_
+
+#include <sys/socket.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory_resource>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "http/request_parser.h"
+#include "http/types.h"
+#include "utils/pointers.h"
+#include "utils/timer_wheel.h"
+
+namespace gabby {
+namespace http {
+
+struct ServerConfig;
+class EventLoop;
+
+using Clock = std::chrono::steady_clock;
+
+// a client connection. the event loop owns it while the request is
+// being read, and hands it off to a worker once it's been fully read.
+// the loop takes it back to send whatever of the response the client
+// hasn't taken yet, and to wait for the next request.
+struct Connection {
+    // what the connection is waiting on, each with its own deadline
+    enum class Phase {
+        Idle,   // the next request on a persistent connection
+        Head,   // the rest of the request head
+        Body,   // the rest of the request body
+        Write,  // the client to take the rest of the response
+        Linger,  // the client to stop sending, after an error response
+    };
+
+    Connection(OwnedFd fd, int port, std::string addr);
+    ~Connection();
+
+    OwnedFd fd;
+    // the client's port and address, or 0 and "unix" for a client on a
+    // unix domain socket
+    int port;
+    std::string addr;
+
+    // memory for everything allocated while reading and handling a
+    // request, which is all released at once before the next one. most
+    // requests fit in the inline buffer and never touch the heap.
+    std::array<std::byte, 4096> arena_buffer;
+    std::pmr::monotonic_buffer_resource arena;
+
+    // bytes read from the socket so far
+    std::string buf;
+
+    // set once the request has been fully read
+    RequestParser parser;
+    Request req;
+
+    // requests dispatched on this connection so far
+    int requests = 0;
+
+    // the end of the last response, still to be sent by the loop
+    std::string out;
+    size_t out_sent = 0;
+    // whether to stop sending once |out| has been sent, and then wait
+    // for the client to hang up rather than closing straight away
+    bool linger_after_write = false;
+
+    Phase phase = Phase::Head;
+    TimerWheel::Timer timer;
+
+    // the loop that accepted the connection, which keeps count of those
+    // still open wherever they are
+    EventLoop* loop = nullptr;
+};
+
+// the part of an event loop that doesn't depend on how it waits on
+// sockets. it accepts clients, reads and parses their requests without
+// blocking, and passes each fully-read request to |dispatch|.
+// |dispatch| is called on the loop thread and must not block.
+//
+// once a response has been written, a persistent connection, or one
+// with some of the response left in |out|, should be handed back with
+// Resume. the loop sends the rest of the response and then handles any
+// request that was pipelined behind it, so requests on a connection are
+// handled and answered in order.
+//
+// clients that take too long at any point are dropped by the loop,
+// without a thread ever waiting on them.
+class EventLoop {
+public:
+    using Dispatch = std::function<void(std::unique_ptr<Connection> conn)>;
+
+    virtual ~EventLoop() = default;
+
+    // runs the loop on the calling thread until Stop is called
+    virtual void Run() = 0;
+
+    // thread-safe
+    void Stop();
+
+    // returns |conn| to the loop to finish sending its response and
+    // wait for its next request. thread-safe.
+    void Resume(std::unique_ptr<Connection> conn);
+
+    // stops accepting clients. Run returns once every connection the
+    // loop accepted has been closed, or at |deadline|. until then,
+    // requests on open connections are still handled, and connections
+    // that are idle between requests are closed. thread-safe, and only
+    // the first call has any effect.
+    void Drain(Clock::time_point deadline);
+
+    // clients accepted while this many connections are open are turned
+    // away with a 503 straight away. 0 means no limit. must be called
+    // before Run.
+    void set_max_connections(int max) { max_connections_ = max; }
+
+protected:
+    // |config| must outlive the constructed instance
+    EventLoop(const ServerConfig& config, Dispatch dispatch);
+
+    // wakes up the loop to stop, or to pick up resumed connections.
+    // thread-safe.
+    virtual void Notify() = 0;
+
+    // waits for more of the request on |conn|, whose deadline is set
+    virtual void Watch(std::unique_ptr<Connection> conn) = 0;
+
+    // sends |conn.out|, and then calls Continue or closes |conn|
+    virtual void StartWrite(std::unique_ptr<Connection> conn) = 0;
+
+    // closes |conn|, which the loop owns
+    virtual void Close(Connection& conn) = 0;
+
+    virtual void StopAccepting() = 0;
+
+    // closes every connection that's waiting for its next request, and
+    // hasn't been sent any of it
+    virtual void CloseIdle() = 0;
+
+    // stop and start waiting for clients while we back off after a
+    // failure to accept one. either may be called after StopAccepting.
+    virtual void PauseAccepting() = 0;
+    virtual void ResumeAccepting() = 0;
+
+    // whether Run should keep going
+    bool running();
+
+    // picks up the connections handed back with Resume
+    void Wake();
+
+    // handles the next request on |conn| if it's already been read, or
+    // waits for it. lingers instead if |conn| asks for it, and closes it
+    // if it would wait for a request while we drain.
+    void Continue(std::unique_ptr<Connection> conn);
+
+    enum class ReadResult { Wait, Ready, Close };
+
+    // parses what's been read into |conn| so far. |eof| is whether the
+    // client has stopped sending. replies to bad requests and moves the
+    // deadline along as the request comes in.
+    ReadResult Parse(Connection& conn, bool eof);
+
+    // starts |phase| on |conn|, and its deadline
+    void Arm(Connection& conn, Connection::Phase phase);
+    void HandOff(std::unique_ptr<Connection> conn);
+
+    // closes connections whose deadlines have passed
+    void Expire();
+    int NextTimeoutMillis() const;
+
+    // sends a response without a body, without blocking
+    static void Reply(int fd, StatusCode status);
+
+    // replies to a request on |conn| that we won't handle, and starts
+    // reading and dropping whatever the client still sends until it
+    // hangs up
+    void Reject(Connection& conn, StatusCode status);
+
+    // stops sending on |conn|, and reads and drops whatever the client
+    // still sends until it hangs up
+    void Linger(Connection& conn);
+
+    // takes ownership of a newly accepted client socket, whose peer is
+    // |addr|: an ip address, or a unix domain socket. returns null if
+    // the client was turned away.
+    std::unique_ptr<Connection> Accepted(int fd, const sockaddr_storage& addr);
+
+    // handles a failure to accept a client from |listener|. running out
+    // of file descriptors would leave the client in the backlog, and
+    // the listener ready, forever, so we turn away the client with the
+    // fd we keep in reserve for this. then, whatever the error, we stop
+    // accepting for a while, for a little longer each time it happens
+    // again.
+    void AcceptFailed(int listener, int err);
+
+    const ServerConfig& config_;
+    TimerWheel timers_;
+
+private:
+    friend struct Connection;
+
+    // called as each accepted connection is destroyed, on any thread
+    void Closed();
+
+    Dispatch dispatch_;
+    std::atomic<bool> run_ = true;
+    std::atomic<int> open_ = 0;
+    std::mutex mux_;
+    std::vector<std::unique_ptr<Connection>> resumed_;
+    // set by Drain. the deadline is guarded by |mux_|.
+    std::atomic<bool> drain_ = false;
+    std::optional<Clock::time_point> drain_deadline_;
+    // the loop thread's copy
+    std::optional<Clock::time_point> draining_;
+
+    int max_connections_ = 0;
+    // an open file that we close to make room to turn a client away
+    // when we're out of file descriptors. null if it couldn't be
+    // reopened.
+    OwnedFd reserve_;
+    // set while accepting is paused
+    std::optional<Clock::time_point> accept_resume_;
+    int accept_backoff_millis_ = 0;
+};
+
+// returns an event loop for the clients of |listener|
+std::unique_ptr<EventLoop> MakeEventLoop(OwnedFd listener,
+                                         const ServerConfig& config,
+                                         EventLoop::Dispatch dispatch);
+
+}  // namespace http
+}  // namespace gabby
+
+#endif  // GABBY_HTTP_EVENT_LOOP_H_
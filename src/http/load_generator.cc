@@ -0,0 +1,599 @@
+#include "http/load_generator.h"
+
+#include <netdb.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <format>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+
+#include "utils/logging.h"
+#include "utils/pointers.h"
+
+namespace gabby {
+namespace http {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kMaxEvents = 64;
+constexpr int kReadChunkSize = 16 * 1024;
+
+OwnedFd MakeEpoll() {
+    int fd = epoll_create1(EPOLL_CLOEXEC);
+    if (fd < 0) throw SystemError(errno);
+    return Own(fd);
+}
+
+int64_t Micros(Clock::duration d) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+}
+
+std::string_view Trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) {
+        s.remove_prefix(1);
+    }
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) {
+        s.remove_suffix(1);
+    }
+    return s;
+}
+
+// reads an http response as it arrives, delimited by its length, by
+// chunked transfer encoding, or by the server closing the connection.
+// counts server-sent events as they're read.
+class ResponseReader {
+public:
+    // takes the next bytes read from the socket, and returns true once
+    // they complete the response
+    bool Feed(std::string_view data);
+
+    // whether the server closing the connection now ends the response
+    bool Eof() const { return body_ == Body::UntilEof; }
+
+    int status() const { return status_; }
+    // whether the server will close the connection after the response
+    bool close() const { return close_; }
+    // events read by the last call to Feed
+    int new_events() const { return new_events_; }
+
+private:
+    enum class Body { Head, Length, Chunked, UntilEof };
+
+    void ParseHead(std::string_view head);
+    // decodes what it can of |buf_|, returning true at the last chunk
+    bool Dechunk();
+    void Scan(std::string_view data);
+
+    Body body_ = Body::Head;
+    std::string buf_;
+    int status_ = 0;
+    bool close_ = false;
+    bool events_ = false;
+    size_t remaining_ = 0;
+    // whether the CRLF after the current chunk is still to come
+    bool chunk_end_ = false;
+    // an event that hasn't been fully read yet
+    std::string event_;
+    int new_events_ = 0;
+};
+
+bool ResponseReader::Feed(std::string_view data) {
+    new_events_ = 0;
+    if (body_ == Body::Head) {
+        buf_.append(data);
+        size_t end = buf_.find("\r\n\r\n");
+        if (end == std::string::npos) return false;
+        ParseHead(std::string_view(buf_).substr(0, end));
+        buf_.erase(0, end + 4);
+        data = {};
+        if (body_ != Body::Chunked) {
+            std::string rest = std::move(buf_);
+            buf_.clear();
+            if (body_ == Body::Length && remaining_ == 0) return true;
+            return Feed(rest);
+        }
+    }
+    switch (body_) {
+        case Body::Head: return false;
+        case Body::Length: {
+            size_t n = std::min(remaining_, data.size());
+            Scan(data.substr(0, n));
+            remaining_ -= n;
+            return remaining_ == 0;
+        }
+        case Body::UntilEof: Scan(data); return false;
+        case Body::Chunked: buf_.append(data); return Dechunk();
+    }
+    return false;
+}
+
+void ResponseReader::ParseHead(std::string_view head) {
+    // HTTP/1.1 200 OK
+    size_t line_end = std::min(head.find("\r\n"), head.size());
+    std::string_view line = head.substr(0, line_end);
+    if (line.size() < 12 || !line.starts_with("HTTP/1.")) {
+        throw std::runtime_error(
+            std::format("bad response status line: {}", line));
+    }
+    std::from_chars(line.data() + 9, line.data() + 12, status_);
+    close_ = line.starts_with("HTTP/1.0");
+    body_ = Body::UntilEof;
+
+    for (size_t pos = line_end; pos < head.size();) {
+        size_t end = std::min(head.find("\r\n", pos + 2), head.size());
+        std::string_view header = head.substr(pos + 2, end - pos - 2);
+        pos = end;
+        size_t colon = header.find(':');
+        if (colon == std::string_view::npos) continue;
+        std::string_view key = header.substr(0, colon);
+        std::string_view value = Trim(header.substr(colon + 1));
+        if (EqualsIgnoreCase(key, "Content-Length")) {
+            body_ = Body::Length;
+            std::from_chars(value.data(), value.data() + value.size(),
+                            remaining_);
+        } else if (EqualsIgnoreCase(key, "Transfer-Encoding")) {
+            if (value.find("chunked") != std::string_view::npos) {
+                body_ = Body::Chunked;
+            }
+        } else if (EqualsIgnoreCase(key, "Connection")) {
+            close_ = EqualsIgnoreCase(value, "close");
+        } else if (EqualsIgnoreCase(key, "Content-Type")) {
+            events_ = value.starts_with("text/event-stream");
+        }
+    }
+    // chunked encoding takes precedence over a length
+    if (body_ == Body::Chunked) remaining_ = 0;
+}
+
+bool ResponseReader::Dechunk() {
+    size_t pos = 0;
+    bool done = false;
+    while (pos < buf_.size()) {
+        std::string_view rest = std::string_view(buf_).substr(pos);
+        if (remaining_ > 0) {
+            size_t n = std::min(remaining_, rest.size());
+            Scan(rest.substr(0, n));
+            remaining_ -= n;
+            pos += n;
+            continue;
+        }
+        if (chunk_end_) {
+            if (rest.size() < 2) break;
+            pos += 2;
+            chunk_end_ = false;
+            continue;
+        }
+        size_t end = rest.find("\r\n");
+        if (end == std::string_view::npos) break;
+        size_t size = 0;
+        std::from_chars(rest.data(), rest.data() + end, size, 16);
+        pos += end + 2;
+        if (size == 0) {
+            // the last chunk, followed by no trailers
+            done = true;
+            break;
+        }
+        remaining_ = size;
+        chunk_end_ = true;
+    }
+    buf_.erase(0, pos);
+    return done;
+}
+
+void ResponseReader::Scan(std::string_view data) {
+    if (!events_) return;
+    event_.append(data);
+    size_t pos = 0;
+    for (size_t end; (end = event_.find("\n\n", pos)) != std::string::npos;
+         pos = end + 2) {
+        std::string_view event = std::string_view(event_).substr(pos, end - pos);
+        if (!event.starts_with("data: [DONE]")) new_events_++;
+    }
+    event_.erase(0, pos);
+}
+
+// what a worker's requests came to, before they're all added up
+struct Tally {
+    int64_t sent = 0;
+    int64_t completed = 0;
+    int64_t errors = 0;
+    std::map<int, int64_t> statuses;
+    int64_t bytes_received = 0;
+    Clock::time_point last_response;
+};
+
+struct Histograms {
+    Histogram latency;
+    Histogram time_to_first_token;
+    Histogram inter_token_latency;
+};
+
+// sends its share of the requests from a thread of its own, on
+// connections of its own
+class Worker {
+public:
+    Worker(const LoadConfig& config, const std::string& request,
+           const sockaddr_storage& addr, socklen_t addr_len, int connections,
+           Histograms* histograms, uint64_t seed);
+    ~Worker();
+
+    // sends requests from |start|, due every |interval| on average
+    void Run(Clock::time_point start, std::chrono::duration<double> interval,
+             Clock::duration offset);
+
+    const Tally& tally() const { return tally_; }
+
+private:
+    struct Slot {
+        int fd = -1;
+        bool busy = false;
+        // when the request on the slot was due
+        Clock::time_point due;
+        Clock::time_point last_event;
+        int events = 0;
+        size_t sent = 0;
+        ResponseReader reader;
+    };
+
+    void Send(Slot& slot, Clock::time_point due);
+    void Connect(Slot& slot);
+    void Disconnect(Slot& slot);
+    void Write(Slot& slot);
+    void Read(Slot& slot);
+    void Finish(Slot& slot);
+    void Fail(Slot& slot);
+
+    const LoadConfig& config_;
+    const std::string& request_;
+    const sockaddr_storage& addr_;
+    socklen_t addr_len_;
+    Histograms* histograms_;
+    std::mt19937_64 random_;
+
+    OwnedFd epoll_;
+    std::vector<std::unique_ptr<Slot>> slots_;
+    std::vector<Slot*> idle_;
+    // requests that are due, waiting for a free connection
+    std::deque<Clock::time_point> due_;
+    int busy_ = 0;
+    Tally tally_;
+};
+
+Worker::Worker(const LoadConfig& config, const std::string& request,
+               const sockaddr_storage& addr, socklen_t addr_len,
+               int connections, Histograms* histograms, uint64_t seed)
+    : config_(config),
+      request_(request),
+      addr_(addr),
+      addr_len_(addr_len),
+      histograms_(histograms),
+      random_(seed),
+      epoll_(MakeEpoll()) {
+    for (int i = 0; i < connections; i++) {
+        slots_.push_back(std::make_unique<Slot>());
+        idle_.push_back(slots_.back().get());
+        // so that the first requests aren't timed connecting
+        if (config_.keep_alive) Connect(*slots_.back());
+    }
+}
+
+Worker::~Worker() {
+    for (auto& slot : slots_) Disconnect(*slot);
+}
+
+void Worker::Run(Clock::time_point start,
+                 std::chrono::duration<double> interval,
+                 Clock::duration offset) {
+    std::exponential_distribution<double> exponential(1 / interval.count());
+    auto next_interval = [&]() -> Clock::duration {
+        std::chrono::duration<double> d =
+            config_.poisson ? std::chrono::duration<double>(exponential(random_))
+                            : interval;
+        return std::chrono::duration_cast<Clock::duration>(d);
+    };
+    Clock::time_point end =
+        start + std::chrono::milliseconds(config_.duration_millis);
+    Clock::time_point give_up =
+        end + std::chrono::milliseconds(config_.timeout_millis);
+    Clock::time_point next =
+        start + (config_.poisson ? next_interval() : offset);
+
+    struct epoll_event events[kMaxEvents];
+    while (true) {
+        Clock::time_point now = Clock::now();
+        for (; next < end && next <= now; next += next_interval()) {
+            due_.push_back(next);
+        }
+        while (!due_.empty() && !idle_.empty()) {
+            Slot* slot = idle_.back();
+            idle_.pop_back();
+            Send(*slot, due_.front());
+            due_.pop_front();
+        }
+        if (next >= end && due_.empty() && busy_ == 0) break;
+        if (now >= give_up) break;
+
+        auto wait = std::max(Clock::duration::zero(),
+                             (next < end ? next : give_up) - now);
+        auto secs = std::chrono::duration_cast<std::chrono::seconds>(wait);
+        struct timespec timeout{
+            .tv_sec = secs.count(),
+            .tv_nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           wait - secs)
+                           .count(),
+        };
+        int n = epoll_pwait2(*epoll_, events, kMaxEvents, &timeout, nullptr);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) throw SystemError(errno);
+        for (int i = 0; i < n; i++) {
+            Slot& slot = *static_cast<Slot*>(events[i].data.ptr);
+            if (slot.fd < 0) continue;
+            if (events[i].events & EPOLLOUT) Write(slot);
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLERR)) {
+                Read(slot);
+            }
+        }
+    }
+    // whatever's left was never answered
+    tally_.errors += due_.size() + busy_;
+    tally_.sent += due_.size();
+}
+
+void Worker::Send(Slot& slot, Clock::time_point due) {
+    tally_.sent++;
+    busy_++;
+    slot.busy = true;
+    slot.due = due;
+    slot.events = 0;
+    slot.sent = 0;
+    slot.reader = ResponseReader();
+    if (slot.fd < 0) Connect(slot);
+    if (slot.fd < 0) return Fail(slot);
+    Write(slot);
+}
+
+void Worker::Connect(Slot& slot) {
+    slot.fd = ::socket(addr_.ss_family,
+                       SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (slot.fd < 0) throw SystemError(errno);
+    if (::connect(slot.fd, reinterpret_cast<const sockaddr*>(&addr_),
+                  addr_len_) < 0 &&
+        errno != EINPROGRESS) {
+        LOG(WARN) << "couldn't connect: " << strerror(errno);
+        return Disconnect(slot);
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = &slot;
+    if (epoll_ctl(*epoll_, EPOLL_CTL_ADD, slot.fd, &ev) < 0) {
+        throw SystemError(errno);
+    }
+}
+
+void Worker::Disconnect(Slot& slot) {
+    if (slot.fd < 0) return;
+    ::close(slot.fd);
+    slot.fd = -1;
+}
+
+void Worker::Write(Slot& slot) {
+    // edge-triggered, so keep going until the socket is full
+    while (slot.busy && slot.sent < request_.size()) {
+        ssize_t n = ::send(slot.fd, request_.data() + slot.sent,
+                           request_.size() - slot.sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            slot.sent += n;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return;
+        } else {
+            return Fail(slot);
+        }
+    }
+}
+
+void Worker::Read(Slot& slot) {
+    char buf[kReadChunkSize];
+    while (slot.fd >= 0) {
+        ssize_t n = ::recv(slot.fd, buf, sizeof(buf), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        if (n <= 0) {
+            // a persistent connection the server's given up on is no
+            // loss until a request is sent on it
+            if (!slot.busy) return Disconnect(slot);
+            if (slot.reader.Eof()) return Finish(slot);
+            return Fail(slot);
+        }
+        // a stray response, or the server hanging up, on an idle one
+        if (!slot.busy) {
+            Disconnect(slot);
+            return;
+        }
+        tally_.bytes_received += n;
+        bool done;
+        try {
+            done = slot.reader.Feed(std::string_view(buf, n));
+        } catch (const std::runtime_error& e) {
+            LOG(WARN) << e.what();
+            return Fail(slot);
+        }
+        if (int events = slot.reader.new_events(); events > 0) {
+            auto now = Clock::now();
+            for (int i = 0; i < events; i++) {
+                if (slot.events++ == 0) {
+                    histograms_->time_to_first_token.Record(
+                        Micros(now - slot.due));
+                } else {
+                    histograms_->inter_token_latency.Record(
+                        Micros(now - slot.last_event));
+                }
+                slot.last_event = now;
+            }
+        }
+        if (done) return Finish(slot);
+    }
+}
+
+void Worker::Finish(Slot& slot) {
+    auto now = Clock::now();
+    histograms_->latency.Record(Micros(now - slot.due));
+    tally_.completed++;
+    tally_.statuses[slot.reader.status()]++;
+    tally_.last_response = std::max(tally_.last_response, now);
+    if (slot.reader.close() || !config_.keep_alive) Disconnect(slot);
+    slot.busy = false;
+    busy_--;
+    idle_.push_back(&slot);
+}
+
+void Worker::Fail(Slot& slot) {
+    tally_.errors++;
+    Disconnect(slot);
+    slot.busy = false;
+    busy_--;
+    idle_.push_back(&slot);
+}
+
+std::string MakeRequest(const LoadConfig& config) {
+    std::string req = std::format("{} {} HTTP/1.1\r\nHost: {}:{}\r\n",
+                                  to_string(config.method), config.path,
+                                  config.host, config.port);
+    for (const auto& [key, value] : config.headers) {
+        req += std::format("{}: {}\r\n", key, value);
+    }
+    if (!config.keep_alive) req += "Connection: close\r\n";
+    if (!config.body.empty()) {
+        req += std::format("Content-Length: {}\r\n", config.body.size());
+    }
+    req += "\r\n";
+    req += config.body;
+    return req;
+}
+
+void Resolve(const LoadConfig& config, sockaddr_storage* addr,
+             socklen_t* len) {
+    if (!config.unix_socket.empty()) {
+        *len = UnixSocketAddress(config.unix_socket,
+                                 reinterpret_cast<sockaddr_un*>(addr));
+        return;
+    }
+    struct addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* result;
+    std::string port = std::to_string(config.port);
+    if (int err = getaddrinfo(config.host.c_str(), port.c_str(), &hints,
+                              &result);
+        err != 0) {
+        throw std::runtime_error(std::format("couldn't resolve {}: {}",
+                                             config.host, gai_strerror(err)));
+    }
+    std::memcpy(addr, result->ai_addr, result->ai_addrlen);
+    *len = result->ai_addrlen;
+    freeaddrinfo(result);
+}
+
+void PrintHistogram(std::ostream& os, std::string_view name,
+                    const Histogram::Snapshot& snap) {
+    os << std::format(
+        "{}: mean={:.0f} p50={} p90={} p99={} p999={} max={} "
+        "(microseconds)\n",
+        name, snap.mean(), snap.Percentile(0.5), snap.Percentile(0.9),
+        snap.Percentile(0.99), snap.Percentile(0.999), snap.max);
+}
+
+}  // namespace
+
+LoadReport RunLoad(const LoadConfig& config) {
+    if (config.rate <= 0 || config.threads < 1 || config.connections < 1) {
+        throw std::invalid_argument("rate, threads and connections must be "
+                                    "positive");
+    }
+    sockaddr_storage addr;
+    socklen_t addr_len;
+    Resolve(config, &addr, &addr_len);
+    std::string request = MakeRequest(config);
+    Histograms histograms;
+
+    int threads = std::min(config.threads, config.connections);
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (int i = 0; i < threads; i++) {
+        // spread the connections as evenly as they go
+        int connections = config.connections / threads +
+                          (i < config.connections % threads ? 1 : 0);
+        workers.push_back(std::make_unique<Worker>(
+            config, request, addr, addr_len, connections, &histograms, i + 1));
+    }
+
+    // each thread sends every |threads|th request, in turn
+    std::chrono::duration<double> interval(threads / config.rate);
+    Clock::time_point start = Clock::now();
+    std::vector<std::thread> running;
+    for (int i = 0; i < threads; i++) {
+        auto offset = std::chrono::duration_cast<Clock::duration>(
+            interval * i / threads);
+        running.emplace_back(&Worker::Run, workers[i].get(), start, interval,
+                             offset);
+    }
+    for (auto& thread : running) thread.join();
+
+    LoadReport report;
+    Clock::time_point last = start;
+    for (const auto& worker : workers) {
+        const Tally& tally = worker->tally();
+        report.sent += tally.sent;
+        report.completed += tally.completed;
+        report.errors += tally.errors;
+        report.bytes_received += tally.bytes_received;
+        for (auto [status, count] : tally.statuses) {
+            report.statuses[status] += count;
+        }
+        last = std::max(last, tally.last_response);
+    }
+    report.seconds = std::chrono::duration<double>(last - start).count();
+    report.latency = histograms.latency.snapshot();
+    report.time_to_first_token = histograms.time_to_first_token.snapshot();
+    report.inter_token_latency = histograms.inter_token_latency.snapshot();
+    return report;
+}
+
+std::ostream& operator<<(std::ostream& os, const LoadReport& report) {
+    os << std::format("requests: {} sent, {} completed, {} errors\n",
+                      report.sent, report.completed, report.errors);
+    os << "statuses:";
+    for (auto [status, count] : report.statuses) {
+        os << std::format(" {}={}", status, count);
+    }
+    os << "\n";
+    os << std::format("throughput: {:.1f} requests/s, {:.2f} MB/s\n",
+                      report.throughput(),
+                      report.seconds > 0
+                          ? report.bytes_received / report.seconds / 1e6
+                          : 0);
+    PrintHistogram(os, "latency", report.latency);
+    if (report.time_to_first_token.count > 0) {
+        PrintHistogram(os, "time to first token", report.time_to_first_token);
+    }
+    if (report.inter_token_latency.count > 0) {
+        PrintHistogram(os, "inter-token latency", report.inter_token_latency);
+    }
+    return os;
+}
+
+}  // namespace http
+}  // namespace gabby
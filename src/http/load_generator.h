@@ -0,0 +1,83 @@
+#ifndef GABBY_HTTP_LOAD_GENERATOR_H_
+#define GABBY_HTTP_LOAD_GENERATOR_H_
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "http/types.h"
+#include "utils/metrics.h"
+
+namespace gabby {
+namespace http {
+
+struct LoadConfig {
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    // connects to this unix domain socket instead of |host| and |port|
+    // if it's set. see ServerConfig::unix_sockets.
+    std::string unix_socket;
+    Method method = Method::GET;
+    std::string path = "/";
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+
+    // requests per second, across every thread
+    double rate = 100;
+    // whether requests arrive at a steady rate, or at random like
+    // independent clients would
+    bool poisson = false;
+    // how long to send requests for
+    int duration_millis = 10'000;
+    // how long to wait for the last responses once it's over
+    int timeout_millis = 10'000;
+
+    // connections to send requests on, across every thread. a request
+    // that's due when they're all busy waits for one to be free.
+    int connections = 16;
+    int threads = 1;
+    // if false, each request is sent on a new connection
+    bool keep_alive = true;
+};
+
+struct LoadReport {
+    int64_t sent = 0;
+    int64_t completed = 0;
+    // requests whose connection failed, or that were never answered
+    int64_t errors = 0;
+    // completed requests by status code
+    std::map<int, int64_t> statuses;
+    int64_t bytes_received = 0;
+    // from the first request being due to the last response
+    double seconds = 0;
+
+    // all in microseconds. latency is from when each request was due,
+    // rather than when it was sent.
+    Histogram::Snapshot latency;
+    // only for responses streamed as server-sent events, where each
+    // event but the last "data: [DONE]" is a token
+    Histogram::Snapshot time_to_first_token;
+    Histogram::Snapshot inter_token_latency;
+
+    double throughput() const { return seconds > 0 ? completed / seconds : 0; }
+};
+
+// sends requests to a server at |config.rate| until |config.duration_millis|
+// has passed, and reports how it kept up.
+//
+// the load is open-loop: requests are due on a schedule that doesn't
+// depend on how quickly they're answered, and latency is measured from
+// when each was due. a server that falls behind can't hide it by
+// slowing the client down, as it could if each connection waited for
+// one response before timing the next request.
+LoadReport RunLoad(const LoadConfig& config);
+
+std::ostream& operator<<(std::ostream& os, const LoadReport& report);
+
+}  // namespace http
+}  // namespace gabby
+
+#endif  // GABBY_HTTP_LOAD_GENERATOR_H_
@@ -0,0 +1,128 @@
+#include "http/load_generator.h"
+
+#include "http/server.h"
+#include "test/test.h"
+
+namespace gabby {
+namespace http {
+
+namespace {
+
+constexpr ServerConfig kTestConfig{
+    .port = 0,
+    .read_timeout_millis = 5000,
+    .write_timeout_millis = 5000,
+    .worker_threads = 2,
+};
+
+class TestServer {
+public:
+    explicit TestServer(Handler h) : server_(kTestConfig) { server_.Start(h); }
+
+    int port() { return server_.port(); }
+
+    ~TestServer() {
+        server_.Stop();
+        server_.Wait();
+    }
+
+private:
+    HttpServer server_;
+};
+
+void Hello(Request& req, ResponseWriter& resp) {
+    resp.WriteStatus(StatusCode::OK);
+    resp.WriteData("hello");
+}
+
+// streams three events and the end marker, one at a time
+void Events(Request& req, ResponseWriter& resp) {
+    resp.WriteStatus(StatusCode::OK);
+    resp.WriteHeader("Content-Type", "text/event-stream");
+    for (int i = 0; i < 3; i++) {
+        resp.WriteData("data: {\"token\": \"x\"}\n\n");
+        resp.Flush();
+    }
+    resp.WriteData("data: [DONE]\n\n");
+}
+
+LoadConfig TestLoad(int port) {
+    return LoadConfig{
+        .port = port,
+        .rate = 500,
+        .duration_millis = 200,
+        .timeout_millis = 5000,
+        .connections = 4,
+    };
+}
+
+}  // namespace
+
+TEST(LoadGenerator, KeepAlive) {
+    // Arrange
+    TestServer server(Hello);
+
+    // Act
+    LoadReport report = RunLoad(TestLoad(server.port()));
+
+    // Assert
+    // 500 requests/s for 200ms.
+    EXPECT_TRUE(report.sent >= 95 && report.sent <= 100);
+    EXPECT_EQ(report.sent, report.completed);
+    EXPECT_EQ(0, report.errors);
+    EXPECT_EQ(report.completed, report.statuses[200]);
+    EXPECT_EQ(report.completed, report.latency.count);
+    EXPECT_EQ(0, report.time_to_first_token.count);
+}
+
+TEST(LoadGenerator, ConnectionPerRequestOnSeveralThreads) {
+    // Arrange
+    TestServer server(Hello);
+    LoadConfig config = TestLoad(server.port());
+    config.keep_alive = false;
+    config.threads = 2;
+    config.poisson = true;
+
+    // Act
+    LoadReport report = RunLoad(config);
+
+    // Assert
+    EXPECT_TRUE(report.sent > 0);
+    EXPECT_EQ(report.sent, report.completed);
+    EXPECT_EQ(0, report.errors);
+    EXPECT_EQ(report.completed, report.statuses[200]);
+}
+
+TEST(LoadGenerator, ServerSentEvents) {
+    // Arrange
+    TestServer server(Events);
+
+    // Act
+    LoadReport report = RunLoad(TestLoad(server.port()));
+
+    // Assert
+    EXPECT_EQ(0, report.errors);
+    EXPECT_EQ(report.sent, report.completed);
+    EXPECT_EQ(report.completed, report.time_to_first_token.count);
+    EXPECT_EQ(2 * report.completed, report.inter_token_latency.count);
+}
+
+TEST(LoadGenerator, CountsUnansweredRequestsAsErrors) {
+    // Arrange
+    // Nothing's listening on the port once the server's gone.
+    int port;
+    {
+        TestServer server(Hello);
+        port = server.port();
+    }
+
+    // Act
+    LoadReport report = RunLoad(TestLoad(port));
+
+    // Assert
+    EXPECT_EQ(0, report.completed);
+    EXPECT_EQ(report.sent, report.errors);
+}
+
+}  // namespace http
+}  // namespace gabby
@@ -0,0 +1,223 @@
+#include "http/request_parser.h"
+
+#include <charconv>
+#include <cstring>
+#include <format>
+
+namespace gabby {
+namespace http {
+
+namespace {
+
+constexpr size_t kMaxHeadLen = 16 * 1024;
+constexpr size_t kMaxChunkLineLen = 1024;
+
+bool IsSpace(char c) { return c == ' ' || c == '\t'; }
+
+Method ParseMethod(std::string_view method) {
+    if (method == "GET") return Method::GET;
+    if (method == "POST") return Method::POST;
+    throw BadRequestException("invalid http method");
+}
+
+size_t ParseContentLength(std::string_view value) {
+    size_t len;
+    auto [end, err] =
+        std::from_chars(value.data(), value.data() + value.size(), len);
+    if (err != std::errc() || end != value.data() + value.size()) {
+        throw BadRequestException(
+            std::format("invalid value for Content-Length: {}", value));
+    }
+    return len;
+}
+
+size_t ParseChunkSize(std::string_view line) {
+    // chunk extensions are allowed but ignored
+    line = line.substr(0, line.find(';'));
+    while (!line.empty() && IsSpace(line.back())) line.remove_suffix(1);
+    size_t len;
+    auto [end, err] =
+        std::from_chars(line.data(), line.data() + line.size(), len, 16);
+    if (line.empty() || err != std::errc() ||
+        end != line.data() + line.size()) {
+        throw BadRequestException(std::format("invalid chunk size: {}", line));
+    }
+    return len;
+}
+
+}  // namespace
+
+bool RequestParser::NextLine(std::string_view buf, Span* line) {
+    const char* nl = static_cast<const char*>(
+        std::memchr(buf.data() + scan_, '\n', buf.size() - scan_));
+    if (nl == nullptr) {
+        scan_ = buf.size();
+        return false;
+    }
+    size_t end = nl - buf.data();
+    if (end == pos_ || buf[end - 1] != '\r') {
+        throw BadRequestException("invalid line ending");
+    }
+    *line = Span{.pos = pos_, .len = end - 1 - pos_};
+    pos_ = scan_ = end + 1;
+    return true;
+}
+
+bool RequestParser::Parse(std::string_view buf, Request* req) {
+    while (state_ == State::RequestLine || state_ == State::Headers) {
+        Span line;
+        if (!NextLine(buf, &line)) {
+            if (buf.size() > kMaxHeadLen) {
+                throw BadRequestException("request head too long");
+            }
+            return false;
+        }
+        if (state_ == State::RequestLine) {
+            ParseRequestLine(buf, line);
+            state_ = State::Headers;
+        } else if (line.len > 0) {
+            ParseHeader(buf, line);
+        } else {
+            FinishHead(buf);
+            state_ = chunked_ ? State::ChunkSize : State::Body;
+        }
+    }
+
+    if (state_ == State::Body) {
+        if (buf.size() < head_len_ + body_len_) return false;
+        state_ = State::Done;
+    }
+    if (state_ != State::Done && !ParseChunks(buf)) return false;
+
+    req->method = method_;
+    req->path = path_.in(buf);
+    for (const auto& [k, v] : headers_) {
+        req->headers.add(k.in(buf), v.in(buf));
+    }
+    req->body = chunked_ ? std::string_view(body_)
+                         : buf.substr(head_len_, body_len_);
+    return true;
+}
+
+bool RequestParser::ParseChunks(std::string_view buf) {
+    while (state_ != State::Done) {
+        if (state_ == State::ChunkData) {
+            // wait for the data and the line ending after it
+            if (buf.size() < pos_ + chunk_len_ + 2) return false;
+            if (buf.substr(pos_ + chunk_len_, 2) != "\r\n") {
+                throw BadRequestException("invalid chunk");
+            }
+            body_.append(buf.substr(pos_, chunk_len_));
+            pos_ = scan_ = pos_ + chunk_len_ + 2;
+            state_ = State::ChunkSize;
+            continue;
+        }
+
+        Span line;
+        if (!NextLine(buf, &line)) {
+            if (buf.size() - pos_ > kMaxChunkLineLen) {
+                throw BadRequestException("chunk line too long");
+            }
+            return false;
+        }
+        if (state_ == State::ChunkSize) {
+            chunk_len_ = ParseChunkSize(line.in(buf));
+            if (chunk_len_ > max_body_len_ - body_.size()) {
+                throw PayloadTooLargeException(std::format(
+                    "chunked request body over the limit of {} bytes",
+                    max_body_len_));
+            }
+            if (chunk_len_ == 0) {
+                state_ = State::Trailers;
+                trailers_pos_ = pos_;
+            } else {
+                state_ = State::ChunkData;
+            }
+        } else if (line.len == 0) {
+            state_ = State::Done;
+        } else if (pos_ - trailers_pos_ > kMaxHeadLen) {
+            // trailers are allowed but ignored
+            throw BadRequestException("chunked trailers too long");
+        }
+    }
+    return true;
+}
+
+void RequestParser::ParseRequestLine(std::string_view buf, Span line) {
+    std::string_view s = line.in(buf);
+    if (s.empty()) throw BadRequestException("missing request line");
+
+    size_t method_end = s.find(' ');
+    if (method_end == std::string_view::npos) {
+        throw BadRequestException("missing http method");
+    }
+    method_ = ParseMethod(s.substr(0, method_end));
+
+    size_t path_end = s.find(' ', method_end + 1);
+    if (path_end == std::string_view::npos || path_end == method_end + 1) {
+        throw BadRequestException("missing http path");
+    }
+    path_ = Span{.pos = line.pos + method_end + 1,
+                 .len = path_end - method_end - 1};
+
+    std::string_view version = s.substr(path_end + 1);
+    if (version == "HTTP/1.1") keep_alive_ = http_1_1_ = true;
+    else if (version == "HTTP/1.0") keep_alive_ = false;
+    else throw BadRequestException("invalid http version");
+}
+
+void RequestParser::ParseHeader(std::string_view buf, Span line) {
+    std::string_view s = line.in(buf);
+    size_t colon = s.find(':');
+    if (colon == std::string_view::npos) {
+        throw BadRequestException("missing colon in http header");
+    }
+    if (colon == 0 || IsSpace(s[colon - 1])) {
+        throw BadRequestException("invalid http header name");
+    }
+    size_t from = colon + 1, to = s.size();
+    while (from < to && IsSpace(s[from])) from++;
+    while (to > from && IsSpace(s[to - 1])) to--;
+    headers_.push_back({Span{.pos = line.pos, .len = colon},
+                        Span{.pos = line.pos + from, .len = to - from}});
+}
+
+void RequestParser::FinishHead(std::string_view buf) {
+    head_len_ = pos_;
+    bool has_length = false;
+    for (const auto& [k, v] : headers_) {
+        std::string_view key = k.in(buf), value = v.in(buf);
+        if (EqualsIgnoreCase(key, "Content-Length")) {
+            size_t len = ParseContentLength(value);
+            // a proxy in front of us may have picked the other one
+            if (has_length && len != body_len_) {
+                throw BadRequestException("conflicting Content-Length");
+            }
+            body_len_ = len;
+            has_length = true;
+        } else if (EqualsIgnoreCase(key, "Transfer-Encoding")) {
+            if (!EqualsIgnoreCase(value, "chunked")) {
+                throw BadRequestException(
+                    std::format("unsupported Transfer-Encoding: {}", value));
+            }
+            chunked_ = true;
+        } else if (EqualsIgnoreCase(key, "Connection")) {
+            if (EqualsIgnoreCase(value, "close")) keep_alive_ = false;
+            if (EqualsIgnoreCase(value, "keep-alive")) keep_alive_ = true;
+        }
+    }
+    // ambiguous framing is how requests get smuggled past proxies
+    if (chunked_ && has_length) {
+        throw BadRequestException(
+            "both Content-Length and Transfer-Encoding are set");
+    }
+    // rejected before any of it is read, rather than buffered first
+    if (body_len_ > max_body_len_) {
+        throw PayloadTooLargeException(
+            std::format("request body of {} bytes is over the limit of {}",
+                        body_len_, max_body_len_));
+    }
+}
+
+}  // namespace http
+}  // namespace gabby
@@ -0,0 +1,130 @@
+#ifndef GABBY_HTTP_REQUEST_PARSER_H_
+#define GABBY_HTTP_REQUEST_PARSER_H_
+
+#include <cstddef>
+#include <limits>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "http/types.h"
+
+namespace gabby {
+namespace http {
+
+// an incremental http request parser. it's handed the bytes read from a
+// connection so far and picks up where it left off on each call, so it
+// can be driven from an event loop as data trickles in. the parsed
+// request points into the caller's buffer and nothing is copied, except
+// for chunked bodies, which are decoded into the parser.
+class RequestParser {
+public:
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    RequestParser() = default;
+    // the parser's own state is allocated with |alloc|
+    explicit RequestParser(allocator_type alloc)
+        : headers_(alloc), body_(alloc) {}
+
+    // parses as much of |buf| as possible. |buf| must start with the
+    // bytes passed to every call since the last Reset, but may have
+    // been moved in between. returns true once the full request has
+    // been read, and fills in |req| with views into |buf| and the
+    // parser. throws BadRequestException if the request is malformed,
+    // and PayloadTooLargeException as soon as its body is known to be
+    // over the limit.
+    bool Parse(std::string_view buf, Request* req);
+
+    // starts parsing a new request, with the same limit
+    void Reset() {
+        size_t max_body_len = max_body_len_;
+        *this = RequestParser(headers_.get_allocator());
+        max_body_len_ = max_body_len;
+    }
+
+    // the largest request body to accept, in bytes. unlimited by default.
+    void set_max_body_len(size_t len) { max_body_len_ = len; }
+
+    // how many more bytes of the request are known to be coming, given
+    // that |buffered| have been read, so that the rest of a large body
+    // can be read in a few large pieces. 0 if that isn't known yet.
+    size_t remaining(size_t buffered) const {
+        if (state_ != State::Body) return 0;
+        size_t len = head_len_ + body_len_;
+        return len > buffered ? len - buffered : 0;
+    }
+
+    // the number of bytes of the buffer taken up by the request,
+    // including the body. only valid once Parse has returned true.
+    size_t size() const { return chunked_ ? pos_ : head_len_ + body_len_; }
+
+    // whether the client wants to keep the connection open after this
+    // request. only valid once Parse has returned true.
+    bool keep_alive() const { return keep_alive_; }
+
+    // whether the request head has been fully read
+    bool head_parsed() const {
+        return state_ != State::RequestLine && state_ != State::Headers;
+    }
+
+    // whether the request was HTTP/1.1, and so the response can use
+    // chunked transfer encoding
+    bool http_1_1() const { return http_1_1_; }
+
+private:
+    // offsets into the buffer, since it may be reallocated between calls
+    struct Span {
+        size_t pos = 0;
+        size_t len = 0;
+        std::string_view in(std::string_view buf) const {
+            return buf.substr(pos, len);
+        }
+    };
+
+    enum class State {
+        RequestLine,
+        Headers,
+        Body,
+        ChunkSize,
+        ChunkData,
+        Trailers,
+        Done,
+    };
+
+    void ParseRequestLine(std::string_view buf, Span line);
+    void ParseHeader(std::string_view buf, Span line);
+    void FinishHead(std::string_view buf);
+
+    // reads the line starting at |pos_| into |line|, and returns false
+    // if it hasn't been fully read yet
+    bool NextLine(std::string_view buf, Span* line);
+
+    // returns false if more data is needed
+    bool ParseChunks(std::string_view buf);
+
+    State state_ = State::RequestLine;
+    size_t pos_ = 0;   // start of the next line
+    size_t scan_ = 0;  // where to resume looking for its end
+
+    Method method_;
+    Span path_;
+    std::pmr::vector<std::pair<Span, Span>> headers_;
+    size_t head_len_ = 0;
+    size_t body_len_ = 0;
+    bool keep_alive_ = false;
+    bool http_1_1_ = false;
+    size_t max_body_len_ = std::numeric_limits<size_t>::max();
+
+    // for chunked bodies
+    bool chunked_ = false;
+    size_t chunk_len_ = 0;
+    size_t trailers_pos_ = 0;
+    std::pmr::string body_;
+};
+
+}  // namespace http
+}  // namespace gabby
+
+#endif  // GABBY_HTTP_REQUEST_PARSER_H_
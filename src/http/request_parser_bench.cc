@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "http/request_parser.h"
+#include "test/bench.h"
+#include "utils/logging.h"
+
+namespace gabby {
+namespace http {
+
+namespace {
+
+constexpr std::string_view kRequest =
+    "POST /v1/chat/completions HTTP/1.1\r\n"
+    "Host: localhost:8080\r\n"
+    "User-Agent: Mozilla/5.0 (Macintosh; Intel Mac OS X 10_15_7) "
+    "AppleWebKit/537.36 (KHTML, like Gecko) Chrome/131.0.0.0\r\n"
+    "Accept: application/json\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Content-Type: application/json\r\n"
+    "Authorization: Bearer sk-0123456789abcdef\r\n"
+    "Content-Length: 2\r\n"
+    "\r\n"
+    "{}";
+
+// the fgets-based parser that RequestParser replaced, kept here as a
+// baseline
+namespace legacy {
+
+constexpr int kMaxLineLen = 256;
+
+struct Request {
+    Method method;
+    std::string path;
+    std::unordered_map<std::string, std::string> headers;
+};
+
+std::string_view ReadLine(char buf[], FILE* stream) {
+    ::fgets(buf, kMaxLineLen, stream);
+    if (::ferror(stream) || ::feof(stream)) {
+        throw BadRequestException("failed to read from stream");
+    }
+    int read = strnlen(buf, kMaxLineLen);
+    if (buf[read - 1] != '\n') {
+        throw BadRequestException("header line too long");
+    }
+    return std::string_view(buf, buf + read - 2);
+}
+
+void ParseRequest(Request* req, FILE* stream) {
+    char buf[kMaxLineLen];
+    std::string_view line = ReadLine(buf, stream);
+    int method_end = line.find(" ");
+    int path_end = line.find(" ", method_end + 1);
+    req->method = line.substr(0, method_end) == "GET" ? Method::GET
+                                                       : Method::POST;
+    req->path = std::string(line.substr(method_end + 1,
+                                        path_end - method_end - 1));
+    while (!(line = ReadLine(buf, stream)).empty()) {
+        int delim = line.find(": ");
+        req->headers.insert({std::string(line.substr(0, delim)),
+                             std::string(line.substr(delim + 2))});
+    }
+}
+
+}  // namespace legacy
+
+}  // namespace
+
+BENCHMARK(RequestParser, Legacy) {
+    std::string buf(kRequest);
+    state.SetBytesPerIteration(buf.size());
+    while (state.KeepRunning()) {
+        FILE* f = fmemopen(buf.data(), buf.size(), "r");
+        legacy::Request req;
+        legacy::ParseRequest(&req, f);
+        DoNotOptimize(req);
+        fclose(f);
+    }
+}
+
+BENCHMARK(RequestParser, Incremental) {
+    std::string buf(kRequest);
+    state.SetBytesPerIteration(buf.size());
+    while (state.KeepRunning()) {
+        RequestParser parser;
+        Request req;
+        parser.Parse(buf, &req);
+        DoNotOptimize(req);
+    }
+}
+
+BENCHMARK(RequestParser, IncrementalInSmallReads) {
+    // simulates a client whose request arrives over several reads
+    std::string buf(kRequest);
+    state.SetBytesPerIteration(buf.size());
+    while (state.KeepRunning()) {
+        RequestParser parser;
+        Request req;
+        size_t n = 0;
+        do {
+            n = std::min(n + 64, buf.size());
+        } while (!parser.Parse(std::string_view(buf).substr(0, n), &req));
+        DoNotOptimize(req);
+    }
+}
+
+}  // namespace http
+}  // namespace gabby
@@ -0,0 +1,256 @@
+#include "http/request_parser.h"
+
+#include <string>
+#include <string_view>
+
+#include "test/test.h"
+
+namespace gabby {
+namespace http {
+
+constexpr std::string_view kPostRequest =
+    "POST /v1/chat/completions HTTP/1.1\r\n"
+    "Host: localhost\r\n"
+    "content-length: 5\r\n"
+    "X-Padded:   a b  \r\n"
+    "\r\n"
+    "hello";
+
+TEST(RequestParser, ParseFullRequest) {
+    RequestParser parser;
+    Request req;
+    EXPECT_TRUE(parser.Parse(kPostRequest, &req));
+    EXPECT_EQ(Method::POST, req.method);
+    EXPECT_EQ("/v1/chat/completions", req.path);
+    EXPECT_EQ(3, req.headers.size());
+    EXPECT_EQ("localhost", req.headers.get("Host").value_or(""));
+    EXPECT_EQ("a b", req.headers.get("X-Padded").value_or(""));
+    EXPECT_EQ("hello", req.body);
+    EXPECT_EQ(kPostRequest.size(), parser.size());
+    EXPECT_TRUE(parser.keep_alive());
+}
+
+TEST(RequestParser, HeadersAreCaseInsensitive) {
+    RequestParser parser;
+    Request req;
+    EXPECT_TRUE(parser.Parse(kPostRequest, &req));
+    EXPECT_EQ("5", req.headers.get("Content-Length").value_or(""));
+    EXPECT_EQ("5", req.headers.get("CONTENT-LENGTH").value_or(""));
+    EXPECT_FALSE(req.headers.contains("Content-Type"));
+}
+
+TEST(RequestParser, ParseOneByteAtATime) {
+    // The buffer is copied on each step to make sure nothing holds on
+    // to pointers into an earlier one.
+    RequestParser parser;
+    Request req;
+    std::string buf;
+    for (size_t i = 0; i < kPostRequest.size() - 1; i++) {
+        buf.push_back(kPostRequest[i]);
+        std::string copy = buf;
+        EXPECT_FALSE(parser.Parse(copy, &req));
+    }
+    buf.push_back(kPostRequest.back());
+    EXPECT_TRUE(parser.Parse(buf, &req));
+    EXPECT_EQ("/v1/chat/completions", req.path);
+    EXPECT_EQ("a b", req.headers.get("x-padded").value_or(""));
+    EXPECT_EQ("hello", req.body);
+}
+
+TEST(RequestParser, PipelinedRequests) {
+    std::string buf = std::string(kPostRequest) +
+                      "GET /healthz HTTP/1.0\r\n\r\n";
+    RequestParser parser;
+    Request req;
+    EXPECT_TRUE(parser.Parse(buf, &req));
+    EXPECT_EQ(kPostRequest.size(), parser.size());
+
+    buf.erase(0, parser.size());
+    parser.Reset();
+    req = Request{};
+    EXPECT_TRUE(parser.Parse(buf, &req));
+    EXPECT_EQ(Method::GET, req.method);
+    EXPECT_EQ("/healthz", req.path);
+    EXPECT_EQ("", req.body);
+    EXPECT_FALSE(parser.keep_alive());
+}
+
+TEST(RequestParser, LongHeaderLine) {
+    std::string value(4096, 'x');
+    std::string buf =
+        "GET / HTTP/1.1\r\nUser-Agent: " + value + "\r\n\r\n";
+    RequestParser parser;
+    Request req;
+    EXPECT_TRUE(parser.Parse(buf, &req));
+    EXPECT_EQ(value, req.headers.get("user-agent").value_or(""));
+}
+
+TEST(RequestParser, ConnectionHeader) {
+    RequestParser parser;
+    Request req;
+    EXPECT_TRUE(parser.Parse(
+        "GET / HTTP/1.1\r\nConnection: Close\r\n\r\n", &req));
+    EXPECT_FALSE(parser.keep_alive());
+
+    parser.Reset();
+    req = Request{};
+    EXPECT_TRUE(parser.Parse(
+        "GET / HTTP/1.0\r\nConnection: keep-alive\r\n\r\n", &req));
+    EXPECT_TRUE(parser.keep_alive());
+}
+
+constexpr std::string_view kChunkedRequest =
+    "POST /v1/chat/completions HTTP/1.1\r\n"
+    "Transfer-Encoding: chunked\r\n"
+    "\r\n"
+    "5\r\nhello\r\n"
+    "1;ext=1\r\n \r\n"
+    "A\r\n0123456789\r\n"
+    "0\r\n"
+    "X-Trailer: ignored\r\n"
+    "\r\n";
+
+TEST(RequestParser, ChunkedBody) {
+    RequestParser parser;
+    Request req;
+    EXPECT_TRUE(parser.Parse(kChunkedRequest, &req));
+    EXPECT_EQ("hello 0123456789", req.body);
+    EXPECT_EQ(kChunkedRequest.size(), parser.size());
+    EXPECT_TRUE(parser.http_1_1());
+}
+
+TEST(RequestParser, ChunkedBodyOneByteAtATime) {
+    std::string pipelined =
+        std::string(kChunkedRequest) + "GET / HTTP/1.1\r\n\r\n";
+    RequestParser parser;
+    Request req;
+    std::string buf;
+    size_t i = 0;
+    for (; i < kChunkedRequest.size() - 1; i++) {
+        buf.push_back(pipelined[i]);
+        std::string copy = buf;
+        EXPECT_FALSE(parser.Parse(copy, &req));
+    }
+    // The request should end exactly at the end of the trailers.
+    buf = pipelined;
+    EXPECT_TRUE(parser.Parse(buf, &req));
+    EXPECT_EQ("hello 0123456789", req.body);
+    EXPECT_EQ(kChunkedRequest.size(), parser.size());
+}
+
+bool Rejects(std::string_view buf) {
+    RequestParser parser;
+    Request req;
+    try {
+        parser.Parse(buf, &req);
+    } catch (const BadRequestException& e) {
+        return true;
+    }
+    return false;
+}
+
+TEST(RequestParser, RejectsMalformedRequests) {
+    EXPECT_TRUE(Rejects("\r\n"));
+    EXPECT_TRUE(Rejects("GET\r\n"));
+    EXPECT_TRUE(Rejects("PUT / HTTP/1.1\r\n"));
+    EXPECT_TRUE(Rejects("GET / HTTP/2\r\n"));
+    EXPECT_TRUE(Rejects("GET / HTTP/1.1\n"));
+    EXPECT_TRUE(Rejects("GET / HTTP/1.1\r\nfoo\r\n"));
+    EXPECT_TRUE(Rejects("GET / HTTP/1.1\r\nfoo : bar\r\n"));
+    EXPECT_TRUE(Rejects("GET / HTTP/1.1\r\nContent-Length: x\r\n\r\n"));
+    EXPECT_TRUE(Rejects(std::string(32 * 1024, 'x')));
+    EXPECT_TRUE(Rejects(
+        "POST / HTTP/1.1\r\nContent-Length: 1\r\n"
+        "Content-Length: 2\r\n\r\nab"));
+    EXPECT_FALSE(Rejects(
+        "POST / HTTP/1.1\r\nContent-Length: 2\r\n"
+        "content-length: 2\r\n\r\nab"));
+    EXPECT_FALSE(Rejects("GET / HTTP/1.1\r\nfoo:bar\r\n"));
+}
+
+TEST(RequestParser, RejectsMalformedChunks) {
+    constexpr std::string_view kHead =
+        "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n";
+    auto chunked = [&kHead](std::string_view body) {
+        return std::string(kHead) + std::string(body);
+    };
+    EXPECT_TRUE(Rejects(chunked("x\r\n")));
+    EXPECT_TRUE(Rejects(chunked("\r\n")));
+    EXPECT_TRUE(Rejects(chunked("-1\r\n")));
+    EXPECT_TRUE(Rejects(chunked("ffffffffffffffffff\r\n")));
+    EXPECT_TRUE(Rejects(chunked("2\r\nabc\r\n")));
+    EXPECT_TRUE(Rejects(chunked(std::string(2048, '1'))));
+    EXPECT_TRUE(Rejects(
+        "POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\n"));
+    EXPECT_TRUE(Rejects(
+        "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n"
+        "Content-Length: 5\r\n\r\n"));
+    EXPECT_FALSE(Rejects(chunked("2\r\nab\r\n")));
+}
+
+TEST(RequestParser, RejectsBodiesOverTheLimit) {
+    // Arrange
+    auto too_large = [](std::string_view buf) {
+        RequestParser parser;
+        parser.set_max_body_len(4);
+        Request req;
+        try {
+            parser.Parse(buf, &req);
+        } catch (const PayloadTooLargeException& e) {
+            return true;
+        }
+        return false;
+    };
+
+    // Act & Assert
+    // Rejected as soon as the head is read, before the body arrives.
+    EXPECT_TRUE(too_large("POST / HTTP/1.1\r\nContent-Length: 5\r\n\r\n"));
+    EXPECT_TRUE(too_large(
+        "POST / HTTP/1.1\r\nContent-Length: 2000000000\r\n\r\n"));
+    EXPECT_TRUE(too_large(
+        "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+        "3\r\nabc\r\n2\r\n"));
+    EXPECT_FALSE(too_large(
+        "POST / HTTP/1.1\r\nContent-Length: 4\r\n\r\nabcd"));
+    EXPECT_FALSE(too_large(
+        "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+        "3\r\nabc\r\n1\r\nd\r\n0\r\n\r\n"));
+}
+
+TEST(RequestParser, ResetKeepsTheLimit) {
+    // Arrange
+    RequestParser parser;
+    parser.set_max_body_len(4);
+    Request req;
+    parser.Parse("GET / HTTP/1.1\r\n\r\n", &req);
+
+    // Act
+    parser.Reset();
+
+    // Assert
+    bool rejected = false;
+    try {
+        parser.Parse("POST / HTTP/1.1\r\nContent-Length: 5\r\n\r\n", &req);
+    } catch (const PayloadTooLargeException& e) {
+        rejected = true;
+    }
+    EXPECT_TRUE(rejected);
+}
+
+TEST(RequestParser, Remaining) {
+    // Arrange
+    RequestParser parser;
+    Request req;
+    std::string_view head = "POST / HTTP/1.1\r\nContent-Length: 100\r\n\r\n";
+
+    // Act
+    bool done = parser.Parse(head, &req);
+
+    // Assert
+    EXPECT_FALSE(done);
+    EXPECT_EQ(100, parser.remaining(head.size()));
+    EXPECT_EQ(40, parser.remaining(head.size() + 60));
+}
+
+}  // namespace http
+}  // namespace gabby
@@ -1,34 +1,184 @@
 #include "http/router.h"
 
+#include <algorithm>
+#include <format>
+#include <stdexcept>
+
 #include "utils/logging.h"
 
 namespace gabby {
 namespace http {
 
-void Router::handle(Request& req, ResponseWriter& resp) {
-    LOG(DEBUG) << "handling path " << req.path;
-    std::smatch m;
-    for (auto& [pat, re, h] : routes_) {
-        LOG(DEBUG) << "testing handler " << pat;
-        if (std::regex_match(req.path, m, re)) {
-            return h(req, resp);
+namespace {
+
+bool IsRegex(std::string_view pat) {
+    return pat.find_first_of("*+?[]()|^$\\") != std::string_view::npos;
+}
+
+bool HasParams(std::string_view pat) {
+    return pat.find('{') != std::string_view::npos;
+}
+
+// splits the first segment off of |*path|, which must start with a '/'
+std::string_view NextSegment(std::string_view* path) {
+    path->remove_prefix(1);
+    size_t end = std::min(path->find('/'), path->size());
+    std::string_view segment = path->substr(0, end);
+    path->remove_prefix(end);
+    return segment;
+}
+
+}  // namespace
+
+const Handler* Router::Endpoint::find(Method method) const {
+    for (const auto& [m, handler] : methods) {
+        if (m == method) return &handler;
+    }
+    return any ? &any : nullptr;
+}
+
+void Router::Endpoint::add(std::optional<Method> method, Handler handler) {
+    if (!method.has_value()) {
+        if (any) throw std::invalid_argument("duplicate route");
+        any = std::move(handler);
+        return;
+    }
+    for (const auto& [m, h] : methods) {
+        if (m == *method) {
+            throw std::invalid_argument(
+                std::format("duplicate route for {}", to_string(*method)));
+        }
+    }
+    methods.emplace_back(*method, std::move(handler));
+    if (!allow.empty()) allow.append(", ");
+    allow.append(to_string(*method));
+}
+
+Router::Router(Builder builder) {
+    for (auto& [method, pat, handler] : builder.routes_) {
+        if (IsRegex(pat)) {
+            auto it = std::find_if(
+                regexes_.begin(), regexes_.end(),
+                [&pat](const RegexRoute& route) { return route.pat == pat; });
+            if (it == regexes_.end()) {
+                regexes_.push_back({.pat = pat, .re = std::regex(pat)});
+                it = regexes_.end() - 1;
+                it->endpoint.route = pat;
+            }
+            it->endpoint.add(method, std::move(handler));
+        } else if (pat.empty() || pat[0] != '/') {
+            throw std::invalid_argument(
+                std::format("route must start with '/': {}", pat));
+        } else if (HasParams(pat)) {
+            AddParamRoute(pat, method, std::move(handler));
+        } else {
+            Endpoint& endpoint = exact_[pat];
+            endpoint.route = pat;
+            endpoint.add(method, std::move(handler));
         }
     }
-    LOG(WARN) << "no handler for path " << req.path;
-    resp.WriteStatus(StatusCode::NotFound);
+}
+
+void Router::AddParamRoute(std::string_view pat, std::optional<Method> method,
+                           Handler handler) {
+    Node* node = &root_;
+    for (std::string_view rest = pat; !rest.empty();) {
+        std::string_view segment = NextSegment(&rest);
+        if (!segment.starts_with('{')) {
+            auto& child = node->children[std::string(segment)];
+            if (!child) child = std::make_unique<Node>();
+            node = child.get();
+            continue;
+        }
+        if (!segment.ends_with('}') || segment.size() == 2) {
+            throw std::invalid_argument(
+                std::format("invalid path parameter in route: {}", pat));
+        }
+        std::string_view name = segment.substr(1, segment.size() - 2);
+        if (!node->param) {
+            node->param = std::make_unique<Node>();
+            node->param_name = name;
+        } else if (node->param_name != name) {
+            throw std::invalid_argument(std::format(
+                "conflicting path parameters {{{}}} and {{{}}} in route: {}",
+                node->param_name, name, pat));
+        }
+        node = node->param.get();
+    }
+    if (!node->endpoint) {
+        node->endpoint.emplace();
+        node->endpoint->route = pat;
+    }
+    node->endpoint->add(method, std::move(handler));
+}
+
+const Router::Endpoint* Router::MatchTrie(const Node& node,
+                                          std::string_view path,
+                                          Request& req) const {
+    if (path.empty()) return node.endpoint ? &*node.endpoint : nullptr;
+    std::string_view segment = NextSegment(&path);
+    if (auto it = node.children.find(segment); it != node.children.end()) {
+        if (auto* endpoint = MatchTrie(*it->second, path, req)) {
+            return endpoint;
+        }
+    }
+    if (node.param && !segment.empty()) {
+        req.params.add(node.param_name, segment);
+        if (auto* endpoint = MatchTrie(*node.param, path, req)) {
+            return endpoint;
+        }
+        req.params.pop();
+    }
+    return nullptr;
+}
+
+const Router::Endpoint* Router::Match(std::string_view path,
+                                      Request& req) const {
+    path = path.substr(0, path.find('?'));
+    if (auto it = exact_.find(path); it != exact_.end()) return &it->second;
+    if (!path.empty() && path[0] == '/') {
+        if (auto* endpoint = MatchTrie(root_, path, req)) return endpoint;
+    }
+    for (const auto& [pat, re, endpoint] : regexes_) {
+        if (std::regex_match(path.begin(), path.end(), re)) return &endpoint;
+    }
+    return nullptr;
+}
+
+void Router::handle(Request& req, ResponseWriter& resp) const {
+    const Endpoint* endpoint = Match(req.path, req);
+    if (endpoint == nullptr) {
+        LOG(WARN) << "no handler for path " << req.path;
+        resp.WriteStatus(StatusCode::NotFound);
+        return;
+    }
+    req.route = endpoint->route;
+    const Handler* handler = endpoint->find(req.method);
+    if (handler == nullptr) {
+        LOG(WARN) << "no handler for " << req.method << " " << req.path;
+        resp.WriteStatus(StatusCode::MethodNotAllowed);
+        resp.WriteHeader("Allow", endpoint->allow);
+        return;
+    }
+    (*handler)(req, resp);
 }
 
 Router::Builder& Router::Builder::route(std::string pat, Handler handler) {
-    routes_.push_back(
-        {.pat = pat, .re = std::regex(pat), .handler = std::move(handler)});
+    routes_.emplace_back(std::nullopt, std::move(pat), std::move(handler));
+    return *this;
+}
+
+Router::Builder& Router::Builder::route(Method method, std::string pat,
+                                        Handler handler) {
+    routes_.emplace_back(method, std::move(pat), std::move(handler));
     return *this;
 }
 
 Handler Router::Builder::build() {
-    Router router(std::move(routes_));
-    return [router = std::move(router)](Request& req,
-                                        ResponseWriter& resp) mutable {
-        router.handle(req, resp);
+    // handlers must be copyable, and the router isn't
+    auto router = std::make_shared<const Router>(std::move(*this));
+    return [router](Request& req, ResponseWriter& resp) {
+        router->handle(req, resp);
     };
 }
 
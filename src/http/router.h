@@ -1,7 +1,15 @@
 #ifndef GABBY_HTTP_ROUTER_H_
 #define GABBY_HTTP_ROUTER_H_
 
+#include <functional>
+#include <memory>
+#include <optional>
 #include <regex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "http/types.h"
@@ -9,30 +17,84 @@
 namespace gabby {
 namespace http {
 
+// dispatches requests to handlers by path and method. the builder
+// compiles routes into a dispatch table:
+//
+// - literal paths, like /healthz, are looked up in a hash table.
+// - paths with parameters, like /v1/models/{id}, are matched against a
+//   trie, one segment at a time. literal segments take precedence over
+//   parameters, and the values are added to Request::params.
+// - patterns that use any of *+?[]()|^$\ are regexes, and are only
+//   tried, in the order they were added, if nothing else matches.
+//
+// a route without a method matches any method. if a path matches but
+// the method doesn't, the response is 405 Method Not Allowed.
 class Router {
 public:
-    struct Route {
-        std::string pat;
-        std::regex re;
-        Handler handler;
-    };
+    // the handlers for a single path
+    struct Endpoint {
+        std::vector<std::pair<Method, Handler>> methods;
+        Handler any;
+        std::string allow;  // the value of the Allow header for a 405
+        std::string route;  // the pattern it was added with
 
-    Router(std::vector<Route>&& routes) : routes_(routes) {}
+        const Handler* find(Method method) const;
+        void add(std::optional<Method> method, Handler handler);
+    };
 
     class Builder {
     public:
         Builder& route(std::string pat, Handler handler);
+        Builder& route(Method method, std::string pat, Handler handler);
         Handler build();
 
     private:
-        std::vector<Route> routes_;
+        friend class Router;
+        std::vector<std::tuple<std::optional<Method>, std::string, Handler>>
+            routes_;
     };
 
     static Builder builder() { return Builder(); }
-    void handle(Request& request, ResponseWriter& response);
+
+    explicit Router(Builder builder);
+
+    void handle(Request& request, ResponseWriter& response) const;
 
 private:
-    std::vector<Route> routes_;
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view s) const {
+            return std::hash<std::string_view>{}(s);
+        }
+    };
+    template <typename T>
+    using StringMap =
+        std::unordered_map<std::string, T, StringHash, std::equal_to<>>;
+
+    struct Node {
+        StringMap<std::unique_ptr<Node>> children;
+        std::unique_ptr<Node> param;
+        std::string param_name;
+        std::optional<Endpoint> endpoint;
+    };
+
+    struct RegexRoute {
+        std::string pat;
+        std::regex re;
+        Endpoint endpoint;
+    };
+
+    void AddParamRoute(std::string_view pat, std::optional<Method> method,
+                       Handler handler);
+
+    // returns the endpoint for |path|, adding any parameters to |req|
+    const Endpoint* Match(std::string_view path, Request& req) const;
+    const Endpoint* MatchTrie(const Node& node, std::string_view path,
+                              Request& req) const;
+
+    StringMap<Endpoint> exact_;
+    Node root_;
+    std::vector<RegexRoute> regexes_;
 };
 
 }  // namespace http
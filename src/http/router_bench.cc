@@ -0,0 +1,126 @@
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "http/router.h"
+#include "test/bench.h"
+
+namespace gabby {
+namespace http {
+
+namespace {
+
+// roughly the shape of the openai api
+const std::vector<std::string> kRoutes = {
+    "/healthz",
+    "/statusz",
+    "/v1/models",
+    "/v1/models/{id}",
+    "/v1/chat/completions",
+    "/v1/chat/completions/{id}",
+    "/v1/completions",
+    "/v1/embeddings",
+    "/v1/moderations",
+    "/v1/images/generations",
+    "/v1/audio/speech",
+    "/v1/audio/transcriptions",
+    "/v1/files",
+    "/v1/files/{id}",
+    "/v1/files/{id}/content",
+    "/v1/uploads",
+    "/v1/uploads/{id}/parts",
+    "/v1/batches",
+    "/v1/batches/{id}",
+    "/v1/batches/{id}/cancel",
+    "/v1/fine_tuning/jobs",
+    "/v1/fine_tuning/jobs/{id}",
+    "/v1/fine_tuning/jobs/{id}/events",
+    "/v1/assistants",
+    "/v1/assistants/{id}",
+    "/v1/threads",
+    "/v1/threads/{id}",
+    "/v1/threads/{id}/messages",
+    "/v1/threads/{id}/messages/{message_id}",
+    "/v1/threads/{id}/runs",
+    "/v1/threads/{id}/runs/{run_id}",
+    "/v1/threads/{id}/runs/{run_id}/steps",
+    "/v1/vector_stores",
+    "/v1/vector_stores/{id}",
+    "/v1/vector_stores/{id}/files",
+    "/v1/vector_stores/{id}/files/{file_id}",
+};
+
+constexpr std::string_view kExactPath = "/v1/chat/completions";
+constexpr std::string_view kParamPath = "/v1/threads/thread_abc/runs/run_123";
+constexpr std::string_view kMissingPath = "/v2/chat/completions";
+
+class NullResponseWriter : public ResponseWriter {
+public:
+    void Flush() override {}
+    void WriteStatus(StatusCode code) override { status_ = code; }
+    void WriteHeader(std::string_view key, std::string_view value) override {}
+    void WriteData(std::string_view data) override {}
+    std::optional<StatusCode> status() override { return status_; }
+
+private:
+    std::optional<StatusCode> status_;
+};
+
+void Noop(Request& req, ResponseWriter& resp) {
+    resp.WriteStatus(StatusCode::OK);
+}
+
+// the regex router that the compiled one replaced, kept here as a
+// baseline
+Handler LegacyRouter() {
+    std::vector<std::regex> routes;
+    for (const std::string& route : kRoutes) {
+        static const std::regex kParam(R"(\{[^}]*\})");
+        routes.emplace_back(std::regex_replace(route, kParam, "[^/]+"));
+    }
+    return [routes](Request& req, ResponseWriter& resp) {
+        for (const std::regex& re : routes) {
+            if (std::regex_match(req.path.begin(), req.path.end(), re)) {
+                return Noop(req, resp);
+            }
+        }
+        resp.WriteStatus(StatusCode::NotFound);
+    };
+}
+
+Handler CompiledRouter() {
+    auto builder = Router::builder();
+    for (const std::string& route : kRoutes) {
+        builder.route(Method::POST, route, Noop);
+    }
+    return builder.build();
+}
+
+void Route(BenchmarkState& state, Handler handler, std::string_view path) {
+    NullResponseWriter resp;
+    while (state.KeepRunning()) {
+        Request req{.method = Method::POST, .path = path};
+        handler(req, resp);
+        DoNotOptimize(resp);
+    }
+}
+
+}  // namespace
+
+BENCHMARK(Router, LegacyExact) { Route(state, LegacyRouter(), kExactPath); }
+BENCHMARK(Router, LegacyParams) { Route(state, LegacyRouter(), kParamPath); }
+BENCHMARK(Router, LegacyMiss) { Route(state, LegacyRouter(), kMissingPath); }
+
+BENCHMARK(Router, CompiledExact) {
+    Route(state, CompiledRouter(), kExactPath);
+}
+BENCHMARK(Router, CompiledParams) {
+    Route(state, CompiledRouter(), kParamPath);
+}
+BENCHMARK(Router, CompiledMiss) {
+    Route(state, CompiledRouter(), kMissingPath);
+}
+
+}  // namespace http
+}  // namespace gabby
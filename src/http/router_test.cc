@@ -1,5 +1,6 @@
 #include "http/router.h"
 
+#include <stdexcept>
 #include <string>
 #include <string_view>
 
@@ -20,8 +21,8 @@ Handler ErrorHandler = SimpleHandler(StatusCode::InternalServerError);
 
 struct SimpleResponseWriter : public http::ResponseWriter {
     void WriteStatus(http::StatusCode code) override { this->code = code; }
-    void WriteHeader(std::string key, std::string value) override {
-        headers_[key] = value;
+    void WriteHeader(std::string_view key, std::string_view value) override {
+        headers_[std::string(key)] = value;
     }
     void WriteData(std::string_view data) override { this->data = data; }
     void Flush() override {}
@@ -65,5 +66,121 @@ TEST(Router, FirstMatchOnlyHandled) {
     EXPECT_EQ("success", resp.data);
 }
 
+TEST(Router, ExactMatchBeforeRegex) {
+    Request req{.addr = "1.2.3.4", .path = "/foo"};
+    SimpleResponseWriter resp;
+    auto handler = Router::builder()
+                       .route("/f.*", ErrorHandler)
+                       .route("/foo", SimpleHandler(StatusCode::OK))
+                       .build();
+    handler(req, resp);
+    EXPECT_EQ(StatusCode::OK, resp.code);
+}
+
+TEST(Router, PathParams) {
+    // Arrange
+    Request req{.addr = "1.2.3.4", .path = "/v1/models/llama/files/x.json"};
+    SimpleResponseWriter resp;
+    std::string model, file;
+    auto handler =
+        Router::builder()
+            .route("/v1/models/{id}", ErrorHandler)
+            .route("/v1/models/{id}/files/{file}",
+                   [&model, &file](Request& req, ResponseWriter& resp) {
+                       model = req.params.get("id").value_or("");
+                       file = req.params.get("file").value_or("");
+                       resp.WriteStatus(StatusCode::OK);
+                   })
+            .build();
+
+    // Act
+    handler(req, resp);
+
+    // Assert
+    EXPECT_EQ(StatusCode::OK, resp.code);
+    EXPECT_EQ("llama", model);
+    EXPECT_EQ("x.json", file);
+}
+
+TEST(Router, LiteralSegmentsBeforeParams) {
+    Request req{.addr = "1.2.3.4", .path = "/v1/models/default/files"};
+    SimpleResponseWriter resp;
+    auto handler = Router::builder()
+                       .route("/v1/models/{id}/files", ErrorHandler)
+                       .route("/v1/{kind}/default/files", ErrorHandler)
+                       .route("/v1/models/default/{x}",
+                              SimpleHandler(StatusCode::OK))
+                       .build();
+    handler(req, resp);
+    EXPECT_EQ(StatusCode::OK, resp.code);
+}
+
+TEST(Router, ParamsMustBeNonEmpty) {
+    Request req{.addr = "1.2.3.4", .path = "/v1/models/"};
+    SimpleResponseWriter resp;
+    auto handler =
+        Router::builder().route("/v1/models/{id}", ErrorHandler).build();
+    handler(req, resp);
+    EXPECT_EQ(StatusCode::NotFound, resp.code);
+}
+
+TEST(Router, IgnoresQueryString) {
+    Request req{.addr = "1.2.3.4", .path = "/healthz?verbose=1"};
+    SimpleResponseWriter resp;
+    auto handler = Router::builder()
+                       .route("/healthz", SimpleHandler(StatusCode::OK))
+                       .build();
+    handler(req, resp);
+    EXPECT_EQ(StatusCode::OK, resp.code);
+}
+
+TEST(Router, MatchesMethods) {
+    // Arrange
+    Request get{.addr = "1.2.3.4", .method = Method::GET, .path = "/foo"};
+    Request post{.addr = "1.2.3.4", .method = Method::POST, .path = "/foo"};
+    SimpleResponseWriter get_resp, post_resp;
+    auto handler = Router::builder()
+                       .route(Method::GET, "/foo", SimpleHandler(StatusCode::OK))
+                       .route(Method::POST, "/foo",
+                              SimpleHandler(StatusCode::OK, "posted"))
+                       .build();
+
+    // Act
+    handler(get, get_resp);
+    handler(post, post_resp);
+
+    // Assert
+    EXPECT_EQ("", get_resp.data);
+    EXPECT_EQ("posted", post_resp.data);
+}
+
+TEST(Router, WrongMethodReturnsMethodNotAllowed) {
+    Request req{.addr = "1.2.3.4", .method = Method::GET, .path = "/v1/{x}"};
+    SimpleResponseWriter resp;
+    auto handler = Router::builder()
+                       .route(Method::POST, "/v1/{id}", ErrorHandler)
+                       .build();
+    handler(req, resp);
+    EXPECT_EQ(StatusCode::MethodNotAllowed, resp.code);
+    EXPECT_EQ("POST", resp.headers_["Allow"]);
+}
+
+TEST(Router, RejectsInvalidRoutes) {
+    for (std::string pat : {"foo", "/foo/{}", "/foo/{id", "/{a}/x", "/foo"}) {
+        bool threw = false;
+        try {
+            // The last one is a duplicate.
+            Router::builder()
+                .route("/{b}/y", ErrorHandler)
+                .route("/foo", ErrorHandler)
+                .route(pat, ErrorHandler)
+                .build();
+        } catch (const std::invalid_argument& e) {
+            threw = true;
+        }
+        EXPECT_TRUE(threw);
+    }
+}
+
 }  // namespace http
 }  // namespace gabby
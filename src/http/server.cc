@@ -1,11 +1,15 @@
 #include "http/server.h"
 
 #include <arpa/inet.h>
+#include <pthread.h>
+#include <sched.h>
 #include <netinet/in.h>
-#include <sys/poll.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cerrno>
 #include <chrono>
@@ -13,239 +17,246 @@
 #include <format>
 #include <optional>
 #include <stdexcept>
+#include <string_view>
 #include <thread>
+#include <unordered_map>
+#include <vector>
 
+#include "http/socket_writer.h"
 #include "utils/logging.h"
+#include "utils/metrics.h"
 
 namespace gabby {
 namespace http {
 
 namespace {
 
-constexpr int kMaxLineLen = 256;
-
-std::string_view ReadLine(char buf[], FILE* stream) {
-    ::fgets(buf, kMaxLineLen, stream);
-    if (::ferror(stream) && (errno == EAGAIN || errno == EWOULDBLOCK)) {
-        throw TimeoutException{};
-    }
-    if (::ferror(stream)) {
-        throw BadRequestException("failed to read from stream");
-    }
-    if (::feof(stream)) {
-        throw BadRequestException("unexpected eof");
-    }
-    int read = strnlen(buf, kMaxLineLen);
-    assert(read > 0);
-    if (buf[read - 1] != '\n') {
-        throw BadRequestException("header line too long");
-    }
-    if (read >= 2 && buf[read - 2] == '\r') {
-        return std::string_view(buf, buf + read - 2);
+OwnedFd ServerSocket(int domain, bool reuse_port) {
+    int fd = socket(domain, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) throw SystemError(errno);
+    if (domain == AF_UNIX) return Own(fd);
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (reuse_port &&
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse)) < 0) {
+        throw SystemError(errno);
     }
-    throw BadRequestException("invalid line ending");
+    return Own(fd);
 }
 
-Method ParseMethod(const std::string_view request_line) {
-    int to = request_line.find(" ");
-    if (to == std::string_view::npos) {
-        throw BadRequestException("missing http method");
+// binds and listens on |*port|, and updates it with the bound port
+OwnedFd Listen(int* port, bool reuse_port) {
+    OwnedFd sock = ServerSocket(AF_INET, reuse_port);
+    struct sockaddr_in addr;
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(*port);
+    if (::bind(*sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        throw SystemError(errno);
     }
-    std::string_view method_str(request_line.begin(),
-                                request_line.begin() + to);
-    Method method;
-    if (method_str == "GET") {
-        method = Method::GET;
-    } else if (method_str == "POST") {
-        method = Method::POST;
-    } else {
-        throw BadRequestException("invalid http method");
+    if (::listen(*sock, SOMAXCONN) < 0) {
+        throw SystemError(errno);
     }
-    LOG(DEBUG) << "parsed method: " << method;
-    return method;
+    socklen_t len = sizeof(addr);
+    getsockname(*sock, (struct sockaddr*)&addr, &len);
+    *port = ntohs(addr.sin_port);
+    return sock;
 }
 
-std::string ParsePath(const std::string_view request_line) {
-    int from = request_line.find(" ");
-    int to = request_line.find(" ", from + 1);
-    if (from == std::string_view::npos || to == std::string_view::npos) {
-        throw BadRequestException("missing http path");
+// binds and listens on the unix domain socket at |path|
+OwnedFd ListenUnix(const std::string& path) {
+    struct sockaddr_un addr;
+    socklen_t len = UnixSocketAddress(path, &addr);
+    // a socket file left behind by a server that didn't get to clean up
+    // would keep us from binding
+    struct stat st;
+    if (!path.starts_with('@') && stat(path.c_str(), &st) == 0 &&
+        S_ISSOCK(st.st_mode)) {
+        unlink(path.c_str());
     }
-    std::string path(request_line.begin() + from + 1,
-                     request_line.begin() + to);
-    LOG(DEBUG) << "parsed path: " << path;
-    return path;
-}
-
-std::pair<std::string, std::string> ParseHeader(const std::string_view line) {
-    int delim = line.find(": ");
-    if (delim == std::string_view::npos) {
-        throw BadRequestException("missing colon in http header");
+    OwnedFd sock = ServerSocket(AF_UNIX, false);
+    if (::bind(*sock, (struct sockaddr*)&addr, len) < 0) {
+        throw SystemError(errno);
+    }
+    if (::listen(*sock, SOMAXCONN) < 0) {
+        throw SystemError(errno);
     }
-    std::string k(line.begin(), line.begin() + delim);
-    std::string v(line.begin() + delim + 2, line.end());
-    LOG(DEBUG) << "parsed header: " << std::format("[{}: {}]", k, v);
-    return {k, v};
+    return sock;
 }
 
-void ParseRequest(Request* req, FILE* stream) {
-    char buf[kMaxLineLen];
-    std::string_view line = ReadLine(buf, stream);
-    if (line.empty()) throw BadRequestException("missing request line");
-    req->method = ParseMethod(line);
-    req->path = ParsePath(line);
-    while (!(line = ReadLine(buf, stream)).empty()) {
-        req->headers.insert(ParseHeader(line));
+// returns the cpus that shard |id| of |n| should run on: its share of
+// the ones we're allowed to use
+std::vector<int> CpusForShard(int id, int n) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) < 0) throw SystemError(errno);
+    std::vector<int> cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
     }
-    LOG(DEBUG) << "parsed request: " << *req;
-    req->stream = stream;
+    int count = cpus.size();
+    if (n >= count) return {cpus[id % count]};
+    return std::vector<int>(cpus.begin() + id * count / n,
+                            cpus.begin() + (id + 1) * count / n);
 }
 
-void SetTimeout(int fd, int millis, int mask) {
-    struct timeval timeout;
-    timeout.tv_sec = millis / 1000;
-    timeout.tv_usec = (millis % 1000) * 1000;
-    if (setsockopt(fd, SOL_SOCKET, mask, &timeout, sizeof(timeout)) < 0) {
-        throw SystemError(errno);
-    }
+// restricts the calling thread to |cpus|, if there are any
+void PinThread(const std::vector<int>& cpus) {
+    if (cpus.empty()) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) CPU_SET(cpu, &set);
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (err != 0) LOG(WARN) << "failed to pin thread: " << strerror(err);
 }
 
-void MustSend(ResponseWriter& resp, StatusCode status) noexcept {
-    if (resp.status().has_value()) {
+// replaces whatever the handler has written with |status|, if nothing
+// has been sent to the client yet. returns false if it's too late.
+bool MustSend(SocketWriter& resp, StatusCode status) noexcept {
+    if (resp.head_sent()) {
         LOG(ERROR) << "can't send " << status << ", already sent "
                    << *resp.status();
-        return;
+        return false;
     }
     try {
+        resp.Reset();
         resp.WriteStatus(status);
-        resp.Flush();
     } catch (std::exception& e) {
         LOG(WARN) << "failed to send " << status << ": " << e.what();
-        return;
     }
+    return true;
 }
 
-OwnedFd ServerSocket() {
-    int fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (fd < 0) throw SystemError(errno);
-    int reuse = 1;
-    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
-    return Own(fd);
+// renders the complete response sent to requests that are shed. it's
+// rendered once up front so that shedding stays cheap under load.
+std::string RenderRejection(StatusCode status, int retry_after_seconds) {
+    return std::format(
+        "{}"
+        "Retry-After: {}\r\n"
+        "Content-Length: 0\r\n"
+        "Connection: close\r\n"
+        "\r\n",
+        StatusLine(status), retry_after_seconds);
 }
 
-std::array<OwnedFd, 2> MakePipe() {
-    int fds[2];
-    if (::pipe(fds) < 0) throw SystemError(errno);
-    return {Own(fds[0]), Own(fds[1])};
+// hands |conn| back to |loop| to send |resp|, and then to drain the
+// client until it hangs up. closing straight away would reset the
+// connection if the client had sent anything we haven't read, and the
+// client might never see the response.
+void Reject(EventLoop& loop, std::unique_ptr<Connection> conn,
+            const std::string& resp) {
+    LOG(WARN) << "rejecting request from " << conn->addr << ":" << conn->port
+              << ": server overloaded";
+    conn->out = resp;
+    conn->linger_after_write = true;
+    loop.Resume(std::move(conn));
 }
 
-class SocketWriter : public ResponseWriter {
-public:
-    // |stream| must outlive the constructed instance
-    explicit SocketWriter(FILE* stream) : stream_(stream) {}
-    ~SocketWriter() override { fflush(stream_); }
-
-    void Flush() override;
-
-    // writes an http header with the specified status code. it is an
-    // error to call this twice or after any other data has been sent.
-    // TODO: return a different object here to enfroce this.
-    void WriteStatus(StatusCode code) override;
-
-    // writes the specified http header. it is an error to call this
-    // after any other data has been sent.
-    // TODO: return a different object here to enfroce this.
-    void WriteHeader(std::string key, std::string value) override;
-
-    // writes the specified data into the response. if a status has not
-    // already been sent, this will write StatusCode::OK first.
-    void WriteData(std::string_view data) override;
-
-    std::optional<StatusCode> status() override { return status_; }
-
-    int bytes_written() { return bytes_written_; }
-
-private:
-    void Write(std::string_view s);
-
-    FILE* stream_;
-    std::optional<StatusCode> status_;
-    std::unordered_map<std::string, std::string> headers_;
-    bool sending_data_ = false;
-    int bytes_written_ = 0;
+// the server's metrics, registered on first use
+struct ServerMetrics {
+    Counter& queued = GlobalMetrics().gauge(
+        "http_requests_queued", "requests waiting for a worker");
+    Histogram& queue_wait = GlobalMetrics().histogram(
+        "http_queue_wait_microseconds",
+        "how long requests waited for a worker");
+    Counter& overloaded = GlobalMetrics().counter(
+        "http_requests_rejected_total", "requests shed under load",
+        {{"status", "529"}});
+    Counter& unavailable = GlobalMetrics().counter(
+        "http_requests_rejected_total", "requests shed under load",
+        {{"status", "503"}});
+    Counter& bytes_in = GlobalMetrics().counter(
+        "http_request_bytes_total", "bytes of requests that were handled");
+    Counter& bytes_out = GlobalMetrics().counter(
+        "http_response_bytes_total", "bytes of responses to handled requests");
 };
 
-void SocketWriter::Write(std::string_view s) {
-    LOG(DEBUG) << "sending " << s.size() << " bytes in response";
-    if (s.size() == 0) return;
-    if (fwrite(s.data(), 1, s.size(), stream_) == 0) {
-        if (ferror(stream_) && (errno == EAGAIN || errno == EWOULDBLOCK)) {
-            throw TimeoutException{};
-        }
-        throw InternalError("failed to write data");
-    }
-    bytes_written_ += s.size();
-}
-
-void SocketWriter::Flush() {
-    LOG(DEBUG) << "flushing response to client";
-    fflush(stream_);
+ServerMetrics& Stats() {
+    static ServerMetrics* metrics = new ServerMetrics();
+    return *metrics;
 }
 
-void SocketWriter::WriteStatus(StatusCode status) {
-    if (sending_data_) {
-        LOG(ERROR) << std::format("can't send status {}, already sending data",
-                                  int(status));
-        throw InternalError("failed to send http status");
-    }
-    Write(std::format("HTTP/1.1 {} {}\r\n", int(status), to_string(status)));
-    WriteHeader("Connection", "close");
-    status_ = status;
-}
-
-void SocketWriter::WriteHeader(std::string key, std::string value) {
-    if (sending_data_) {
-        LOG(ERROR) << std::format("can't send header {}, already sending data",
-                                  key);
-        throw InternalError("failed to send http status");
+// the metrics for requests to one route
+struct RouteMetrics {
+    std::string route;
+    Histogram* latency;
+    std::unordered_map<int, Counter*> statuses;
+
+    Counter& status(StatusCode code) {
+        Counter*& counter = statuses[int(code)];
+        if (counter == nullptr) {
+            counter = &GlobalMetrics().counter(
+                "http_requests_total", "requests handled, by route and status",
+                {{"route", route}, {"status", std::to_string(int(code))}});
+        }
+        return *counter;
     }
-    Write(std::format("{}: {}\r\n", key, value));
-    headers_[key] = value;
-}
+};
 
-void SocketWriter::WriteData(std::string_view data) {
-    if (!sending_data_) {
-        if (!status_.has_value()) {
-            WriteStatus(StatusCode::OK);
+// returns the metrics for |route|. they're cached per thread, so that
+// only a thread's first request to a route takes the registry's lock.
+RouteMetrics& MetricsForRoute(std::string_view route) {
+    struct Hash {
+        using is_transparent = void;
+        size_t operator()(std::string_view s) const {
+            return std::hash<std::string_view>{}(s);
         }
-        Write("\r\n");
-        sending_data_ = true;
-    }
-    Write(data);
+    };
+    thread_local std::unordered_map<std::string, RouteMetrics, Hash,
+                                    std::equal_to<>>
+        cache;
+    if (auto it = cache.find(route); it != cache.end()) return it->second;
+    // requests that weren't routed
+    std::string name = route.empty() ? "none" : std::string(route);
+    Histogram* latency = &GlobalMetrics().histogram(
+        "http_request_duration_microseconds",
+        "how long requests took to handle, by route", {{"route", name}});
+    return cache
+        .emplace(route, RouteMetrics{.route = name, .latency = latency})
+        .first->second;
 }
+
 }  // namespace
 
 std::ostream& operator<<(std::ostream& os, const ServerConfig& config) {
+    std::string unix_sockets;
+    for (const std::string& path : config.unix_sockets) {
+        if (!unix_sockets.empty()) unix_sockets += ", ";
+        unix_sockets += path;
+    }
     return os << "{ port: " << config.port                                  //
               << ", read_timeout_millis: " << config.read_timeout_millis    //
+              << ", body_timeout_millis: " << config.body_timeout_millis    //
               << ", write_timeout_millis: " << config.write_timeout_millis  //
+              << ", max_body_bytes: " << config.max_body_bytes              //
               << ", worker_threads: " << config.worker_threads              //
+              << ", max_connections: " << config.max_connections            //
+              << ", keep_alive_timeout_millis: "
+              << config.keep_alive_timeout_millis  //
+              << ", max_requests_per_connection: "
+              << config.max_requests_per_connection  //
+              << ", max_queued_requests: " << config.max_queued_requests
+              << ", max_queue_wait_millis: " << config.max_queue_wait_millis
+              << ", retry_after_seconds: " << config.retry_after_seconds
+              << ", listeners: " << config.listeners
+              << ", unix_sockets: [" << unix_sockets << "]"
+              << ", pin_threads: " << config.pin_threads
+              << ", drain_timeout_millis: " << config.drain_timeout_millis
               << " }";
 }
 
 HttpServer::HttpServer(const ServerConfig& config)
-    : config_(config),
-      port_(config.port),
-      sock_(ServerSocket()),
-      pipe_(MakePipe()),
-      running_(0),
-      run_(false) {}
+    : config_(config), port_(config.port), running_(false) {}
 
 HttpServer::~HttpServer() {
-    if (running_) {
-        Stop();
-        Wait();
-    }
+    Stop();
+    Wait();
+}
+
+int HttpServer::total_threads() const {
+    int n = 0;
+    for (const auto& shard : shards_) n += shard->pool->size() + 1;
+    return n;
 }
 
 void HttpServer::Start(Handler handler) {
@@ -253,131 +264,211 @@ void HttpServer::Start(Handler handler) {
 
     // TODO: add state variable and enforce state transitions
     LOG(DEBUG) << "starting server...";
-    run_ = true;
-    listener_ = std::thread(&HttpServer::Listen, this);
-    pool_ = std::make_unique<ThreadPool>(config_.worker_threads);
-    LOG(DEBUG) << "waiting for server to be ready...";
-    running_.wait(false);
+    overloaded_ = RenderRejection(StatusCode::SiteOverloaded,
+                                  config_.retry_after_seconds);
+    unavailable_ = RenderRejection(StatusCode::ServiceUnavailable,
+                                   config_.retry_after_seconds);
+
+    // bind everything before starting any threads. the first socket
+    // picks the port if we weren't given one, and the rest share it.
+    std::vector<OwnedFd> socks;
+    if (config_.port >= 0) {
+        bool reuse_port = config_.listeners > 1;
+        for (int i = 0; i < config_.listeners; i++) {
+            socks.push_back(Listen(&port_, reuse_port));
+        }
+        LOG(INFO) << "http server listening at port " << port_ << " with "
+                  << config_.listeners << " listener(s)";
+    }
+    for (const std::string& path : config_.unix_sockets) {
+        socks.push_back(ListenUnix(path));
+        LOG(INFO) << "http server listening at unix socket " << path;
+    }
+    if (socks.empty()) {
+        throw std::invalid_argument("no tcp port or unix sockets to listen on");
+    }
+    running_ = true;
+    draining_ = stopped_ = false;
+    for (int i = 0; i < int(socks.size()); i++) {
+        shards_.push_back(StartShard(i, socks.size(), std::move(socks[i])));
+    }
     LOG(DEBUG) << "server ready.";
 }
 
+std::unique_ptr<HttpServer::Shard> HttpServer::StartShard(int id, int n,
+                                                          OwnedFd sock) {
+    auto shard = std::make_unique<Shard>();
+    std::vector<int> cpus;
+    if (config_.pin_threads) cpus = CpusForShard(id, n);
+    int workers = config_.worker_threads / n +
+                  (id < int(config_.worker_threads % n));
+    shard->pool = std::make_unique<ThreadPool>(
+        std::max(1, workers), [cpus](int) { PinThread(cpus); });
+    shard->loop = MakeEventLoop(
+        std::move(sock), config_,
+        [this, s = shard.get()](std::unique_ptr<Connection> conn) {
+            Dispatch(*s, std::move(conn));
+        });
+    if (int max = config_.max_connections; max > 0) {
+        shard->loop->set_max_connections(std::max(1, max / n + (id < max % n)));
+    }
+    shard->thread = std::thread([s = shard.get(), cpus] {
+        PinThread(cpus);
+        s->loop->Run();
+    });
+    return shard;
+}
+
 void HttpServer::Stop() {
-    if (!running_) return;
-    LOG(DEBUG) << "sending stop notification...";
-    run_ = false;
-    char done = 1;
-    write(*pipe_[1], &done, 1);
-    LOG(DEBUG) << "sent stop notification";
-    running_.wait(true);
+    if (shards_.empty() || stopped_.exchange(true)) return;
+    for (auto& shard : shards_) shard->loop->Stop();
+    running_ = false;
+}
+
+void HttpServer::Drain() {
+    if (!running_.exchange(false)) return;
+    LOG(INFO) << "draining, for up to " << config_.drain_timeout_millis
+              << " ms...";
+    draining_ = true;
+    auto deadline =
+        Clock::now() + std::chrono::milliseconds(config_.drain_timeout_millis);
+    for (auto& shard : shards_) shard->loop->Drain(deadline);
 }
 
 void HttpServer::Wait() {
-    if (!pool_) return;
+    if (shards_.empty()) return;
     LOG(DEBUG) << "waiting on all threads to exit...";
-    listener_.join();
-    pool_.reset();
+    for (auto& shard : shards_) shard->thread.join();
+    // workers may still hand connections back to their loop
+    for (auto& shard : shards_) {
+        shard->pool.reset();
+        shard->loop.reset();
+    }
+    shards_.clear();
+    for (const std::string& path : config_.unix_sockets) {
+        if (!path.starts_with('@')) unlink(path.c_str());
+    }
     LOG(DEBUG) << "all threads exited.";
 }
 
-void HttpServer::Listen() {
-    LOG(DEBUG) << "listener thread started";
-
-    // bind the socket
-    struct sockaddr_in addr;
-    addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = INADDR_ANY;
-    addr.sin_port = htons(port_);
-    if (::bind(*sock_, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
-        throw SystemError(errno);
+const std::string* HttpServer::Admit(const Shard& shard) const {
+    int queued = shard.queued.load(std::memory_order_relaxed);
+    if (config_.max_queued_requests > 0 &&
+        queued >= config_.max_queued_requests) {
+        return &overloaded_;
     }
-    if (::listen(*sock_, SOMAXCONN) < 0) {
-        throw SystemError(errno);
+    // the last observed wait only tells us about the queue while there
+    // is one. once it's drained we start over.
+    auto max_wait = std::chrono::milliseconds(config_.max_queue_wait_millis);
+    auto wait = std::chrono::nanoseconds(
+        shard.queue_wait_nanos.load(std::memory_order_relaxed));
+    if (config_.max_queue_wait_millis > 0 && queued > 0 && wait > max_wait) {
+        return &unavailable_;
     }
-    socklen_t len = sizeof(addr);
-    getsockname(*sock_, (struct sockaddr*)&addr, &len);
-    port_ = ntohs(addr.sin_port);
-    LOG(INFO) << "http server listening at port " << port_;
+    return nullptr;
+}
 
-    // ready to accept connections
-    running_ = true;
-    running_.notify_one();
-
-    // accept and handle until shut down
-    LOG(DEBUG) << "http server loop started";
-    struct pollfd fds[2];
-    fds[0].fd = *sock_;
-    fds[0].events = POLLIN;
-    fds[1].fd = *pipe_[0];
-    fds[1].events = POLLIN;
-    while (run_) {
-        int ret = poll(fds, 2, -1);
-        assert(ret != 0);  // impossible: no timeout
-        if (ret < 0) throw SystemError(errno);
-        if (fds[0].revents & POLLIN) Accept();
+void HttpServer::Dispatch(Shard& shard, std::unique_ptr<Connection> conn) {
+    // this runs on the event loop, so rejected requests never reach a
+    // worker
+    if (const std::string* rejection = Admit(shard)) {
+        if (rejection == &overloaded_) Stats().overloaded.Add();
+        else Stats().unavailable.Add();
+        return Reject(*shard.loop, std::move(conn), *rejection);
     }
-    LOG(DEBUG) << "http server loop finished, listener thread exiting";
-
-    running_ = false;
-    running_.notify_one();
+    LOG(DEBUG) << std::format("offering {}:{} to thread pool", conn->addr,
+                              conn->port);
+    shard.queued.fetch_add(1, std::memory_order_relaxed);
+    Stats().queued.Add(1);
+    shard.pool->Offer([this, &shard, conn = std::move(conn),
+                       queued_at = Clock::now()]() mutable {
+        Run(shard, std::move(conn), queued_at);
+    });
 }
 
-void HttpServer::Accept() {
-    LOG(DEBUG) << "accepting a client connection";
-    struct sockaddr_in client_addr;
-    socklen_t addr_len = sizeof(client_addr);
-    int client_fd = ::accept(*sock_, (struct sockaddr*)&client_addr, &addr_len);
-    if (client_fd < 0) {
-        throw SystemError(errno);
+void HttpServer::Run(Shard& shard, std::unique_ptr<Connection> conn,
+                     Clock::time_point queued_at) {
+    auto wait = Clock::now() - queued_at;
+    shard.queue_wait_nanos.store(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(wait).count(),
+        std::memory_order_relaxed);
+    shard.queued.fetch_sub(1, std::memory_order_relaxed);
+    Stats().queued.Add(-1);
+    Stats().queue_wait.Record(
+        std::chrono::duration_cast<std::chrono::microseconds>(wait).count());
+
+    // it's too late to give this one a timely answer, so don't spend a
+    // worker's time on it
+    if (config_.max_queue_wait_millis > 0 &&
+        wait > std::chrono::milliseconds(config_.max_queue_wait_millis)) {
+        Stats().unavailable.Add();
+        return Reject(*shard.loop, std::move(conn), unavailable_);
+    }
+    try {
+        if (Handle(*conn)) shard.loop->Resume(std::move(conn));
+    } catch (std::exception& e) {
+        LOG(ERROR) << e.what();
     }
-    char ip[INET_ADDRSTRLEN];
-    inet_ntop(AF_INET, &client_addr.sin_addr, ip, INET_ADDRSTRLEN);
-    HttpServer::Client client{Own(client_fd), ntohs(client_addr.sin_port),
-                              std::string(ip)};
-
-    // hand it off to a worker thread
-    pool_->Offer(
-        [this, client = std::make_shared<Client>(std::move(client))]() mutable {
-            LOG(DEBUG) << std::format("offering {}:{} to thread pool",
-                                      client->addr, client->port);
-            try {
-                Handle(std::move(*client));
-            } catch (std::exception& e) {
-                LOG(ERROR) << e.what();
-            }
-        });
 }
 
-void HttpServer::Handle(Client&& client) {
-    LOG(DEBUG) << "handling client " << client.addr << ":" << client.port;
-
-    SetTimeout(*client.fd, config_.read_timeout_millis, SO_RCVTIMEO);
-    SetTimeout(*client.fd, config_.write_timeout_millis, SO_SNDTIMEO);
-
-    FILE* stream;
-    if ((stream = fdopen(*client.fd, "r+")) == nullptr) {
-        throw SystemError(errno);
-    }
+bool HttpServer::Handle(Connection& conn) {
+    LOG(DEBUG) << "handling client " << conn.addr << ":" << conn.port;
+
+    bool keep_alive = conn.parser.keep_alive() && running_ &&
+                      conn.requests < config_.max_requests_per_connection;
+    SocketWriter resp(*conn.fd, config_.write_timeout_millis, keep_alive,
+                      conn.parser.http_1_1(), &conn.arena);
+    // a slow client shouldn't hold on to a worker once the whole
+    // response has been written, so the event loop sends the rest
+    resp.set_overflow(&conn.out);
+    auto start = Clock::now();
+    bool resume = Respond(conn, resp);
+
+    RouteMetrics& route = MetricsForRoute(conn.req.route);
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        Clock::now() - start);
+    route.latency->Record(elapsed.count());
+    route.status(resp.status().value_or(StatusCode::OK)).Add();
+    Stats().bytes_in.Add(conn.parser.size());
+    // this includes what was left in |conn.out| for the loop to send
+    Stats().bytes_out.Add(resp.bytes_written());
+    return resume;
+}
 
-    SocketWriter resp(stream);
-    Request req{.addr = client.addr};
+bool HttpServer::Respond(Connection& conn, SocketWriter& resp) {
+    Request& req = conn.req;
+    bool ok = true;
     try {
-        ParseRequest(&req, stream);
         handler_(req, resp);
-        resp.Flush();
-        std::string user_agent = req.headers["User-Agent"];
-        LOG(INFO) << client.addr << " - " << to_string(req.method) << " "
-                  << req.path << " HTTP/1.1 " << int(*resp.status()) << " "
-                  << resp.bytes_written() << " " << user_agent;
     } catch (const json::JSONError& e) {
-        MustSend(resp, StatusCode::BadRequest);
+        ok = MustSend(resp, StatusCode::BadRequest);
     } catch (const HttpException& e) {
-        MustSend(resp, e.status());
+        ok = MustSend(resp, e.status());
     } catch (const std::exception& e) {
         LOG(ERROR) << e.what();
-        MustSend(resp, StatusCode::InternalServerError);
+        ok = MustSend(resp, StatusCode::InternalServerError);
     }
+    // the client has part of a response, and hanging up is the only way
+    // to tell it that the rest isn't coming
+    if (!ok) return false;
 
-    LOG(DEBUG) << "done handling client " << client.addr << ":" << client.port;
+    bool keep_alive;
+    try {
+        keep_alive = resp.Finish();
+    } catch (const std::exception& e) {
+        LOG(WARN) << "failed to send response: " << e.what();
+        return false;
+    }
+    std::string_view user_agent = req.headers.get("User-Agent").value_or("");
+    LOG(INFO) << conn.addr << " - " << to_string(req.method) << " "
+              << req.path << " HTTP/1.1 " << int(*resp.status()) << " "
+              << resp.bytes_written() << " " << user_agent;
+    LOG(DEBUG) << "done handling client " << conn.addr << ":" << conn.port;
+    // closing now would reset the connection if the client has
+    // pipelined anything we haven't read, and could lose the response.
+    // the loop stops sending and drains the client instead.
+    conn.linger_after_write = !keep_alive;
+    return true;
 }
 
 }  // namespace http
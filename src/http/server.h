@@ -1,25 +1,76 @@
 #ifndef GABBY_HTTP_SERVER_H_
 #define GABBY_HTTP_SERVER_H_
 
+#include <atomic>
 #include <iostream>
 #include <memory>
-#include <optional>
-#include <queue>
+#include <string>
 #include <thread>
+#include <vector>
 
-#include "http/thread_pool.h"
+#include "http/event_loop.h"
 #include "http/types.h"
 #include "utils/pointers.h"
+#include "utils/thread_pool.h"
 
 namespace gabby {
 namespace http {
 
+class SocketWriter;
+
 struct ServerConfig {
+    // the tcp port to listen on, or 0 for any free one. negative to
+    // listen on |unix_sockets| alone.
     int port = 0;
+    // how long a client has to send a request head
     int read_timeout_millis = 5000;
+    // how long a client has to send a request body once its head has
+    // been read
+    int body_timeout_millis = 10000;
+    // how long a client can go without taking any of a response
     int write_timeout_millis = 5000;
-    // must be at least 1
+    // requests with larger bodies are rejected with a 413, as soon as
+    // the head says so, rather than being read into memory
+    size_t max_body_bytes = 4 * 1024 * 1024;
+    // must be at least 1. split evenly between listeners, including
+    // unix sockets.
     unsigned int worker_threads = 1;
+    // clients that connect while this many are open are turned away
+    // with a 503 as soon as they're accepted. split evenly between
+    // listeners. 0 means no limit.
+    int max_connections = 10000;
+    // how long an idle persistent connection is kept open
+    int keep_alive_timeout_millis = 5000;
+    // connections are closed after this many requests. 1 disables
+    // persistent connections.
+    int max_requests_per_connection = 1000;
+    // requests that arrive while this many are already waiting for one
+    // of a listener's workers are rejected with a 529. 0 means no
+    // limit.
+    int max_queued_requests = 1024;
+    // requests that wait longer than this for a worker are rejected
+    // with a 503, as are new requests while the queue is that far
+    // behind. 0 means no limit.
+    int max_queue_wait_millis = 1000;
+    // sent in the Retry-After header of rejected requests
+    int retry_after_seconds = 1;
+    // the number of listening sockets. when more than one, they're all
+    // bound to the same port with SO_REUSEPORT so that the kernel
+    // spreads connections across them, and each has its own event loop
+    // and workers.
+    int listeners = 1;
+    // unix domain sockets to listen on as well as the tcp port, so that
+    // clients on the same machine can skip the tcp stack. each has its
+    // own event loop and workers. a path that starts with @ names a
+    // socket in the abstract namespace rather than the file system.
+    // socket files are removed once the server has stopped.
+    std::vector<std::string> unix_sockets;
+    // pins each listener's event loop and workers to its own share of
+    // the cpus
+    bool pin_threads = false;
+    // how long Drain waits for requests that have already been accepted
+    // to be answered before the server stops anyway
+    int drain_timeout_millis = 30000;
 };
 
 std::ostream& operator<<(std::ostream& os, const ServerConfig& config);
@@ -29,37 +80,69 @@ public:
     explicit HttpServer(const ServerConfig& config);
     ~HttpServer();
 
+    // the tcp port, once started
     int port() const { return port_; }
-    int total_threads() const { return config_.worker_threads + 1; }
+    // the workers and event loop threads, while the server is running.
+    // each listener gets at least one worker of its own.
+    int total_threads() const;
 
     // |handler| must be thread-safe
     void Start(Handler handler);
     void Wait();
     void Stop();
 
+    // stops accepting clients, and stops the server once every request
+    // that's been accepted has been answered and every connection
+    // closed, or once the drain timeout has passed. requests that
+    // arrive on open connections in the meantime are answered, and the
+    // connections closed after them. returns right away, and Wait
+    // returns once it's done.
+    void Drain();
+    bool draining() const { return draining_; }
+
 private:
-    struct Client {
-        OwnedFd fd;
-        int port;
-        std::string addr;
+    // a listener, with its own event loop and the workers that handle
+    // the requests it reads. nothing is shared between shards.
+    struct Shard {
+        std::unique_ptr<ThreadPool> pool;
+        std::unique_ptr<EventLoop> loop;
+        std::thread thread;
+
+        // admission control. requests that no worker has picked up yet
+        // are counted in |queued|, and |queue_wait_nanos| is how long
+        // the last one to be picked up had waited.
+        std::atomic<int> queued = 0;
+        std::atomic<int64_t> queue_wait_nanos = 0;
     };
 
-    void Listen();
-    void Accept();
-    void Handle(Client&& sock);
+    // starts shard |id| of |n| on |sock|
+    std::unique_ptr<Shard> StartShard(int id, int n, OwnedFd sock);
+    void Dispatch(Shard& shard, std::unique_ptr<Connection> conn);
+
+    // returns the pre-rendered rejection to send instead of queueing a
+    // request, if the shard's queue is over its limits
+    const std::string* Admit(const Shard& shard) const;
+
+    // runs on a worker once it picks up |conn|
+    void Run(Shard& shard, std::unique_ptr<Connection> conn,
+             Clock::time_point queued_at);
+
+    // returns whether the connection should go back to the event loop
+    // to send the rest of the response, and then to be reused or closed.
+    // it's only dropped straight away when we hang up on purpose.
+    bool Handle(Connection& conn);
+    // runs the handler and finishes the response
+    bool Respond(Connection& conn, SocketWriter& resp);
 
     ServerConfig config_;
     int port_;
-    OwnedFd sock_;
     Handler handler_;
-    std::unique_ptr<ThreadPool> pool_;
-
-    // we run a poll() loop in a thread and use a pipe to notify it
-    // about graceful shutdown
-    std::thread listener_;
-    std::array<OwnedFd, 2> pipe_;  // [read, write]
-    std::atomic<bool> run_;        // set to false to shut down
-    std::atomic<bool> running_;    // set to indicate we can accept clients
+    std::string overloaded_;
+    std::string unavailable_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<bool> running_;  // set to indicate we can accept clients
+    std::atomic<bool> draining_ = false;
+    std::atomic<bool> stopped_ = false;
 };
 
 }  // namespace http
@@ -0,0 +1,164 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <format>
+#include <limits>
+#include <string_view>
+#include <vector>
+
+#include "http/server.h"
+#include "test/bench.h"
+#include "utils/logging.h"
+
+namespace gabby {
+namespace http {
+
+namespace {
+
+constexpr int kConnections = 32;
+
+constexpr std::string_view kKeepAliveRequest =
+    "GET /healthz HTTP/1.1\r\n"
+    "Host: localhost:8080\r\n"
+    "\r\n";
+
+constexpr std::string_view kCloseRequest =
+    "GET /healthz HTTP/1.1\r\n"
+    "Host: localhost:8080\r\n"
+    "Connection: close\r\n"
+    "\r\n";
+
+int Connect(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        throw SystemError(errno);
+    }
+    return fd;
+}
+
+int ConnectUnix(std::string_view path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un addr;
+    socklen_t len = UnixSocketAddress(path, &addr);
+    if (connect(fd, (struct sockaddr*)&addr, len) < 0) {
+        throw SystemError(errno);
+    }
+    return fd;
+}
+
+// reads one response without a body
+void ReadResponse(int fd) {
+    char buf[1024];
+    size_t len = 0;
+    while (true) {
+        ssize_t n = ::recv(fd, buf + len, sizeof(buf) - len, 0);
+        if (n <= 0) throw SystemError(errno);
+        len += n;
+        if (std::string_view(buf, len).ends_with("\r\n\r\n")) return;
+    }
+}
+
+double CpuMicros() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    auto micros = [](const timeval& tv) {
+        return tv.tv_sec * 1e6 + tv.tv_usec;
+    };
+    return micros(usage.ru_utime) + micros(usage.ru_stime);
+}
+
+// each iteration sends a request on every one of |kConnections| clients
+// before reading any of the responses, so that the event loop has
+// several sockets to handle at once. with |churn|, every request is on
+// a new connection.
+void RunRequests(BenchmarkState& state, bool churn) {
+    HttpServer server(ServerConfig{
+        .worker_threads = 1,
+        .max_requests_per_connection = std::numeric_limits<int>::max(),
+    });
+    server.Start([](Request& req, ResponseWriter& resp) {
+        resp.WriteStatus(StatusCode::OK);
+    });
+    std::string_view request = churn ? kCloseRequest : kKeepAliveRequest;
+    std::vector<int> fds(kConnections);
+    if (!churn) {
+        for (int& fd : fds) fd = Connect(server.port());
+    }
+
+    double cpu_before = CpuMicros();
+    while (state.KeepRunning()) {
+        for (int& fd : fds) {
+            if (churn) fd = Connect(server.port());
+            ::send(fd, request.data(), request.size(), MSG_NOSIGNAL);
+        }
+        for (int fd : fds) {
+            ReadResponse(fd);
+            if (churn) close(fd);
+        }
+    }
+    double requests = double(state.iterations()) * kConnections;
+    // the client runs in the same process, so this is the cost of both
+    // ends of each request
+    state.counters["cpu_us/request"] = (CpuMicros() - cpu_before) / requests;
+    state.counters["ns/request"] = state.nanos_per_iteration() / kConnections;
+
+    if (!churn) {
+        for (int fd : fds) close(fd);
+    }
+    server.Stop();
+    server.Wait();
+}
+
+// sends one small request at a time on a persistent connection, over
+// loopback tcp or a unix domain socket, so each iteration is a round
+// trip through the server
+void RunRoundTrips(BenchmarkState& state, bool unix_socket) {
+    std::string path = std::format("@gabby_server_bench_{}", getpid());
+    HttpServer server(ServerConfig{
+        .port = unix_socket ? -1 : 0,
+        .worker_threads = 1,
+        .max_requests_per_connection = std::numeric_limits<int>::max(),
+        .unix_sockets = unix_socket ? std::vector{path}
+                                    : std::vector<std::string>{},
+    });
+    server.Start([](Request& req, ResponseWriter& resp) {
+        resp.WriteStatus(StatusCode::OK);
+    });
+    int fd = unix_socket ? ConnectUnix(path) : Connect(server.port());
+
+    double cpu_before = CpuMicros();
+    while (state.KeepRunning()) {
+        ::send(fd, kKeepAliveRequest.data(), kKeepAliveRequest.size(),
+               MSG_NOSIGNAL);
+        ReadResponse(fd);
+    }
+    state.counters["cpu_us/request"] =
+        (CpuMicros() - cpu_before) / state.iterations();
+
+    close(fd);
+    server.Stop();
+    server.Wait();
+}
+
+}  // namespace
+
+BENCHMARK(HttpServer, TcpRoundTrip) { RunRoundTrips(state, false); }
+
+BENCHMARK(HttpServer, UnixSocketRoundTrip) { RunRoundTrips(state, true); }
+
+BENCHMARK(HttpServer, KeepAlive) { RunRequests(state, false); }
+
+BENCHMARK(HttpServer, Churn) { RunRequests(state, true); }
+
+}  // namespace http
+}  // namespace gabby
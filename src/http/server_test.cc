@@ -1,6 +1,7 @@
 #include "server.h"
 
 #include <netinet/in.h>
+#include <sys/resource.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
@@ -16,6 +17,7 @@
 #include "http/test_client.h"
 #include "test/test.h"
 #include "utils/logging.h"
+#include "utils/metrics.h"
 
 namespace gabby {
 namespace http {
@@ -35,6 +37,9 @@ public:
     TestServer(Handler h) : TestServer(kTestConfig, h) {}
 
     int port() { return server_.port(); }
+    int total_threads() { return server_.total_threads(); }
+    void Drain() { server_.Drain(); }
+    void Wait() { server_.Wait(); }
 
     ~TestServer() {
         server_.Stop();
@@ -124,18 +129,102 @@ TEST(HttpServer, CallWithReadDelay) {
     EXPECT_EQ(result.find(data), std::string::npos);
 }
 
-TEST(HttpServer, CallSuccessfully) {
+TEST(HttpServer, CallWithSlowBody) {
     // Arrange
-    std::string data(16 * 1024 * 1024, 'x');
     std::shared_ptr<std::atomic<bool>> done(new std::atomic(false));
-    Request received;
-    auto server = TestServer(
-        [&received, &data, done](const Request& req, ResponseWriter& resp) {
+    auto config = kTestConfig;
+    config.body_timeout_millis = 50;
+    auto server =
+        TestServer(config, [done](const Request& req, ResponseWriter& resp) {
             *done = true;
-            received = req;
+            resp.WriteStatus(StatusCode::OK);
+        });
+
+    // Act
+    // The head arrives in time, but the body never finishes.
+    UnbufferedClientSocket sock(server.port());
+    sock.Write("POST / HTTP/1.1\r\nContent-Length: 10\r\n\r\nabc");
+    auto result = sock.ReadAll();
+
+    // Assert
+    EXPECT_FALSE(*done);
+    EXPECT_SUBSTR(result, "HTTP/1.1 408 Request Timeout");
+}
+
+TEST(HttpServer, SlowReadersDontHoldWorkers) {
+    // Arrange
+    // The only worker writes a response too large for the socket
+    // buffers.
+    std::string data(16 * 1024 * 1024, 'x');
+    auto config = kTestConfig;
+    config.worker_threads = 1;
+    auto server =
+        TestServer(config, [&data](const Request& req, ResponseWriter& resp) {
+            resp.WriteStatus(StatusCode::OK);
+            if (req.path == "/large") resp.WriteData(data);
+        });
+
+    // Act
+    // The first client doesn't read its response yet.
+    UnbufferedClientSocket slow(server.port());
+    slow.Write("GET /large HTTP/1.1\r\nConnection: close\r\n\r\n");
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    auto start = Clock::now();
+    auto fast = Call(server.port(), Method::GET, "/small");
+    auto elapsed = Clock::now() - start;
+    auto large = slow.ReadAll();
+
+    // Assert
+    // The second request should be handled while the event loop sends
+    // the rest of the first response, which should arrive in full.
+    EXPECT_SUBSTR(fast, "HTTP/1.1 200 OK");
+    EXPECT_TRUE(elapsed < std::chrono::seconds(1));
+    EXPECT_EQ(16 * 1024 * 1024, large.size() - large.find("\r\n\r\n") - 4);
+}
+
+TEST(HttpServer, CountsResponseBytesSentByTheLoop) {
+    // Arrange
+    // The response is too large for the socket buffers, so the event
+    // loop sends most of it after the handler is done.
+    std::string data(16 * 1024 * 1024, 'x');
+    auto server =
+        TestServer([&data](const Request& req, ResponseWriter& resp) {
             resp.WriteStatus(StatusCode::OK);
             resp.WriteData(data);
         });
+    Counter& bytes_out = GlobalMetrics().counter(
+        "http_response_bytes_total", "bytes of responses to handled requests");
+    int64_t before = bytes_out.value();
+
+    // Act
+    UnbufferedClientSocket sock(server.port());
+    sock.Write("GET / HTTP/1.1\r\nConnection: close\r\n\r\n");
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    auto result = sock.ReadAll();
+
+    // Assert
+    // Every byte should be counted once.
+    EXPECT_EQ(int64_t(result.size()), bytes_out.value() - before);
+}
+
+TEST(HttpServer, CallSuccessfully) {
+    // Arrange
+    std::string data(16 * 1024 * 1024, 'x');
+    std::shared_ptr<std::atomic<bool>> done(new std::atomic(false));
+    // The request only points into the connection's buffer, so keep
+    // copies of what we want to check.
+    Method method;
+    std::string path, a, one;
+    auto server = TestServer([&method, &path, &a, &one, &data, done](
+                                 const Request& req, ResponseWriter& resp) {
+        *done = true;
+        method = req.method;
+        path = req.path;
+        a = req.headers.get("a").value_or("");
+        one = req.headers.get("1").value_or("");
+        resp.WriteStatus(StatusCode::OK);
+        resp.WriteData(data);
+    });
 
     // Act
     auto result = Call(server.port(), Method::GET, "/foo",
@@ -152,10 +241,622 @@ TEST(HttpServer, CallSuccessfully) {
     EXPECT_SUBSTR(result, data);
 
     // TODO: implement EXPECT_THAT and matchers
-    EXPECT_EQ(Method::GET, received.method);
-    EXPECT_EQ("/foo", received.path);
-    EXPECT_EQ(received.headers["a"], "b");
-    EXPECT_EQ(received.headers["1"], "2");
+    EXPECT_EQ(Method::GET, method);
+    EXPECT_EQ("/foo", path);
+    EXPECT_EQ(a, "b");
+    EXPECT_EQ(one, "2");
+}
+
+TEST(HttpServer, IdleClientsDontBlockWorkers) {
+    // Arrange
+    auto config = kTestConfig;
+    config.worker_threads = 1;
+    auto server =
+        TestServer(config, [](const Request& req, ResponseWriter& resp) {
+            resp.WriteStatus(StatusCode::OK);
+        });
+
+    // Act
+    // Open more slow connections than there are workers, and leave
+    // their requests unfinished.
+    std::vector<std::unique_ptr<UnbufferedClientSocket>> idle;
+    for (int i = 0; i < 10; i++) {
+        idle.push_back(std::make_unique<UnbufferedClientSocket>(server.port()));
+        idle.back()->Write("GET / HTT");
+    }
+    auto result = Call(server.port(), Method::GET, "/foo");
+
+    // Assert
+    // The request should be handled without waiting on the idle ones.
+    EXPECT_SUBSTR(result, "HTTP/1.1 200 OK");
+}
+
+int CountSubstr(const std::string& haystack, const std::string& needle) {
+    int count = 0;
+    for (size_t pos = 0; (pos = haystack.find(needle, pos)) != std::string::npos;
+         pos += needle.size()) {
+        count++;
+    }
+    return count;
+}
+
+TEST(HttpServer, FlushStreamsResponse) {
+    // Arrange
+    // The handler doesn't finish until the client has seen the first
+    // part of the response.
+    std::atomic<bool> seen = false;
+    auto server =
+        TestServer([&seen](const Request& req, ResponseWriter& resp) {
+            resp.WriteStatus(StatusCode::OK);
+            resp.WriteData("first;");
+            resp.Flush();
+            seen.wait(false);
+            resp.WriteData("second;");
+        });
+
+    // Act
+    UnbufferedClientSocket sock(server.port());
+    sock.Write("GET / HTTP/1.1\r\nConnection: close\r\n\r\n");
+    std::string result;
+    while (result.find("first;") == std::string::npos) {
+        std::string data = sock.Read();
+        if (data.empty()) break;
+        result += data;
+    }
+    seen = true;
+    seen.notify_all();
+    result += sock.ReadAll();
+
+    // Assert
+    // The flushed response should be sent in chunks.
+    EXPECT_SUBSTR(result, "HTTP/1.1 200 OK");
+    EXPECT_SUBSTR(result, "Transfer-Encoding: chunked");
+    EXPECT_EQ(result.find("Content-Length"), std::string::npos);
+    EXPECT_TRUE(
+        result.ends_with("6\r\nfirst;\r\n7\r\nsecond;\r\n0\r\n\r\n"));
+}
+
+TEST(HttpServer, ChunkedResponsesKeepConnectionsAlive) {
+    // Arrange
+    auto server =
+        TestServer([](const Request& req, ResponseWriter& resp) {
+            resp.WriteData(req.path);
+            resp.Flush();
+        });
+
+    // Act
+    UnbufferedClientSocket sock(server.port());
+    sock.Write(
+        "GET /a HTTP/1.1\r\n\r\n"
+        "GET /b HTTP/1.1\r\nConnection: close\r\n\r\n");
+    auto result = sock.ReadAll();
+
+    // Assert
+    EXPECT_EQ(2, CountSubstr(result, "Transfer-Encoding: chunked"));
+    EXPECT_SUBSTR(result, "2\r\n/a\r\n0\r\n\r\nHTTP/1.1 200 OK");
+    EXPECT_TRUE(result.ends_with("2\r\n/b\r\n0\r\n\r\n"));
+}
+
+TEST(HttpServer, FlushClosesHttp10Responses) {
+    // Arrange
+    auto server =
+        TestServer([](const Request& req, ResponseWriter& resp) {
+            resp.WriteData("first;");
+            resp.Flush();
+            resp.WriteData("second;");
+        });
+
+    // Act
+    UnbufferedClientSocket sock(server.port());
+    sock.Write("GET / HTTP/1.0\r\nConnection: keep-alive\r\n\r\n");
+    auto result = sock.ReadAll();
+
+    // Assert
+    // HTTP/1.0 has no chunked encoding, so the response must be
+    // delimited by closing the connection.
+    EXPECT_SUBSTR(result, "Connection: close");
+    EXPECT_EQ(result.find("Transfer-Encoding"), std::string::npos);
+    EXPECT_TRUE(result.ends_with("\r\n\r\nfirst;second;"));
+}
+
+TEST(HttpServer, ChunkedRequestBody) {
+    // Arrange
+    auto server =
+        TestServer([](const Request& req, ResponseWriter& resp) {
+            resp.WriteData(std::format("body={};", req.body));
+        });
+
+    // Act
+    // The second request is pipelined right behind the chunked one.
+    UnbufferedClientSocket sock(server.port());
+    sock.Write(
+        "POST /a HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+        "3\r\nabc\r\n");
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    sock.Write(
+        "2\r\nde\r\n0\r\n\r\n"
+        "POST /b HTTP/1.1\r\nContent-Length: 1\r\nConnection: close\r\n"
+        "\r\nf");
+    auto result = sock.ReadAll();
+
+    // Assert
+    EXPECT_SUBSTR(result, "body=abcde;");
+    EXPECT_SUBSTR(result, "body=f;");
+}
+
+TEST(HttpServer, PipelinedRequestsAnsweredInOrder) {
+    // Arrange
+    auto server =
+        TestServer([](const Request& req, ResponseWriter& resp) {
+            resp.WriteStatus(StatusCode::OK);
+            resp.WriteData(std::format("path={};", req.path));
+        });
+
+    // Act
+    // Send all three requests at once on a single connection.
+    UnbufferedClientSocket sock(server.port());
+    sock.Write(
+        "GET /a HTTP/1.1\r\n\r\n"
+        "POST /b HTTP/1.1\r\nContent-Length: 3\r\n\r\nxyz"
+        "GET /c HTTP/1.1\r\nConnection: close\r\n\r\n");
+    auto result = sock.ReadAll();
+
+    // Assert
+    EXPECT_EQ(3, CountSubstr(result, "HTTP/1.1 200 OK"));
+    EXPECT_EQ(2, CountSubstr(result, "Connection: keep-alive"));
+    EXPECT_EQ(1, CountSubstr(result, "Connection: close"));
+    EXPECT_EQ(3, CountSubstr(result, "Content-Length: 8"));
+    size_t a = result.find("path=/a;");
+    size_t b = result.find("path=/b;");
+    size_t c = result.find("path=/c;");
+    EXPECT_TRUE(a != std::string::npos && a < b && b < c &&
+                c != std::string::npos);
+}
+
+TEST(HttpServer, KeepAliveWaitsForNextRequest) {
+    // Arrange
+    auto server =
+        TestServer([](const Request& req, ResponseWriter& resp) {
+            resp.WriteStatus(StatusCode::OK);
+        });
+
+    // Act
+    // Send the second request after the first has been answered.
+    UnbufferedClientSocket sock(server.port());
+    sock.Write("GET /a HTTP/1.1\r\n\r\n");
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    sock.Write("GET /b HTTP/1.1\r\nConnection: close\r\n\r\n");
+    auto result = sock.ReadAll();
+
+    // Assert
+    EXPECT_EQ(2, CountSubstr(result, "HTTP/1.1 200 OK"));
+}
+
+TEST(HttpServer, MaxRequestsPerConnection) {
+    // Arrange
+    auto config = kTestConfig;
+    config.max_requests_per_connection = 2;
+    auto server =
+        TestServer(config, [](const Request& req, ResponseWriter& resp) {
+            resp.WriteStatus(StatusCode::OK);
+        });
+
+    // Act
+    UnbufferedClientSocket sock(server.port());
+    sock.Write(
+        "GET /a HTTP/1.1\r\n\r\n"
+        "GET /b HTTP/1.1\r\n\r\n"
+        "GET /c HTTP/1.1\r\n\r\n");
+    auto result = sock.ReadAll();
+
+    // Assert
+    // The server should hang up after the second response.
+    EXPECT_EQ(2, CountSubstr(result, "HTTP/1.1 200 OK"));
+    EXPECT_EQ(1, CountSubstr(result, "Connection: close"));
+}
+
+TEST(HttpServer, LastResponseSurvivesPipelinedRequests) {
+    // Arrange
+    auto config = kTestConfig;
+    config.max_requests_per_connection = 1;
+    std::string data(64 * 1024, 'x');
+    auto server =
+        TestServer(config, [&data](const Request& req, ResponseWriter& resp) {
+            resp.WriteStatus(StatusCode::OK);
+            resp.WriteData(data);
+        });
+
+    // Act
+    // More is pipelined than the loop reads at once, so some of it is
+    // still unread in the socket when the response is written.
+    UnbufferedClientSocket sock(server.port());
+    std::string body(64 * 1024, 'y');
+    sock.Write(std::format(
+        "GET /a HTTP/1.1\r\n\r\n"
+        "POST /b HTTP/1.1\r\nContent-Length: {}\r\n\r\n{}",
+        body.size(), body));
+    auto result = sock.ReadAll();
+
+    // Assert
+    // The server should hang up after the first response, without
+    // resetting the connection before the client has read it.
+    EXPECT_EQ(1, CountSubstr(result, "HTTP/1.1 200 OK"));
+    EXPECT_EQ(data.size(), result.size() - result.find("\r\n\r\n") - 4);
+}
+
+TEST(HttpServer, KeepAliveTimeout) {
+    // Arrange
+    auto config = kTestConfig;
+    config.keep_alive_timeout_millis = 50;
+    auto server =
+        TestServer(config, [](const Request& req, ResponseWriter& resp) {
+            resp.WriteStatus(StatusCode::OK);
+        });
+
+    // Act
+    UnbufferedClientSocket sock(server.port());
+    sock.Write("GET /a HTTP/1.1\r\n\r\n");
+    auto result = sock.ReadAll();
+
+    // Assert
+    // The server should hang up quietly once the connection is idle.
+    EXPECT_EQ(1, CountSubstr(result, "HTTP/1.1 200 OK"));
+    EXPECT_EQ(result.find("408"), std::string::npos);
+}
+
+TEST(HttpServer, RejectsRequestsWhenQueueIsFull) {
+    // Arrange
+    // The only worker blocks on the first request until released.
+    auto config = kTestConfig;
+    config.worker_threads = 1;
+    config.max_queued_requests = 1;
+    std::atomic<bool> started = false, release = false;
+    auto server = TestServer(config, [&started, &release](
+                                         const Request& req,
+                                         ResponseWriter& resp) {
+        if (req.path == "/a") {
+            started = true;
+            started.notify_all();
+            release.wait(false);
+        }
+        resp.WriteStatus(StatusCode::OK);
+    });
+
+    // Act
+    UnbufferedClientSocket a(server.port()), b(server.port());
+    a.Write("GET /a HTTP/1.1\r\nConnection: close\r\n\r\n");
+    started.wait(false);
+    b.Write("GET /b HTTP/1.1\r\nConnection: close\r\n\r\n");
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    auto rejected = Call(server.port(), Method::GET, "/c");
+    release = true;
+    release.notify_all();
+
+    // Assert
+    // The third request should be turned away without waiting, and the
+    // queued one should still be answered.
+    EXPECT_SUBSTR(rejected, "HTTP/1.1 529 Site is overloaded");
+    EXPECT_SUBSTR(rejected, "Retry-After: 1");
+    EXPECT_SUBSTR(a.ReadAll(), "HTTP/1.1 200 OK");
+    EXPECT_SUBSTR(b.ReadAll(), "HTTP/1.1 200 OK");
+}
+
+TEST(HttpServer, RejectsRequestsThatWaitTooLong) {
+    // Arrange
+    auto config = kTestConfig;
+    config.worker_threads = 1;
+    config.max_queue_wait_millis = 50;
+    config.retry_after_seconds = 3;
+    std::atomic<bool> started = false;
+    std::atomic<int> handled = 0;
+    auto server = TestServer(config, [&started, &handled](
+                                         const Request& req,
+                                         ResponseWriter& resp) {
+        handled++;
+        if (req.path == "/a") {
+            started = true;
+            started.notify_all();
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        }
+        resp.WriteStatus(StatusCode::OK);
+    });
+
+    // Act
+    UnbufferedClientSocket a(server.port());
+    a.Write("GET /a HTTP/1.1\r\nConnection: close\r\n\r\n");
+    started.wait(false);
+    auto rejected = Call(server.port(), Method::GET, "/b");
+
+    // Assert
+    // The second request should be dropped without reaching the handler.
+    EXPECT_SUBSTR(rejected, "HTTP/1.1 503 Service Unavailable");
+    EXPECT_SUBSTR(rejected, "Retry-After: 3");
+    EXPECT_SUBSTR(a.ReadAll(), "HTTP/1.1 200 OK");
+    EXPECT_EQ(1, handled);
+}
+
+TEST(HttpServer, MultipleListeners) {
+    for (bool pin_threads : {false, true}) {
+        // Arrange
+        auto config = kTestConfig;
+        config.listeners = 3;
+        config.worker_threads = 4;
+        config.pin_threads = pin_threads;
+        std::atomic<int> count = 0;
+        auto server = TestServer(
+            config, [&count](const Request& req, ResponseWriter& resp) {
+                count++;
+                resp.WriteStatus(StatusCode::OK);
+            });
+
+        // Act
+        // Each call is a new connection, so the kernel should spread
+        // them across the listeners.
+        std::vector<std::string> results;
+        for (int i = 0; i < 30; i++) {
+            results.push_back(Call(server.port(), Method::GET, "/foo"));
+        }
+
+        // Assert
+        EXPECT_EQ(30, count);
+        for (const std::string& result : results) {
+            EXPECT_SUBSTR(result, "HTTP/1.1 200 OK");
+        }
+    }
+}
+
+TEST(HttpServer, EachListenerHasAWorker) {
+    // Arrange
+    auto config = kTestConfig;
+    config.listeners = 3;
+    config.worker_threads = 1;
+
+    // Act
+    auto server =
+        TestServer(config, [](const Request& req, ResponseWriter& resp) {
+            resp.WriteStatus(StatusCode::OK);
+        });
+
+    // Assert
+    // A worker and an event loop for each listener.
+    EXPECT_EQ(6, server.total_threads());
+}
+
+TEST(HttpServer, RejectsBodiesOverTheLimit) {
+    // Arrange
+    auto config = kTestConfig;
+    config.max_body_bytes = 1024 * 1024;
+    config.read_timeout_millis = 200;
+    std::atomic<int> handled = 0;
+    auto server = TestServer(
+        config, [&handled](const Request& req, ResponseWriter& resp) {
+            handled++;
+            resp.WriteStatus(StatusCode::OK);
+            resp.WriteData(std::format("read {}", req.body.size()));
+        });
+
+    // Act
+    UnbufferedClientSocket large(server.port());
+    std::string body(config.max_body_bytes, 'x');
+    large.Write(std::format(
+        "POST / HTTP/1.1\r\nContent-Length: {}\r\n"
+        "Connection: close\r\n\r\n",
+        body.size()));
+    large.Write(body);
+    auto accepted = large.ReadAll();
+    // The client keeps sending after it's been turned away, which
+    // mustn't keep it from getting the response.
+    UnbufferedClientSocket huge(server.port());
+    huge.Write("POST / HTTP/1.1\r\nContent-Length: 2000000000\r\n\r\n");
+    huge.Write(body);
+    auto rejected = huge.ReadAll();
+
+    // Assert
+    EXPECT_SUBSTR(accepted, "HTTP/1.1 200 OK");
+    EXPECT_SUBSTR(accepted, std::format("read {}", body.size()));
+    EXPECT_SUBSTR(rejected, "HTTP/1.1 413 Payload Too Large");
+    EXPECT_SUBSTR(rejected, "Connection: close");
+    EXPECT_EQ(1, handled);
+}
+
+TEST(HttpServer, MaxConnections) {
+    // Arrange
+    auto config = kTestConfig;
+    config.max_connections = 2;
+    auto server =
+        TestServer(config, [](const Request& req, ResponseWriter& resp) {
+            resp.WriteStatus(StatusCode::OK);
+        });
+    auto a = std::make_unique<UnbufferedClientSocket>(server.port());
+    UnbufferedClientSocket b(server.port());
+    for (UnbufferedClientSocket* sock : {a.get(), &b}) {
+        sock->Write("GET / HTTP/1.1\r\n\r\n");
+        sock->Read();
+    }
+
+    // Act
+    UnbufferedClientSocket c(server.port());
+    auto rejected = c.ReadAll();
+    a.reset();
+    // The server notices the client hanging up in its own time.
+    std::string accepted;
+    for (int i = 0; i < 100; i++) {
+        accepted = Call(server.port(), Method::GET, "/");
+        if (accepted.starts_with("HTTP/1.1 200 OK")) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    // Assert
+    EXPECT_SUBSTR(rejected, "HTTP/1.1 503 Service Unavailable");
+    EXPECT_SUBSTR(accepted, "HTTP/1.1 200 OK");
+}
+
+TEST(HttpServer, OutOfFileDescriptors) {
+    // Arrange
+    auto server = TestServer([](const Request& req, ResponseWriter& resp) {
+        resp.WriteStatus(StatusCode::OK);
+    });
+    rlimit limit;
+    getrlimit(RLIMIT_NOFILE, &limit);
+    int lowest = dup(0);
+    close(lowest);
+
+    // Act
+    // Leave room for the client's socket, but not the server's.
+    rlimit lowered = limit;
+    lowered.rlim_cur = lowest + 1;
+    setrlimit(RLIMIT_NOFILE, &lowered);
+    std::string rejected;
+    {
+        UnbufferedClientSocket sock(server.port());
+        rejected = sock.ReadAll();
+    }
+    setrlimit(RLIMIT_NOFILE, &limit);
+    // The server stops accepting for a while, but this waits in the
+    // backlog until it starts again.
+    auto accepted = Call(server.port(), Method::GET, "/");
+
+    // Assert
+    EXPECT_SUBSTR(rejected, "HTTP/1.1 503 Service Unavailable");
+    EXPECT_SUBSTR(accepted, "HTTP/1.1 200 OK");
+}
+
+TEST(HttpServer, UnixSockets) {
+    // Arrange
+    std::string path = std::format("/tmp/gabby_server_test_{}.sock", getpid());
+    std::string abstract = std::format("@gabby_server_test_{}", getpid());
+    auto config = kTestConfig;
+    config.unix_sockets = {path, abstract};
+    auto server = std::make_unique<TestServer>(
+        config, [](const Request& req, ResponseWriter& resp) {
+            resp.WriteStatus(StatusCode::OK);
+            resp.WriteData(std::format("{} {}", req.path, req.addr));
+        });
+
+    // Act
+    auto tcp = Call(server->port(), Method::GET, "/tcp");
+    UnbufferedClientSocket file(path);
+    file.Write("GET /file HTTP/1.1\r\nConnection: close\r\n\r\n");
+    auto over_file = file.ReadAll();
+    UnbufferedClientSocket named(abstract);
+    named.Write("GET /abstract HTTP/1.1\r\nConnection: close\r\n\r\n");
+    auto over_abstract = named.ReadAll();
+    server.reset();
+
+    // Assert
+    EXPECT_SUBSTR(tcp, "/tcp 127.0.0.1");
+    EXPECT_SUBSTR(over_file, "HTTP/1.1 200 OK");
+    EXPECT_SUBSTR(over_file, "/file unix");
+    EXPECT_SUBSTR(over_abstract, "/abstract unix");
+    // The socket file is removed once the server stops.
+    EXPECT_TRUE(access(path.c_str(), F_OK) != 0);
+}
+
+TEST(HttpServer, UnixSocketOnly) {
+    // Arrange
+    std::string path = std::format("@gabby_server_test_only_{}", getpid());
+    auto config = kTestConfig;
+    config.port = -1;
+    config.unix_sockets = {path};
+    auto server =
+        TestServer(config, [](const Request& req, ResponseWriter& resp) {
+            resp.WriteStatus(StatusCode::OK);
+        });
+
+    // Act
+    UnbufferedClientSocket sock(path);
+    sock.Write("GET / HTTP/1.1\r\nConnection: close\r\n\r\n");
+    auto result = sock.ReadAll();
+
+    // Assert
+    EXPECT_SUBSTR(result, "HTTP/1.1 200 OK");
+    EXPECT_EQ(-1, server.port());
+}
+
+TEST(HttpServer, DrainFinishesAcceptedRequests) {
+    // Arrange
+    auto config = kTestConfig;
+    config.worker_threads = 1;
+    // long enough that waiting on it would fail the test
+    config.keep_alive_timeout_millis = 10000;
+    auto server =
+        TestServer(config, [](const Request& req, ResponseWriter& resp) {
+            if (req.path != "/idle") {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+            resp.WriteStatus(StatusCode::OK);
+        });
+
+    // Act
+    // A persistent connection is idle after its first request. One
+    // request is being handled and another is queued behind it when the
+    // server starts draining, and a third arrives on an open connection
+    // after that.
+    UnbufferedClientSocket idle(server.port());
+    idle.Write("GET /idle HTTP/1.1\r\n\r\n");
+    auto idle_result = idle.Read();
+    auto running = std::make_unique<UnbufferedClientSocket>(server.port());
+    running->Write("GET /a HTTP/1.1\r\nConnection: close\r\n\r\n");
+    auto queued = std::make_unique<UnbufferedClientSocket>(server.port());
+    queued->Write("GET /b HTTP/1.1\r\nConnection: close\r\n\r\n");
+    auto open = std::make_unique<UnbufferedClientSocket>(server.port());
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    auto start = Clock::now();
+    server.Drain();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    bool refused = false;
+    try {
+        Call(server.port(), Method::GET, "/c");
+    } catch (const std::exception& e) {
+        refused = true;
+    }
+    open->Write("GET /d HTTP/1.1\r\n\r\n");
+    // each client hangs up once it's read its response, which is what
+    // the server waits for before it closes the connection
+    auto running_result = running->ReadAll();
+    running.reset();
+    auto queued_result = queued->ReadAll();
+    queued.reset();
+    auto open_result = open->ReadAll();
+    open.reset();
+    server.Wait();
+    auto elapsed = Clock::now() - start;
+    // The idle connection should be closed rather than kept until it
+    // times out.
+    idle_result += idle.ReadAll();
+
+    // Assert
+    EXPECT_TRUE(refused);
+    EXPECT_EQ(1, CountSubstr(idle_result, "HTTP/1.1 200 OK"));
+    EXPECT_SUBSTR(running_result, "HTTP/1.1 200 OK");
+    EXPECT_SUBSTR(queued_result, "HTTP/1.1 200 OK");
+    EXPECT_SUBSTR(open_result, "HTTP/1.1 200 OK");
+    EXPECT_SUBSTR(open_result, "Connection: close");
+    EXPECT_TRUE(elapsed < std::chrono::seconds(5));
+}
+
+TEST(HttpServer, DrainGivesUpAtDeadline) {
+    // Arrange
+    auto config = kTestConfig;
+    config.drain_timeout_millis = 50;
+    auto server =
+        TestServer(config, [](const Request& req, ResponseWriter& resp) {
+            resp.WriteStatus(StatusCode::OK);
+        });
+
+    // Act
+    // The client never finishes its request.
+    UnbufferedClientSocket sock(server.port());
+    sock.Write("GET / HTTP/1.1\r\n");
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    auto start = Clock::now();
+    server.Drain();
+    server.Wait();
+    auto elapsed = Clock::now() - start;
+
+    // Assert
+    // The read timeout is much longer than the drain timeout.
+    EXPECT_TRUE(elapsed < std::chrono::seconds(1));
 }
 
 TEST(HttpServer, CallConcurrently) {
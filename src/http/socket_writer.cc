@@ -0,0 +1,187 @@
+#include "http/socket_writer.h"
+
+#include <sys/poll.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <format>
+#include <iterator>
+
+#include "utils/logging.h"
+
+namespace gabby {
+namespace http {
+
+namespace {
+
+// once the head has been sent, we hold on to at most this much data
+// before sending it
+constexpr int kWriteBufferSize = 4096;
+
+// header blocks that are the same for every response
+constexpr std::string_view kServerHeader = "Server: gabby\r\n";
+constexpr std::string_view kKeepAliveHeader =
+    "Connection: keep-alive\r\n\r\n";
+constexpr std::string_view kCloseHeader = "Connection: close\r\n\r\n";
+constexpr std::string_view kContentLength = "Content-Length: ";
+constexpr std::string_view kChunkedHeader = "Transfer-Encoding: chunked\r\n";
+constexpr std::string_view kCRLF = "\r\n";
+constexpr std::string_view kLastChunk = "0\r\n\r\n";
+
+// the most buffers that go into a single sendmsg
+constexpr int kMaxBuffers = 10;
+
+struct iovec View(std::string_view s) {
+    return {.iov_base = const_cast<char*>(s.data()), .iov_len = s.size()};
+}
+
+}  // namespace
+
+void SocketWriter::Send(struct iovec* iov, int n) {
+    // the socket is non-blocking, so wait for it to drain if it fills up
+    while (true) {
+        while (n > 0 && iov->iov_len == 0) iov++, n--;
+        if (n == 0) return;
+        struct msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = n;
+        ssize_t sent = ::sendmsg(fd_, &msg, MSG_NOSIGNAL);
+        if (sent >= 0) {
+            LOG(DEBUG) << "sent " << sent << " bytes in response";
+            bytes_written_ += sent;
+            for (; n > 0 && size_t(sent) >= iov->iov_len; iov++, n--) {
+                sent -= iov->iov_len;
+            }
+            if (n > 0) {
+                iov->iov_base = static_cast<char*>(iov->iov_base) + sent;
+                iov->iov_len -= sent;
+            }
+            continue;
+        }
+        if (errno == EINTR) continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            throw InternalError("failed to write data");
+        }
+        if (finishing_ && overflow_ != nullptr) {
+            for (; n > 0; iov++, n--) {
+                overflow_->append(static_cast<char*>(iov->iov_base),
+                                  iov->iov_len);
+                bytes_written_ += iov->iov_len;
+            }
+            return;
+        }
+        struct pollfd pfd{.fd = fd_, .events = POLLOUT};
+        int ret = ::poll(&pfd, 1, timeout_millis_);
+        if (ret == 0) throw TimeoutException{};
+        if (ret < 0 && errno != EINTR) throw SystemError(errno);
+    }
+}
+
+void SocketWriter::SendHead(std::optional<size_t> content_length,
+                            bool last) {
+    if (!status_.has_value()) status_ = StatusCode::OK;
+    if (!content_length.has_value()) {
+        chunked_ = can_chunk_;
+        if (!chunked_) keep_alive_ = false;
+    }
+
+    // Content-Length: <n>\r\n
+    char length[64];
+    char* end = length;
+    if (content_length.has_value()) {
+        end = std::copy(kContentLength.begin(), kContentLength.end(), end);
+        end = std::to_chars(end, length + sizeof(length), *content_length).ptr;
+        end = std::copy(kCRLF.begin(), kCRLF.end(), end);
+    }
+
+    struct iovec iov[kMaxBuffers] = {
+        View(StatusLine(*status_)),
+        View(kServerHeader),
+        View(headers_),
+        View(chunked_ ? kChunkedHeader
+                      : std::string_view(length, end - length)),
+        View(keep_alive_ ? kKeepAliveHeader : kCloseHeader),
+    };
+    head_sent_ = true;
+    SendWithBody(iov, 5, last);
+}
+
+void SocketWriter::SendWithBody(struct iovec* iov, int n, bool last) {
+    // <size in hex>\r\n<data>\r\n. an empty chunk would end the body.
+    char size[32];
+    if (chunked_ && !body_.empty()) {
+        char* end =
+            std::to_chars(size, size + sizeof(size), body_.size(), 16).ptr;
+        end = std::copy(kCRLF.begin(), kCRLF.end(), end);
+        iov[n++] = View(std::string_view(size, end - size));
+        iov[n++] = View(body_);
+        iov[n++] = View(kCRLF);
+    } else {
+        iov[n++] = View(body_);
+    }
+    if (chunked_ && last) iov[n++] = View(kLastChunk);
+    Send(iov, n);
+    body_.clear();
+}
+
+void SocketWriter::Flush() {
+    LOG(DEBUG) << "flushing response to client";
+    if (!head_sent_) return SendHead(std::nullopt, false);
+    struct iovec iov[4];
+    SendWithBody(iov, 0, false);
+}
+
+bool SocketWriter::Finish() {
+    finishing_ = true;
+    if (!head_sent_) {
+        SendHead(body_.size(), true);
+    } else {
+        struct iovec iov[4];
+        SendWithBody(iov, 0, true);
+    }
+    return keep_alive_;
+}
+
+void SocketWriter::Reset() {
+    assert(!head_sent_);
+    status_.reset();
+    headers_.clear();
+    body_.clear();
+    sending_data_ = false;
+}
+
+void SocketWriter::WriteStatus(StatusCode status) {
+    if (sending_data_) {
+        LOG(ERROR) << std::format("can't send status {}, already sending data",
+                                  int(status));
+        throw InternalError("failed to send http status");
+    }
+    status_ = status;
+}
+
+void SocketWriter::WriteHeader(std::string_view key, std::string_view value) {
+    if (sending_data_) {
+        LOG(ERROR) << std::format("can't send header {}, already sending data",
+                                  key);
+        throw InternalError("failed to send http status");
+    }
+    headers_.append(key).append(": ").append(value).append("\r\n");
+}
+
+void SocketWriter::WriteData(std::string_view data) {
+    if (!sending_data_) {
+        if (!status_.has_value()) {
+            WriteStatus(StatusCode::OK);
+        }
+        sending_data_ = true;
+    }
+    body_.append(data);
+    if (head_sent_ && body_.size() > kWriteBufferSize) Flush();
+}
+
+}  // namespace http
+}  // namespace gabby
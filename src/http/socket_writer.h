@@ -0,0 +1,104 @@
+#ifndef GABBY_HTTP_SOCKET_WRITER_H_
+#define GABBY_HTTP_SOCKET_WRITER_H_
+
+#include <sys/uio.h>
+
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "http/types.h"
+
+namespace gabby {
+namespace http {
+
+// buffers the response so that it can be sent with a Content-Length,
+// unless the handler flushes it early. in that case it's sent as it's
+// written with chunked transfer encoding, or for clients that don't
+// support that, delimited by closing the connection.
+//
+// the status line, headers and body are sent together with a single
+// sendmsg, without being copied into one buffer first.
+class SocketWriter : public ResponseWriter {
+public:
+    // |fd| must be non-blocking and outlive the constructed instance.
+    // |can_chunk| is whether the client supports chunked encoding. the
+    // response is buffered in memory from |arena|.
+    SocketWriter(
+        int fd, int timeout_millis, bool keep_alive, bool can_chunk,
+        std::pmr::memory_resource* arena = std::pmr::get_default_resource())
+        : fd_(fd),
+          timeout_millis_(timeout_millis),
+          keep_alive_(keep_alive),
+          can_chunk_(can_chunk),
+          headers_(arena),
+          body_(arena) {}
+
+    // sends everything written so far. after this, the response can
+    // no longer be sent with a Content-Length.
+    void Flush() override;
+
+    // sets the http status code. it is an error to call this after any
+    // data has been written.
+    // TODO: return a different object here to enfroce this.
+    void WriteStatus(StatusCode code) override;
+
+    // writes the specified http header. it is an error to call this
+    // after any other data has been sent.
+    // TODO: return a different object here to enfroce this.
+    void WriteHeader(std::string_view key, std::string_view value) override;
+
+    // writes the specified data into the response. if a status has not
+    // already been set, this will set StatusCode::OK first.
+    void WriteData(std::string_view data) override;
+
+    std::optional<StatusCode> status() override { return status_; }
+
+    // sends the rest of the response and returns whether the connection
+    // can be reused
+    bool Finish();
+
+    // if set, Finish doesn't wait for the client to take the rest of
+    // the response. whatever the socket won't take right away is
+    // appended to |out| for the caller to send.
+    void set_overflow(std::string* out) { overflow_ = out; }
+
+    // discards everything written so far. it is an error to call this
+    // once anything has been sent.
+    void Reset();
+
+    bool head_sent() const { return head_sent_; }
+
+    int bytes_written() const { return bytes_written_; }
+
+private:
+    // sends the head, followed by whatever body has been written so far
+    // and the final chunk if |last|
+    void SendHead(std::optional<size_t> content_length, bool last);
+
+    // sends the |n| buffers in |iov|, which must have room for four
+    // more, followed by the body as above
+    void SendWithBody(struct iovec* iov, int n, bool last);
+
+    void Send(struct iovec* iov, int n);
+
+    int fd_;
+    int timeout_millis_;
+    bool keep_alive_;
+    bool can_chunk_;
+    bool chunked_ = false;
+    std::optional<StatusCode> status_;
+    std::pmr::string headers_;  // rendered, as sent
+    std::pmr::string body_;
+    bool sending_data_ = false;
+    bool head_sent_ = false;
+    bool finishing_ = false;
+    std::string* overflow_ = nullptr;
+    int bytes_written_ = 0;
+};
+
+}  // namespace http
+}  // namespace gabby
+
+#endif  // GABBY_HTTP_SOCKET_WRITER_H_
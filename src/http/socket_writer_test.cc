@@ -0,0 +1,169 @@
+#include "http/socket_writer.h"
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <functional>
+#include <string>
+#include <thread>
+
+#include "test/test.h"
+#include "utils/logging.h"
+#include "utils/pointers.h"
+
+namespace gabby {
+namespace http {
+
+namespace {
+
+// runs |write| against a writer for one end of a socket pair, and
+// returns everything that was read from the other end
+std::string WriteAndRead(bool keep_alive, bool can_chunk,
+                         std::function<void(SocketWriter&)> write) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) throw SystemError(errno);
+    OwnedFd reader = Own(fds[0]), writer = Own(fds[1]);
+    fcntl(*writer, F_SETFL, fcntl(*writer, F_GETFL) | O_NONBLOCK);
+
+    std::string result;
+    std::thread t([&result, fd = *reader] {
+        char buf[4096];
+        ssize_t n;
+        while ((n = ::read(fd, buf, sizeof(buf))) > 0) result.append(buf, n);
+    });
+    {
+        SocketWriter resp(*writer, 5000, keep_alive, can_chunk);
+        write(resp);
+    }
+    writer.reset();
+    t.join();
+    return result;
+}
+
+}  // namespace
+
+TEST(SocketWriter, SendsContentLength) {
+    // Arrange
+    bool keep_alive = false;
+
+    // Act
+    std::string result =
+        WriteAndRead(true, true, [&keep_alive](SocketWriter& resp) {
+            resp.WriteStatus(StatusCode::NotFound);
+            resp.WriteHeader("Content-Type", "application/json");
+            resp.WriteData("{}");
+            resp.WriteData("\n");
+            keep_alive = resp.Finish();
+        });
+
+    // Assert
+    EXPECT_TRUE(keep_alive);
+    EXPECT_EQ(
+        "HTTP/1.1 404 Not Found\r\n"
+        "Server: gabby\r\n"
+        "Content-Type: application/json\r\n"
+        "Content-Length: 3\r\n"
+        "Connection: keep-alive\r\n"
+        "\r\n"
+        "{}\n",
+        result);
+}
+
+TEST(SocketWriter, FlushSendsChunks) {
+    // Arrange
+    bool keep_alive = false;
+
+    // Act
+    std::string result =
+        WriteAndRead(true, true, [&keep_alive](SocketWriter& resp) {
+            resp.WriteData("a");
+            resp.Flush();
+            resp.Flush();
+            resp.WriteData("0123456789abcdef");
+            keep_alive = resp.Finish();
+        });
+
+    // Assert
+    // Flushing without any new data shouldn't end the body.
+    EXPECT_TRUE(keep_alive);
+    EXPECT_EQ(
+        "HTTP/1.1 200 OK\r\n"
+        "Server: gabby\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "Connection: keep-alive\r\n"
+        "\r\n"
+        "1\r\na\r\n"
+        "10\r\n0123456789abcdef\r\n"
+        "0\r\n\r\n",
+        result);
+}
+
+TEST(SocketWriter, FlushDelimitsResponseByClosing) {
+    // Arrange
+    // The client doesn't support chunked encoding.
+    bool keep_alive = true;
+
+    // Act
+    std::string result =
+        WriteAndRead(true, false, [&keep_alive](SocketWriter& resp) {
+            resp.WriteData("a");
+            resp.Flush();
+            resp.WriteData("b");
+            keep_alive = resp.Finish();
+        });
+
+    // Assert
+    EXPECT_FALSE(keep_alive);
+    EXPECT_EQ(
+        "HTTP/1.1 200 OK\r\n"
+        "Server: gabby\r\n"
+        "Connection: close\r\n"
+        "\r\n"
+        "ab",
+        result);
+}
+
+TEST(SocketWriter, SendsLargeBodies) {
+    // Arrange
+    // Large enough to fill up the socket buffer several times.
+    std::string data(8 * 1024 * 1024, 'x');
+    int bytes_written = 0;
+
+    // Act
+    std::string result = WriteAndRead(false, true, [&](SocketWriter& resp) {
+        resp.WriteData(data);
+        resp.Finish();
+        bytes_written = resp.bytes_written();
+    });
+
+    // Assert
+    EXPECT_SUBSTR(result, "Content-Length: 8388608\r\n");
+    EXPECT_SUBSTR(result, "Connection: close\r\n");
+    EXPECT_TRUE(result.ends_with("\r\n\r\n" + data));
+    EXPECT_EQ(int(result.size()), bytes_written);
+}
+
+TEST(SocketWriter, ResetDiscardsResponse) {
+    // Act
+    std::string result = WriteAndRead(false, true, [](SocketWriter& resp) {
+        resp.WriteHeader("X-Foo", "bar");
+        resp.WriteData("partial");
+        resp.Reset();
+        resp.WriteStatus(StatusCode::InternalServerError);
+        resp.Finish();
+    });
+
+    // Assert
+    EXPECT_EQ(
+        "HTTP/1.1 500 Internal Server Error\r\n"
+        "Server: gabby\r\n"
+        "Content-Length: 0\r\n"
+        "Connection: close\r\n"
+        "\r\n",
+        result);
+}
+
+}  // namespace http
+}  // namespace gabby
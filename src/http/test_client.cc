@@ -4,6 +4,7 @@
 #include <netinet/in.h>
 #include <sys/poll.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <unistd.h>
 
 #include <cerrno>
@@ -35,6 +36,18 @@ UnbufferedClientSocket::UnbufferedClientSocket(int port) {
     }
 }
 
+UnbufferedClientSocket::UnbufferedClientSocket(std::string_view path) {
+    struct sockaddr_un addr;
+    socklen_t len = UnixSocketAddress(path, &addr);
+    fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd_ < 0) throw SystemError(errno);
+    if (connect(fd_, (struct sockaddr*)&addr, len) < 0) {
+        int err = errno;
+        close(fd_);
+        throw SystemError(err);
+    }
+}
+
 void UnbufferedClientSocket::Write(const std::string_view data) {
     if (data.empty()) return;
     for (int n = 0; n < data.size();) {
@@ -57,6 +70,13 @@ std::string UnbufferedClientSocket::ReadAll() {
     return data;
 }
 
+std::string UnbufferedClientSocket::Read() {
+    char buf[1024];
+    int n = read(fd_, buf, 1024);
+    if (n < 0) throw SystemError(errno);
+    return std::string(buf, n);
+}
+
 void WriteHeader(UnbufferedClientSocket& sock, const std::string_view key,
                  const std::string_view value) {
     sock.Write(std::format("{}: {}\r\n", key, value));
@@ -78,6 +98,10 @@ std::string Call(int port, Method method, const std::string_view path,
                 WriteHeader(sock, key, value);
                 sock.Write(std::format("{}: {}\r\n", key, value));
             }
+            // we read the response until eof
+            if (!headers.contains("Connection")) {
+                WriteHeader(sock, "Connection", "close");
+            }
             if (!data.empty()) {
                 WriteHeader(sock, "Content-Length",
                             std::to_string(data.size()));
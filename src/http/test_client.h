@@ -20,9 +20,16 @@ public:
     ~UnbufferedClientSocket();
 
     explicit UnbufferedClientSocket(int port);
+    // connects to the unix domain socket at |path|, which is in the
+    // abstract namespace if it starts with @
+    explicit UnbufferedClientSocket(std::string_view path);
     void Write(const std::string_view data);
     std::string ReadAll();
 
+    // blocks until some data is available and returns it, or returns
+    // an empty string at eof
+    std::string Read();
+
 private:
     int fd_;
 };
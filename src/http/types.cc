@@ -1,9 +1,12 @@
 #include "http/types.h"
 
 #include <cassert>
+#include <cctype>
+#include <cstddef>
 #include <cstring>
 #include <format>
 #include <iostream>
+#include <stdexcept>
 
 #include "unistd.h"
 #include "utils/logging.h"
@@ -15,9 +18,34 @@ std::string to_string(StatusCode code) {
     switch (code) {
         case StatusCode::OK: return "OK";
         case StatusCode::NotFound: return "Not Found";
+        case StatusCode::MethodNotAllowed: return "Method Not Allowed";
         case StatusCode::BadRequest: return "Bad Request";
         case StatusCode::RequestTimeout: return "Request Timeout";
+        case StatusCode::PayloadTooLarge: return "Payload Too Large";
         case StatusCode::InternalServerError: return "Internal Server Error";
+        case StatusCode::ServiceUnavailable: return "Service Unavailable";
+        case StatusCode::SiteOverloaded: return "Site is overloaded";
+    }
+    assert(false);
+}
+
+std::string_view StatusLine(StatusCode code) {
+    switch (code) {
+        case StatusCode::OK: return "HTTP/1.1 200 OK\r\n";
+        case StatusCode::NotFound: return "HTTP/1.1 404 Not Found\r\n";
+        case StatusCode::MethodNotAllowed:
+            return "HTTP/1.1 405 Method Not Allowed\r\n";
+        case StatusCode::BadRequest: return "HTTP/1.1 400 Bad Request\r\n";
+        case StatusCode::RequestTimeout:
+            return "HTTP/1.1 408 Request Timeout\r\n";
+        case StatusCode::PayloadTooLarge:
+            return "HTTP/1.1 413 Payload Too Large\r\n";
+        case StatusCode::InternalServerError:
+            return "HTTP/1.1 500 Internal Server Error\r\n";
+        case StatusCode::ServiceUnavailable:
+            return "HTTP/1.1 503 Service Unavailable\r\n";
+        case StatusCode::SiteOverloaded:
+            return "HTTP/1.1 529 Site is overloaded\r\n";
     }
     assert(false);
 }
@@ -30,6 +58,42 @@ std::string to_string(Method method) {
     assert(false);
 }
 
+bool EqualsIgnoreCase(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (std::tolower(static_cast<unsigned char>(a[i])) !=
+            std::tolower(static_cast<unsigned char>(b[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+socklen_t UnixSocketAddress(std::string_view path, sockaddr_un* addr) {
+    std::memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    // filesystem paths need room for a trailing nul
+    if (path.empty() || path.size() >= sizeof(addr->sun_path)) {
+        throw std::invalid_argument(
+            std::format("bad unix socket path: {}", path));
+    }
+    std::memcpy(addr->sun_path, path.data(), path.size());
+    // abstract names are the bytes after a leading nul, without one at
+    // the end
+    if (path[0] == '@') {
+        addr->sun_path[0] = '\0';
+        return offsetof(sockaddr_un, sun_path) + path.size();
+    }
+    return offsetof(sockaddr_un, sun_path) + path.size() + 1;
+}
+
+std::optional<std::string_view> Headers::get(std::string_view key) const {
+    for (const auto& [k, v] : headers_) {
+        if (EqualsIgnoreCase(k, key)) return v;
+    }
+    return {};
+}
+
 std::ostream& operator<<(std::ostream& os, StatusCode status) {
     return os << to_string(status);
 }
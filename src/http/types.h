@@ -1,11 +1,17 @@
 #ifndef GABBY_HTTP_TYPES_H_
 #define GABBY_HTTP_TYPES_H_
 
+#include <sys/socket.h>
+#include <sys/un.h>
+
 #include <functional>
+#include <memory_resource>
 #include <optional>
 #include <ostream>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #include "json/json.h"
 
@@ -16,8 +22,13 @@ enum class StatusCode : int {
     OK = 200,
     BadRequest = 400,
     NotFound = 404,
+    MethodNotAllowed = 405,
     RequestTimeout = 408,
+    PayloadTooLarge = 413,
     InternalServerError = 500,
+    ServiceUnavailable = 503,
+    // nonstandard, but widely used to signal that a server is overloaded
+    SiteOverloaded = 529,
 };
 
 std::ostream& operator<<(std::ostream& os, StatusCode status);
@@ -46,6 +57,13 @@ public:
     StatusCode status() const override { return StatusCode::BadRequest; }
 };
 
+class PayloadTooLargeException : public HttpException {
+public:
+    explicit PayloadTooLargeException(std::string what)
+        : HttpException(what) {}
+    StatusCode status() const override { return StatusCode::PayloadTooLarge; }
+};
+
 class TimeoutException : public HttpException {
 public:
     explicit TimeoutException() : HttpException("request timeout") {}
@@ -65,14 +83,90 @@ enum class Method {
 
 std::ostream& operator<<(std::ostream&, Method method);
 std::string to_string(StatusCode code);
+
+// returns the status line for |code|, including the trailing CRLF
+std::string_view StatusLine(StatusCode code);
 std::string to_string(Method method);
 
+bool EqualsIgnoreCase(std::string_view a, std::string_view b);
+
+// fills in |addr| for the unix domain socket at |path|, which is in the
+// abstract namespace if it starts with @, and returns its length. throws
+// std::invalid_argument if |path| is empty or too long.
+socklen_t UnixSocketAddress(std::string_view path, sockaddr_un* addr);
+
+// http headers, looked up case-insensitively. keys and values point
+// into the buffer that the request was read into.
+class Headers {
+public:
+    using Header = std::pair<std::string_view, std::string_view>;
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    Headers() = default;
+    explicit Headers(allocator_type alloc) : headers_(alloc) {}
+
+    void add(std::string_view key, std::string_view value) {
+        headers_.emplace_back(key, value);
+    }
+
+    // returns the value of the first header named |key|, if any
+    std::optional<std::string_view> get(std::string_view key) const;
+    bool contains(std::string_view key) const { return get(key).has_value(); }
+
+    size_t size() const { return headers_.size(); }
+    std::pmr::vector<Header>::const_iterator begin() const {
+        return headers_.begin();
+    }
+    std::pmr::vector<Header>::const_iterator end() const {
+        return headers_.end();
+    }
+
+private:
+    // requests have few enough headers that a linear scan beats hashing
+    std::pmr::vector<Header> headers_;
+};
+
+// parameters captured from the request path by the router, like |id|
+// in /v1/models/{id}. values point into the request path.
+class PathParams {
+public:
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    PathParams() = default;
+    explicit PathParams(allocator_type alloc) : params_(alloc) {}
+
+    void add(std::string_view key, std::string_view value) {
+        params_.emplace_back(key, value);
+    }
+    void pop() { params_.pop_back(); }
+
+    std::optional<std::string_view> get(std::string_view key) const {
+        for (const auto& [k, v] : params_) {
+            if (k == key) return v;
+        }
+        return {};
+    }
+    size_t size() const { return params_.size(); }
+
+private:
+    std::pmr::vector<std::pair<std::string_view, std::string_view>> params_;
+};
+
+// a parsed request. everything but |addr| points into the connection's
+// buffer, so it's only valid while the request is being handled.
 struct Request {
     std::string addr;
     Method method;
-    std::string path;
-    std::unordered_map<std::string, std::string> headers;
-    FILE* stream;
+    std::string_view path;
+    Headers headers;
+    std::string_view body;
+    PathParams params;
+    // the pattern of the route that matched the path, if any
+    std::string_view route;
+    // scratch memory for handling the request, which is all released at
+    // once when it's done. nothing allocated from it may outlive the
+    // request.
+    std::pmr::memory_resource* arena = std::pmr::get_default_resource();
 };
 
 std::ostream& operator<<(std::ostream& os, const Request& req);
@@ -81,6 +175,10 @@ class ResponseWriter {
 public:
     virtual ~ResponseWriter() {}
 
+    // sends everything written so far, so that a response can be
+    // streamed to the client as it's produced. once a response has been
+    // flushed, the rest is sent with chunked transfer encoding, or for
+    // http/1.0 clients, delimited by closing the connection.
     virtual void Flush() = 0;
 
     // writes an http header with the specified status code. it is an
@@ -91,7 +189,7 @@ public:
     // writes the specified http header. it is an error to call this
     // after any other data has been sent.
     // TODO: return a different object here to enfroce this.
-    virtual void WriteHeader(std::string key, std::string value) = 0;
+    virtual void WriteHeader(std::string_view key, std::string_view value) = 0;
 
     // writes the specified data into the response. if a status has not
     // already been sent, this will write StatusCode::OK first.
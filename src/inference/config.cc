@@ -1,6 +1,6 @@
 #include "inference/config.h"
 
-#include "json/parser.h"
+#include "json/document.h"
 #include "utils/logging.h"
 
 namespace gabby {
@@ -10,19 +10,21 @@ namespace fs = std::filesystem;
 
 std::unique_ptr<InferenceConfig> LoadConfig(const std::filesystem::path& dir) {
     LOG(DEBUG) << "loading model from: " << dir;
-    auto config = json::ParseFile(dir / "config.json");
-    auto gen_config = json::ParseFile(dir / "generation_config.json");
-    auto special_tokens_map = json::ParseFile(dir / "special_tokens_map.json");
-    auto tok_config = json::ParseFile(dir / "tokenizer_config.json");
-    auto tok = json::ParseFile(dir / "tokenizer.json");
+    auto config = json::Document::ParseFile(dir / "config.json");
+    auto gen_config = json::Document::ParseFile(dir / "generation_config.json");
+    auto special_tokens_map =
+        json::Document::ParseFile(dir / "special_tokens_map.json");
+    auto tok_config = json::Document::ParseFile(dir / "tokenizer_config.json");
+    // tokenizer.json is several megabytes, and we only need part of it
+    auto vocab = LoadVocabulary(dir / "tokenizer.json");
     auto tensors = Safetensors::LoadFile(dir / "model.safetensors");
     LOG(DEBUG) << "successfully loaded model";
     return std::unique_ptr<InferenceConfig>(new InferenceConfig{
-        .config = config,
-        .gen_config = gen_config,
-        .special_tokens_map = special_tokens_map,
-        .tok_config = tok_config,
-        .tok = tok,
+        .config = std::move(config),
+        .gen_config = std::move(gen_config),
+        .special_tokens_map = std::move(special_tokens_map),
+        .tok_config = std::move(tok_config),
+        .vocab = std::move(vocab),
         .tensors = std::move(tensors),
     });
 }
@@ -4,17 +4,18 @@
 #include <filesystem>
 
 #include "inference/safetensors.h"
-#include "json/json.h"
+#include "inference/tokenizer.h"
+#include "json/document.h"
 
 namespace gabby {
 namespace inference {
 
 struct InferenceConfig {
-    json::ValuePtr config;
-    json::ValuePtr gen_config;
-    json::ValuePtr special_tokens_map;
-    json::ValuePtr tok_config;
-    json::ValuePtr tok;
+    json::Document config;
+    json::Document gen_config;
+    json::Document special_tokens_map;
+    json::Document tok_config;
+    Vocabulary vocab;
     Safetensors tensors;
 };
 
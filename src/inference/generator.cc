@@ -30,11 +30,15 @@ std::ostream& operator<<(std::ostream& os, const Request& msg) {
                              to_string(msg.user_message));
 }
 
-Message Llama3Generator::Generate(const Request& req) {
-    return Message{
-        .role = "assistant",
-        .content = "hey this is gabby, how are u",
-    };
+Message Llama3Generator::Generate(const Request& req,
+                                  const TokenCallback& on_token) {
+    Message msg{.role = "assistant"};
+    for (std::string_view token : {"hey", " this", " is", " gabby", ",",
+                                   " how", " are", " u"}) {
+        on_token(token);
+        msg.content.append(token);
+    }
+    return msg;
 }
 
 /* static */
@@ -2,9 +2,11 @@
 #define GABBY_INFERENCE_GENERATOR_H_
 
 #include <filesystem>
+#include <functional>
 #include <memory>
 #include <ostream>
 #include <string>
+#include <string_view>
 
 #include "inference/config.h"
 #include "inference/safetensors.h"
@@ -29,13 +31,27 @@ std::ostream& operator<<(std::ostream& os, const Request& msg);
 
 class Generator {
 public:
+    // called with each piece of the response as it's generated
+    using TokenCallback = std::function<void(std::string_view token)>;
+
     virtual ~Generator() = default;
-    virtual Message Generate(const Request& req) = 0;
+
+    // generates a response to |req|, passing each token to |on_token| as
+    // soon as it's available, and returns the complete message
+    virtual Message Generate(const Request& req,
+                             const TokenCallback& on_token) = 0;
+
+    // generates the complete response to |req|
+    Message Generate(const Request& req) {
+        return Generate(req, [](std::string_view) {});
+    }
 };
 
 class Llama3Generator : public Generator {
 public:
-    Message Generate(const Request& req) override;
+    using Generator::Generate;
+    Message Generate(const Request& req,
+                     const TokenCallback& on_token) override;
 
     static std::unique_ptr<Generator> Load(
         std::unique_ptr<InferenceConfig> config);
@@ -6,8 +6,7 @@
 #include <cstdio>
 #include <memory>
 
-#include "json/json.h"
-#include "json/parser.h"
+#include "json/document.h"
 #include "utils/logging.h"
 
 namespace gabby {
@@ -28,11 +27,11 @@ Safetensors Safetensors::LoadFile(const std::filesystem::path& path) {
     LOG(DEBUG) << "header size: " << header_size;
 
     // get header
-    std::string s(data.get() + 8, data.get() + 8 + header_size);
-    json::ValuePtr header = json::Parse(s);
-    LOG(DEBUG) << "header: " << *header;
+    auto header = json::Document::ParseBorrowed(std::string_view(
+        reinterpret_cast<const char*>(data.get()) + 8, header_size));
+    LOG(DEBUG) << "header: " << header.root();
 
-    return Safetensors(std::move(data), header, 8 + header_size);
+    return Safetensors(std::move(data), std::move(header), 8 + header_size);
 }
 
 }  // namespace inference
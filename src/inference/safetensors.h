@@ -4,7 +4,7 @@
 #include <filesystem>
 #include <stdexcept>
 
-#include "json/json.h"
+#include "json/document.h"
 #include "utils/pointers.h"
 
 namespace gabby {
@@ -13,14 +13,17 @@ namespace inference {
 class Safetensors {
 public:
     static Safetensors LoadFile(const std::filesystem::path& path);
-    const json::ValuePtr header() const { return header_; }
+    const json::Node& header() const { return header_.root(); }
 
 private:
-    Safetensors(OwnedMmap mem, json::ValuePtr header, size_t data_offset)
-        : mem_(std::move(mem)), header_(header), data_offset_(data_offset) {}
+    Safetensors(OwnedMmap mem, json::Document header, size_t data_offset)
+        : mem_(std::move(mem)),
+          header_(std::move(header)),
+          data_offset_(data_offset) {}
 
     OwnedMmap mem_;
-    json::ValuePtr header_;
+    // parsed where it is in |mem_|
+    json::Document header_;
     size_t data_offset_ = 0;
 };
 
@@ -1,14 +1,100 @@
 #include "inference/tokenizer.h"
 
+#include "json/stream.h"
+#include "utils/pointers.h"
+
 namespace gabby {
 namespace inference {
 
+namespace {
+
+// picks the vocabulary out of the events of tokenizer.json
+class VocabularyReader : public json::Handler {
+public:
+    explicit VocabularyReader(Vocabulary& vocab) : vocab_(vocab) {}
+
+    void StartObject() override { ++depth_; }
+    void EndObject() override { --depth_; }
+    void StartArray() override {
+        if (++depth_ == 4 && in(Section::MERGES)) pair_.clear();
+    }
+    void EndArray() override {
+        if (depth_-- == 4 && in(Section::MERGES) && pair_.size() == 2) {
+            vocab_.merges.emplace_back(std::move(pair_[0]),
+                                       std::move(pair_[1]));
+        }
+    }
+
+    void Key(std::string_view key) override {
+        if (depth_ == 1) {
+            model_ = key == "model";
+            section_ = Section::NONE;
+        } else if (depth_ == 2) {
+            section_ = key == "vocab"    ? Section::VOCAB
+                       : key == "merges" ? Section::MERGES
+                                         : Section::NONE;
+        } else if (depth_ == 3 && in(Section::VOCAB)) {
+            token_.assign(key);
+        }
+    }
+
+    void Number(double n) override {
+        if (depth_ == 3 && in(Section::VOCAB)) {
+            vocab_.tokens.emplace(std::move(token_), int(n));
+        }
+    }
+
+    void String(std::string_view s) override {
+        if (!in(Section::MERGES)) return;
+        if (depth_ == 3) {
+            size_t space = s.find(' ');
+            if (space == std::string_view::npos) return;
+            vocab_.merges.emplace_back(s.substr(0, space),
+                                       s.substr(space + 1));
+        } else if (depth_ == 4) {
+            pair_.emplace_back(s);
+        }
+    }
+
+private:
+    enum class Section { NONE, VOCAB, MERGES };
+
+    // whether we're inside model.|section|
+    bool in(Section section) const {
+        return model_ && depth_ >= 3 && section_ == section;
+    }
+
+    Vocabulary& vocab_;
+    int depth_ = 0;
+    // the key we're under at the top level is "model"
+    bool model_ = false;
+    // which of the model's keys we're under
+    Section section_ = Section::NONE;
+    std::string token_;
+    std::vector<std::string> pair_;
+};
+
+}  // namespace
+
+Vocabulary LoadVocabulary(FILE* f) {
+    Vocabulary vocab;
+    VocabularyReader reader(vocab);
+    json::ParseStream(f, reader);
+    return vocab;
+}
+
+Vocabulary LoadVocabulary(const std::filesystem::path& path) {
+    OwnedStream f = Fopen(path.c_str(), "r");
+    return LoadVocabulary(f.get());
+}
+
 std::vector<int> Tokenizer::Tokenize(const std::string_view input) {
     return {};
 }
 
-Tokenizer::Tokenizer(json::ValuePtr special_tokens_map,
-                     json::ValuePtr tokenizer_config, json::ValuePtr tokens) {}
+Tokenizer::Tokenizer(const json::Document& special_tokens_map,
+                     const json::Document& tokenizer_config,
+                     const Vocabulary& vocab) {}
 
 }  // namespace inference
 }  // namespace gabby
@@ -1,19 +1,38 @@
 #ifndef GABBY_INFERENCE_TOKENIZER_H_
 #define GABBY_INFERENCE_TOKENIZER_H_
 
+#include <cstdio>
+#include <filesystem>
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
-#include "json/json.h"
+#include "json/document.h"
 
 namespace gabby {
 namespace inference {
 
+// the parts of tokenizer.json that tokenizing needs
+struct Vocabulary {
+    std::unordered_map<std::string, int> tokens;
+    std::vector<std::pair<std::string, std::string>> merges;
+};
+
+// reads model.vocab and model.merges from tokenizer.json, as it's read
+// in, without keeping the rest of it. merges can be either "a b"
+// strings or ["a", "b"] pairs.
+Vocabulary LoadVocabulary(FILE* f);
+Vocabulary LoadVocabulary(const std::filesystem::path& path);
+
 class Tokenizer {
 public:
     virtual ~Tokenizer() = default;
 
-    Tokenizer(json::ValuePtr special_tokens_map,
-              json::ValuePtr tokenizer_config, json::ValuePtr tokens);
+    Tokenizer(const json::Document& special_tokens_map,
+              const json::Document& tokenizer_config,
+              const Vocabulary& vocab);
 
     virtual std::vector<int> Tokenize(const std::string_view input);
 
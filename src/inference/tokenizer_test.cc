@@ -1,5 +1,8 @@
 #include "inference/tokenizer.h"
 
+#include <cstdio>
+#include <string>
+
 #include "test/env.h"
 #include "test/test.h"
 
@@ -8,21 +11,46 @@ namespace inference {
 
 TEST(Tokenizer, Empty) {
     const auto& config = GlobalConfig();
-    Tokenizer tok(config.special_tokens_map, config.tok_config, config.tok);
+    Tokenizer tok(config.special_tokens_map, config.tok_config, config.vocab);
     EXPECT_EQ(std::vector<int>{}, tok.Tokenize(""));
 }
 
 TEST(Tokenizer, Tokenize) {
     const auto& config = GlobalConfig();
-    Tokenizer tok(config.special_tokens_map, config.tok_config, config.tok);
+    Tokenizer tok(config.special_tokens_map, config.tok_config, config.vocab);
     EXPECT_EQ(std::vector<int>{}, tok.Tokenize(""));
 }
 
 TEST(Tokenizer, SpecialTokens) {
     const auto& config = GlobalConfig();
-    Tokenizer tok(config.special_tokens_map, config.tok_config, config.tok);
+    Tokenizer tok(config.special_tokens_map, config.tok_config, config.vocab);
     EXPECT_EQ(std::vector<int>{}, tok.Tokenize(""));
 }
 
+TEST(Vocabulary, Load) {
+    // Merges can be written either way.
+    std::string strings = R"(["a b", "ab c"])";
+    std::string pairs = R"([["a", "b"], ["ab", "c"]])";
+    for (const std::string& merges : {strings, pairs}) {
+        // Arrange
+        std::string json = R"({"version": "1.0", "added_tokens": [{"id": 3}],)"
+                           R"( "model": {"type": "BPE", "vocab": {"a": 0,)"
+                           R"( "b": 1, "ab": 2}, "merges": )" +
+                           merges + R"(}, "vocab": {"x": 9}})";
+        FILE* f = fmemopen(json.data(), json.size(), "r");
+
+        // Act
+        Vocabulary vocab = LoadVocabulary(f);
+        fclose(f);
+
+        // Assert
+        EXPECT_EQ(3, vocab.tokens.size());
+        EXPECT_EQ(2, vocab.tokens.at("ab"));
+        EXPECT_EQ(2, vocab.merges.size());
+        EXPECT_EQ("ab", vocab.merges[1].first);
+        EXPECT_EQ("c", vocab.merges[1].second);
+    }
+}
+
 }  // namespace inference
 }  // namespace gabby
@@ -0,0 +1,237 @@
+#include "json/bind.h"
+
+#include <charconv>
+#include <cmath>
+#include <format>
+#include <limits>
+#include <system_error>
+
+#include "json/scan.h"
+
+namespace gabby {
+namespace json {
+
+namespace {
+
+// deep enough for any document we expect, and shallow enough that a
+// hostile request body can't run the reader out of stack
+constexpr int kMaxDepth = 512;
+
+// whether |c| has to be escaped in a json string
+bool NeedsEscape(char c) {
+    return c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20;
+}
+
+}  // namespace
+
+void Reader::Read(bool& b) {
+    if (Peek() != Type::BOOL) throw TypeError(Type::BOOL, Peek());
+    b = *p_ == 't';
+    p_ = ScanLiteral(p_, end_, b ? "true" : "false");
+}
+
+void Reader::Read(double& n) {
+    if (Peek() != Type::NUM) throw TypeError(Type::NUM, Peek());
+    p_ = ScanNumber(p_, end_, &n);
+}
+
+void Reader::Read(int& n) {
+    int64_t wide;
+    Read(wide);
+    if (wide < std::numeric_limits<int>::min() ||
+        wide > std::numeric_limits<int>::max()) {
+        throw ParsingError(std::format("integer out of range: {}", wide));
+    }
+    n = int(wide);
+}
+
+void Reader::Read(int64_t& n) {
+    if (Peek() != Type::NUM) throw TypeError(Type::NUM, Peek());
+    const char* start = p_;
+    double d;
+    p_ = ScanNumber(p_, end_, &d);
+    std::string_view word(start, p_);
+    // the digits themselves, since a double can't hold every int64
+    auto [stop, err] = std::from_chars(start, p_, n);
+    if (err == std::errc::result_out_of_range) {
+        throw ParsingError(std::format("integer out of range: {}", word));
+    }
+    if (stop == p_) return;
+    // a fraction or an exponent, which is fine as long as it comes to a
+    // whole number. past 2^53, a double can't tell whether it does.
+    if (d != std::trunc(d)) {
+        throw ParsingError(std::format("not an integer: {}", word));
+    }
+    if (std::abs(d) > 0x1p53) {
+        throw ParsingError(std::format("integer out of range: {}", word));
+    }
+    n = int64_t(d);
+}
+
+void Reader::Read(std::string& s) {
+    if (Peek() != Type::STR) throw TypeError(Type::STR, Peek());
+    const char* start = ++p_;
+    bool escaped = false;
+    const char* stop = FindStringEnd(p_, end_, &escaped);
+    p_ = stop + 1;
+    if (!escaped) {
+        s.assign(start, stop);
+        return;
+    }
+    // decoding only ever shrinks a string
+    s.resize(stop - start);
+    s.resize(Unescape(std::string_view(start, stop), s.data()) - s.data());
+}
+
+void Reader::Read(std::nullptr_t&) {
+    if (!Null()) throw TypeError(Type::NIL, Peek());
+}
+
+void Reader::Finish() {
+    p_ = SkipWhitespace(p_, end_);
+    if (p_ != end_) throw ParsingError("unexpected trailing data");
+}
+
+Type Reader::Peek() {
+    p_ = SkipWhitespace(p_, end_);
+    if (p_ == end_) throw ParsingError("unexpected eof");
+    switch (*p_) {
+        case '{': return Type::OBJ;
+        case '[': return Type::ARRAY;
+        case '"': return Type::STR;
+        case 't':
+        case 'f': return Type::BOOL;
+        case 'n': return Type::NIL;
+    }
+    if (*p_ == '-' || IsDigit(*p_)) return Type::NUM;
+    throw ParsingError(std::format("bad token: {}", *p_));
+}
+
+bool Reader::Null() {
+    if (Peek() != Type::NIL) return false;
+    p_ = ScanLiteral(p_, end_, "null");
+    return true;
+}
+
+bool Reader::Consume(char c) {
+    p_ = SkipWhitespace(p_, end_);
+    if (p_ == end_ || *p_ != c) return false;
+    ++p_;
+    return true;
+}
+
+void Reader::Expect(char c) {
+    if (!Consume(c)) {
+        if (p_ == end_) throw ParsingError("unexpected eof");
+        throw ParsingError(std::format("want {}, got {}", c, *p_));
+    }
+}
+
+void Reader::Expect(char c, Type type) {
+    if (Peek() != type) throw TypeError(type, Peek());
+    ++p_;
+}
+
+std::string_view Reader::Key() {
+    p_ = SkipWhitespace(p_, end_);
+    if (p_ == end_) throw ParsingError("unexpected eof");
+    if (*p_ != '"') throw ParsingError(std::format("want key, got {}", *p_));
+    std::string_view key = String(key_);
+    Expect(':');
+    return key;
+}
+
+std::string_view Reader::String(std::string& scratch) {
+    const char* start = ++p_;
+    bool escaped = false;
+    const char* stop = FindStringEnd(p_, end_, &escaped);
+    p_ = stop + 1;
+    if (!escaped) return std::string_view(start, stop);
+    scratch.resize(stop - start);
+    char* out = scratch.data();
+    return std::string_view(out, Unescape(std::string_view(start, stop), out));
+}
+
+void Reader::Skip(int depth) {
+    switch (Peek()) {
+        case Type::OBJ:
+            if (depth == kMaxDepth) throw ParsingError("nested too deeply");
+            ++p_;
+            if (Consume('}')) return;
+            do {
+                Key();
+                Skip(depth + 1);
+            } while (Consume(','));
+            Expect('}');
+            return;
+        case Type::ARRAY:
+            if (depth == kMaxDepth) throw ParsingError("nested too deeply");
+            ++p_;
+            if (Consume(']')) return;
+            do {
+                Skip(depth + 1);
+            } while (Consume(','));
+            Expect(']');
+            return;
+        case Type::STR: {
+            bool escaped;
+            const char* stop = FindStringEnd(p_ + 1, end_, &escaped);
+            // escapes are still checked, as they would be if it were read
+            if (escaped) String(key_);
+            p_ = stop + 1;
+            return;
+        }
+        case Type::BOOL:
+            p_ = ScanLiteral(p_, end_, *p_ == 't' ? "true" : "false");
+            return;
+        case Type::NIL: p_ = ScanLiteral(p_, end_, "null"); return;
+        case Type::NUM: {
+            double ignored;
+            p_ = ScanNumber(p_, end_, &ignored);
+            return;
+        }
+    }
+}
+
+void Writer::Write(bool b) { out_ += b ? "true" : "false"; }
+
+void Writer::Write(double n) {
+    // json has no infinities or nans
+    if (!std::isfinite(n)) return Write(nullptr);
+    char buf[32];
+    out_.append(buf, std::to_chars(buf, buf + sizeof(buf), n).ptr);
+}
+
+void Writer::Write(int n) { Write(int64_t(n)); }
+
+void Writer::Write(int64_t n) {
+    char buf[24];
+    out_.append(buf, std::to_chars(buf, buf + sizeof(buf), n).ptr);
+}
+
+void Writer::Write(std::string_view s) {
+    out_ += '"';
+    const char* p = s.data();
+    const char* end = s.data() + s.size();
+    while (p != end) {
+        // copy everything up to the next byte that needs escaping at once
+        const char* run = p;
+        while (p != end && !NeedsEscape(*p)) ++p;
+        out_.append(run, p);
+        if (p == end) break;
+        switch (char c = *p++) {
+            case '"': out_ += "\\\""; break;
+            case '\\': out_ += "\\\\"; break;
+            case '\n': out_ += "\\n"; break;
+            case '\r': out_ += "\\r"; break;
+            case '\t': out_ += "\\t"; break;
+            default: out_ += std::format("\\u{:04x}", int(c));
+        }
+    }
+    out_ += '"';
+}
+
+void Writer::Write(std::nullptr_t) { out_ += "null"; }
+
+}  // namespace json
+}  // namespace gabby
@@ -0,0 +1,230 @@
+#ifndef GABBY_JSON_BIND_H_
+#define GABBY_JSON_BIND_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "json/json.h"
+
+// reads json straight into structs, and writes structs straight out as
+// json, without building a tree of values in between. a struct is bound
+// by listing its fields once:
+//
+//     struct Message {
+//         std::string role;
+//         std::string content;
+//
+//         static constexpr std::tuple kJsonFields = {
+//             json::Field{"role", &Message::role},
+//             json::Field{"content", &Message::content},
+//         };
+//     };
+//
+// members can be bools, numbers, strings, other bound structs, and
+// optionals and vectors of those. empty optionals are null.
+
+namespace gabby {
+namespace json {
+
+// what to write for a field that's an empty optional
+enum class IfEmpty { WRITE_NULL, OMIT };
+
+// a key of a json object, and the member of |T| that it's read into
+// and written from
+template <typename T, typename M>
+struct Field {
+    std::string_view key;
+    M T::*member;
+    IfEmpty if_empty = IfEmpty::WRITE_NULL;
+};
+
+template <typename T>
+concept Bound = requires { T::kJsonFields; };
+
+// reads values from a buffer of json, one at a time
+class Reader {
+public:
+    // |json| must outlive the reader
+    explicit Reader(std::string_view json)
+        : p_(json.data()), end_(json.data() + json.size()) {}
+
+    // each of these throws ParsingError if the json isn't valid, and
+    // TypeError if the next value isn't the right type. integers throw
+    // ParsingError unless they're whole and fit in their type.
+    void Read(bool& b);
+    void Read(double& n);
+    void Read(int& n);
+    void Read(int64_t& n);
+    void Read(std::string& s);
+    // reads null, and nothing else
+    void Read(std::nullptr_t&);
+
+    template <typename T>
+    void Read(std::optional<T>& value) {
+        if (Null()) {
+            value.reset();
+        } else {
+            Read(value.emplace());
+        }
+    }
+
+    template <typename T>
+    void Read(std::vector<T>& values) {
+        values.clear();
+        Expect('[', Type::ARRAY);
+        if (Consume(']')) return;
+        do {
+            Read(values.emplace_back());
+        } while (Consume(','));
+        Expect(']');
+    }
+
+    // fields that aren't in the json are left alone, and keys that
+    // aren't fields are skipped
+    template <Bound T>
+    void Read(T& value) {
+        Expect('{', Type::OBJ);
+        if (Consume('}')) return;
+        do {
+            std::string_view key = Key();
+            bool found = std::apply(
+                [&](const auto&... fields) {
+                    return (ReadField(key, value, fields) || ...);
+                },
+                T::kJsonFields);
+            if (!found) Skip(0);
+        } while (Consume(','));
+        Expect('}');
+    }
+
+    // throws ParsingError if there's anything but whitespace left
+    void Finish();
+
+private:
+    template <typename T, typename M>
+    bool ReadField(std::string_view key, T& value,
+                   const Field<T, M>& field) {
+        if (key != field.key) return false;
+        Read(value.*field.member);
+        return true;
+    }
+
+    // the type of the next value, going by its first byte
+    Type Peek();
+    // skips null if it's next
+    bool Null();
+    // skips whitespace, and then |c| if it's next
+    bool Consume(char c);
+    void Expect(char c);
+    // as above, but throws TypeError if it's a value of another type
+    void Expect(char c, Type type);
+    // reads a key, and the colon after it
+    std::string_view Key();
+    // the contents of the string that's next, decoded into |scratch| if
+    // it has escapes
+    std::string_view String(std::string& scratch);
+    // skips a value of any type
+    void Skip(int depth);
+
+    const char* p_;
+    const char* end_;
+    // where keys with escapes are decoded
+    std::string key_;
+};
+
+// appends values to a buffer as json
+class Writer {
+public:
+    // |out| must outlive the writer
+    explicit Writer(std::string& out) : out_(out) {}
+
+    void Write(bool b);
+    void Write(double n);
+    void Write(int n);
+    void Write(int64_t n);
+    void Write(std::string_view s);
+    void Write(const std::string& s) { Write(std::string_view(s)); }
+    void Write(const char* s) { Write(std::string_view(s)); }
+    void Write(std::nullptr_t);
+
+    template <typename T>
+    void Write(const std::optional<T>& value) {
+        if (value.has_value()) {
+            Write(*value);
+        } else {
+            Write(nullptr);
+        }
+    }
+
+    template <typename T>
+    void Write(const std::vector<T>& values) {
+        out_ += '[';
+        for (size_t i = 0; i < values.size(); i++) {
+            if (i > 0) out_ += ", ";
+            Write(values[i]);
+        }
+        out_ += ']';
+    }
+
+    template <Bound T>
+    void Write(const T& value) {
+        out_ += '{';
+        bool first = true;
+        std::apply(
+            [&](const auto&... fields) {
+                (WriteField(value, fields, first), ...);
+            },
+            T::kJsonFields);
+        out_ += '}';
+    }
+
+private:
+    template <typename M>
+    static bool Empty(const M&) {
+        return false;
+    }
+
+    template <typename M>
+    static bool Empty(const std::optional<M>& member) {
+        return !member.has_value();
+    }
+
+    template <typename T, typename M>
+    void WriteField(const T& value, const Field<T, M>& field, bool& first) {
+        const M& member = value.*field.member;
+        if (field.if_empty == IfEmpty::OMIT && Empty(member)) return;
+        if (!first) out_ += ", ";
+        first = false;
+        Write(field.key);
+        out_ += ": ";
+        Write(member);
+    }
+
+    std::string& out_;
+};
+
+// reads all of |json| into a |T|
+template <typename T>
+T Read(std::string_view json) {
+    T value{};
+    Reader reader(json);
+    reader.Read(value);
+    reader.Finish();
+    return value;
+}
+
+// appends |value| to |out| as json
+template <typename T>
+void Write(std::string& out, const T& value) {
+    Writer(out).Write(value);
+}
+
+}  // namespace json
+}  // namespace gabby
+
+#endif  // GABBY_JSON_BIND_H_
@@ -0,0 +1,160 @@
+#include "json/bind.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "json/json.h"
+#include "test/test.h"
+
+namespace gabby {
+namespace json {
+
+namespace {
+
+struct Inner {
+    std::string name;
+    std::optional<double> weight;
+
+    static constexpr std::tuple kJsonFields = {
+        Field{"name", &Inner::name},
+        Field{"weight", &Inner::weight},
+    };
+};
+
+struct Outer {
+    int id = 0;
+    bool ok = false;
+    std::vector<Inner> items;
+    std::optional<Inner> extra;
+    std::optional<std::string> note;
+    std::nullptr_t nothing = nullptr;
+
+    static constexpr std::tuple kJsonFields = {
+        Field{"id", &Outer::id},
+        Field{"ok", &Outer::ok},
+        Field{"items", &Outer::items},
+        Field{"extra", &Outer::extra},
+        Field{"note", &Outer::note, IfEmpty::OMIT},
+        Field{"nothing", &Outer::nothing},
+    };
+};
+
+// whether reading |json| into a |T| throws |E|
+template <typename E, typename T = Outer>
+bool Throws(std::string_view json) {
+    try {
+        Read<T>(json);
+    } catch (const E& e) {
+        return true;
+    }
+    return false;
+}
+
+}  // namespace
+
+TEST(Bind, Read) {
+    // Arrange
+    std::string json = R"({
+        "id": 7, "unknown": [{"a": [1, "é", null]}, true],
+        "items": [{"name": "a\"b", "weight": 1.5}, {"name": "c"}],
+        "ok": true, "extra": null, "nothing": null
+    })";
+
+    // Act
+    Outer outer = Read<Outer>(json);
+
+    // Assert
+    EXPECT_EQ(7, outer.id);
+    EXPECT_TRUE(outer.ok);
+    EXPECT_EQ(2, outer.items.size());
+    EXPECT_EQ("a\"b", outer.items[0].name);
+    EXPECT_FLOAT_EQ(1.5, *outer.items[0].weight, 0.001);
+    EXPECT_EQ("c", outer.items[1].name);
+    EXPECT_FALSE(outer.items[1].weight.has_value());
+    EXPECT_FALSE(outer.extra.has_value());
+}
+
+TEST(Bind, Write) {
+    // Arrange
+    Outer outer{
+        .id = 3,
+        .items = {Inner{.name = "x\ny", .weight = 2}},
+        .extra = Inner{.name = ""},
+    };
+
+    // Act
+    std::string json;
+    Write(json, outer);
+
+    // Assert
+    // The note is left out, since it's empty.
+    EXPECT_EQ(R"({"id": 3, "ok": false, "items": [{"name": "x\ny", )"
+              R"("weight": 2}], "extra": {"name": "", "weight": null}, )"
+              R"("nothing": null})",
+              json);
+}
+
+TEST(Bind, RoundTrip) {
+    // Arrange
+    Outer outer{.id = -1, .ok = true, .note = "\x01\\"};
+
+    // Act
+    std::string json;
+    Write(json, outer);
+    Outer read = Read<Outer>(json);
+
+    // Assert
+    EXPECT_EQ(-1, read.id);
+    EXPECT_TRUE(read.ok);
+    EXPECT_EQ("\x01\\", *read.note);
+}
+
+TEST(Bind, ReadIntegers) {
+    // 2^53 + 1, which a double can't hold
+    EXPECT_EQ(int64_t(9007199254740993), Read<int64_t>("9007199254740993"));
+    EXPECT_EQ(int64_t(-9007199254740993), Read<int64_t>("-9007199254740993"));
+    EXPECT_EQ(std::numeric_limits<int64_t>::max(),
+              Read<int64_t>("9223372036854775807"));
+    EXPECT_EQ(std::numeric_limits<int64_t>::min(),
+              Read<int64_t>("-9223372036854775808"));
+    EXPECT_EQ(std::numeric_limits<int>::min(), Read<int>("-2147483648"));
+    // whole numbers written with a fraction or an exponent
+    EXPECT_EQ(-2, Read<int>("-2.0"));
+    EXPECT_EQ(1000, Read<int>("1e3"));
+    EXPECT_EQ(int64_t(1) << 53, Read<int64_t>("9.007199254740992e15"));
+}
+
+TEST(Bind, Rejects) {
+    EXPECT_TRUE(Throws<TypeError>(R"({"id": "7"})"));
+    EXPECT_TRUE(Throws<TypeError>(R"({"items": {}})"));
+    EXPECT_TRUE(Throws<TypeError>(R"({"nothing": 0})"));
+    EXPECT_TRUE(Throws<TypeError>("[]"));
+    EXPECT_TRUE(Throws<ParsingError>(R"({"id": 1.5})"));
+    EXPECT_TRUE(Throws<ParsingError>(R"({"id": 1e-3})"));
+    EXPECT_TRUE(Throws<ParsingError>(R"({"id": 2147483648})"));
+    EXPECT_TRUE(Throws<ParsingError>(R"({"id": -1e10})"));
+    EXPECT_TRUE((Throws<ParsingError, int64_t>("9223372036854775808")));
+    EXPECT_TRUE((Throws<ParsingError, int64_t>("-9223372036854775809")));
+    EXPECT_TRUE((Throws<ParsingError, int64_t>("1e18")));
+    EXPECT_TRUE((Throws<ParsingError, int64_t>("1e400")));
+    EXPECT_TRUE((Throws<ParsingError, int64_t>("9007199254740993.5")));
+    EXPECT_TRUE(Throws<ParsingError>(R"({"id": 1,})"));
+    EXPECT_TRUE(Throws<ParsingError>(R"({"id": 1} x)"));
+    EXPECT_TRUE(Throws<ParsingError>(R"({"unknown": [1 2]})"));
+    EXPECT_TRUE(Throws<ParsingError>(R"({"unknown": "\x"})"));
+    EXPECT_TRUE(Throws<ParsingError>(R"({"unknown": )" +
+                                     std::string(1000, '[') +
+                                     std::string(1000, ']') + "}"));
+    EXPECT_FALSE(Throws<JSONError>(R"({"unknown": )" +
+                                   std::string(100, '[') +
+                                   std::string(100, ']') + "}"));
+}
+
+}  // namespace json
+}  // namespace gabby
@@ -0,0 +1,420 @@
+#include "json/document.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <sstream>
+#include <type_traits>
+#include <vector>
+
+#include "json/scan.h"
+#include "json/structural.h"
+#include "utils/logging.h"
+#include "utils/pointers.h"
+
+namespace gabby {
+namespace json {
+
+namespace {
+
+// deep enough for any document we expect, and shallow enough that a
+// hostile request body can't run the parser out of stack
+constexpr int kMaxDepth = 512;
+
+// documents at least this big are parsed from a structural index.
+// walking the index is several times quicker than scanning the bytes,
+// but building it costs an allocation and a pass of its own, which
+// small documents don't make up for.
+constexpr size_t kIndexThreshold = 64 * 1024;
+
+// whether there's a backslash in [|p|, |end|). most strings are short
+// enough that looking at each byte is quicker than calling memchr.
+bool HasBackslash(const char* p, const char* end) {
+    if (end - p > 32) return std::memchr(p, '\\', end - p) != nullptr;
+    for (; p != end; ++p) {
+        if (*p == '\\') return true;
+    }
+    return false;
+}
+
+// walks the tokens of a document by looking at every byte
+class DirectWalker {
+public:
+    explicit DirectWalker(std::string_view json)
+        : p_(json.data()), end_(json.data() + json.size()) {}
+
+    const char* end() const { return end_; }
+
+    // returns the start of the next token, or null at the end
+    const char* Peek() {
+        p_ = SkipWhitespace(p_, end_);
+        return p_ == end_ ? nullptr : p_;
+    }
+
+    // moves past the one-byte token just peeked at
+    void Pop() { ++p_; }
+
+    // moves past the number or literal just peeked at, which ended at
+    // |stop|
+    void Pop(const char* stop) { p_ = stop; }
+
+    // moves past the string just peeked at, and returns what's between
+    // its quotes
+    std::string_view String(bool* escaped) {
+        const char* start = p_ + 1;
+        const char* stop = FindStringEnd(start, end_, escaped);
+        p_ = stop + 1;
+        return std::string_view(start, stop);
+    }
+
+private:
+    const char* p_;
+    const char* end_;
+};
+
+// walks the tokens of a document from its structural index, jumping
+// over whatever's between them
+class IndexedWalker {
+public:
+    explicit IndexedWalker(std::string_view json)
+        : base_(json.data()),
+          end_(json.data() + json.size()),
+          index_(BuildStructuralIndex(json)) {}
+
+    const char* end() const { return end_; }
+
+    const char* Peek() const {
+        return i_ == index_.size() ? nullptr : base_ + index_[i_];
+    }
+
+    void Pop() { ++i_; }
+
+    void Pop(const char* stop) {
+        ++i_;
+        // the index only says where tokens start, so a number or literal
+        // that stops early, like the 1 in 1-2, must be followed by
+        // nothing but whitespace up to the next one
+        const char* next = i_ == index_.size() ? end_ : base_ + index_[i_];
+        if (stop != next && SkipWhitespace(stop, next) != next) {
+            throw ParsingError(std::format("bad token: {}", *stop));
+        }
+    }
+
+    std::string_view String(bool* escaped) {
+        // the index always has both quotes of a string
+        const char* start = base_ + index_[i_] + 1;
+        const char* stop = base_ + index_[i_ + 1];
+        i_ += 2;
+        *escaped = HasBackslash(start, stop);
+        return std::string_view(start, stop);
+    }
+
+private:
+    const char* base_;
+    const char* end_;
+    std::vector<uint32_t> index_;
+    size_t i_ = 0;
+};
+
+}  // namespace
+
+// builds the nodes of a document in its arena, from the tokens that
+// |Walker| finds. the elements of the arrays and objects being parsed
+// are kept on a stack of their own until each one ends, and are then
+// copied to the arena together.
+template <typename Walker>
+class DocumentParser {
+public:
+    DocumentParser(std::string_view json, std::pmr::memory_resource& arena)
+        : walker_(json), arena_(arena) {}
+
+    const Node* Parse() {
+        Node* root = Allocate<Node>(1);
+        *root = Value(0);
+        if (walker_.Peek() != nullptr) {
+            throw ParsingError("unexpected trailing data");
+        }
+        return root;
+    }
+
+private:
+    Node Value(int depth);
+    Node Array(int depth);
+    Node Object(int depth);
+    std::string_view String();
+
+    void Literal(const char* p, std::string_view word) {
+        walker_.Pop(ScanLiteral(p, walker_.end(), word));
+    }
+
+    // returns the start of the next token, or throws at the end
+    const char* Next() {
+        const char* p = walker_.Peek();
+        if (p == nullptr) throw ParsingError("unexpected eof");
+        return p;
+    }
+
+    // moves past |c| if it's the next token
+    bool Consume(char c) {
+        const char* p = walker_.Peek();
+        if (p == nullptr || *p != c) return false;
+        walker_.Pop();
+        return true;
+    }
+
+    void Expect(char c) {
+        const char* p = Next();
+        if (*p != c) throw ParsingError(std::format("want {}, got {}", c, *p));
+        walker_.Pop();
+    }
+
+    // returns space for |n| uninitialized instances of T. the arena
+    // never runs destructors, so T must not need one.
+    template <typename T>
+    T* Allocate(size_t n) {
+        static_assert(std::is_trivially_destructible_v<T>);
+        return static_cast<T*>(arena_.allocate(n * sizeof(T), alignof(T)));
+    }
+
+    // copies |items| from the end of |stack| to the arena
+    template <typename T>
+    const T* Pop(std::vector<T>& stack, size_t start) {
+        size_t n = stack.size() - start;
+        if (n == 0) return nullptr;
+        T* out = Allocate<T>(n);
+        std::uninitialized_copy_n(stack.data() + start, n, out);
+        stack.resize(start);
+        return out;
+    }
+
+    Walker walker_;
+    std::pmr::memory_resource& arena_;
+    std::vector<Node> elements_;
+    std::vector<Member> members_;
+};
+
+template <typename Walker>
+Node DocumentParser<Walker>::Value(int depth) {
+    const char* p = Next();
+    Node node;
+    switch (*p) {
+        case '[': return Array(depth);
+        case '{': return Object(depth);
+        case '"': {
+            std::string_view s = String();
+            node.type_ = Type::STR;
+            node.string_ = s.data();
+            node.size_ = s.size();
+            return node;
+        }
+        case 't':
+            Literal(p, "true");
+            node.type_ = Type::BOOL;
+            node.boolean_ = true;
+            return node;
+        case 'f':
+            Literal(p, "false");
+            node.type_ = Type::BOOL;
+            node.boolean_ = false;
+            return node;
+        case 'n': Literal(p, "null"); return node;
+    }
+    if (*p == '-' || IsDigit(*p)) {
+        node.type_ = Type::NUM;
+        walker_.Pop(ScanNumber(p, walker_.end(), &node.number_));
+        return node;
+    }
+    throw ParsingError(std::format("bad token: {}", *p));
+}
+
+template <typename Walker>
+Node DocumentParser<Walker>::Array(int depth) {
+    if (depth == kMaxDepth) throw ParsingError("nested too deeply");
+    Expect('[');
+    size_t start = elements_.size();
+    if (!Consume(']')) {
+        do {
+            elements_.push_back(Value(depth + 1));
+        } while (Consume(','));
+        Expect(']');
+    }
+    Node node;
+    node.type_ = Type::ARRAY;
+    node.size_ = elements_.size() - start;
+    node.elements_ = Pop(elements_, start);
+    return node;
+}
+
+template <typename Walker>
+Node DocumentParser<Walker>::Object(int depth) {
+    if (depth == kMaxDepth) throw ParsingError("nested too deeply");
+    Expect('{');
+    size_t start = members_.size();
+    if (!Consume('}')) {
+        do {
+            const char* p = Next();
+            if (*p != '"') {
+                throw ParsingError(std::format("want key, got {}", *p));
+            }
+            std::string_view key = String();
+            Expect(':');
+            Node value = Value(depth + 1);
+            members_.push_back(Member{.key = key, .value = value});
+        } while (Consume(','));
+        Expect('}');
+    }
+    Node node;
+    node.type_ = Type::OBJ;
+    node.size_ = members_.size() - start;
+    node.members_ = Pop(members_, start);
+    return node;
+}
+
+template <typename Walker>
+std::string_view DocumentParser<Walker>::String() {
+    bool escaped = false;
+    std::string_view raw = walker_.String(&escaped);
+    if (!escaped) return raw;
+    // decoding only ever shrinks a string
+    char* out = Allocate<char>(raw.size());
+    return std::string_view(out, Unescape(raw, out));
+}
+
+double Node::as_number() const {
+    if (type_ != Type::NUM) throw TypeError(Type::NUM, type_);
+    return number_;
+}
+
+bool Node::as_boolean() const {
+    if (type_ != Type::BOOL) throw TypeError(Type::BOOL, type_);
+    return boolean_;
+}
+
+std::string_view Node::as_string() const {
+    if (type_ != Type::STR) throw TypeError(Type::STR, type_);
+    return std::string_view(string_, size_);
+}
+
+std::span<const Node> Node::as_array() const {
+    if (type_ != Type::ARRAY) throw TypeError(Type::ARRAY, type_);
+    return std::span(elements_, size_);
+}
+
+const Node& Object::at(std::string_view key) const {
+    const Node* value = find(key);
+    if (value == nullptr) throw KeyNotFoundError(std::string(key));
+    return *value;
+}
+
+const Node* Object::find(std::string_view key) const {
+    for (const Member& member : members_) {
+        if (member.key == key) return &member.value;
+    }
+    return nullptr;
+}
+
+std::ostream& operator<<(std::ostream& os, const Node& node) {
+    switch (node.type()) {
+        case Type::NUM: return os << node.as_number();
+        case Type::BOOL: return os << (node.as_boolean() ? "true" : "false");
+        case Type::STR: return PrintQuoted(os, node.as_string());
+        case Type::NIL: return os << "null";
+        case Type::ARRAY: {
+            os << "[";
+            bool first = true;
+            for (const Node& element : node.as_array()) {
+                if (!first) os << ", ";
+                os << element;
+                first = false;
+            }
+            return os << "]";
+        }
+        case Type::OBJ: {
+            os << "{";
+            bool first = true;
+            for (const auto& [key, value] : node.as_object()) {
+                if (!first) os << ", ";
+                PrintQuoted(os, key) << ": " << value;
+                first = false;
+            }
+            return os << "}";
+        }
+    }
+    return os;
+}
+
+std::string to_string(const Node& node) {
+    std::stringstream ss;
+    ss << node;
+    return ss.str();
+}
+
+bool operator==(const Node& lhs, const Node& rhs) {
+    if (lhs.type() != rhs.type()) return false;
+    switch (lhs.type()) {
+        case Type::NUM: return lhs.as_number() == rhs.as_number();
+        case Type::BOOL: return lhs.as_boolean() == rhs.as_boolean();
+        case Type::STR: return lhs.as_string() == rhs.as_string();
+        case Type::NIL: return true;
+        case Type::ARRAY: {
+            auto l = lhs.as_array(), r = rhs.as_array();
+            return std::equal(l.begin(), l.end(), r.begin(), r.end());
+        }
+        case Type::OBJ: {
+            Object l = lhs.as_object(), r = rhs.as_object();
+            if (l.size() != r.size()) return false;
+            for (const auto& [key, value] : l) {
+                const Node* other = r.find(key);
+                if (other == nullptr || !(*other == value)) return false;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+Document Document::Parse(std::unique_ptr<State> state, std::string_view json) {
+    if (json.size() > std::numeric_limits<uint32_t>::max()) {
+        throw ParsingError("document too large");
+    }
+    if (json.size() >= kIndexThreshold) {
+        state->root =
+            DocumentParser<IndexedWalker>(json, state->arena).Parse();
+    } else {
+        state->root = DocumentParser<DirectWalker>(json, state->arena).Parse();
+    }
+    return Document(std::move(state));
+}
+
+Document Document::Parse(std::string json,
+                         std::pmr::memory_resource* upstream) {
+    auto state = std::make_unique<State>(upstream);
+    state->source = std::move(json);
+    std::string_view source = state->source;
+    return Parse(std::move(state), source);
+}
+
+Document Document::ParseBorrowed(std::string_view json,
+                                 std::pmr::memory_resource* upstream) {
+    return Parse(std::make_unique<State>(upstream), json);
+}
+
+Document Document::ParseFile(const std::filesystem::path& path) {
+    auto state = std::make_unique<State>(std::pmr::get_default_resource());
+    OwnedStream f = Fopen(path.c_str(), "r");
+    // read straight into the source, rather than through a string we'd
+    // then have to copy
+    state->source.resize(std::filesystem::file_size(path));
+    size_t n = fread(state->source.data(), 1, state->source.size(), f.get());
+    if (ferror(f.get())) throw SystemError(errno);
+    state->source.resize(n);
+    std::string_view source = state->source;
+    return Parse(std::move(state), source);
+}
+
+}  // namespace json
+}  // namespace gabby
@@ -0,0 +1,141 @@
+#ifndef GABBY_JSON_DOCUMENT_H_
+#define GABBY_JSON_DOCUMENT_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <memory_resource>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "json/json.h"
+
+namespace gabby {
+namespace json {
+
+class Node;
+struct Member;
+class Object;
+
+// a value in a Document. nodes are small, and live in the document's
+// arena: arrays and objects point to their elements, which are laid
+// out next to each other, and strings point into the document's source
+// unless they had escapes to decode. nodes, and the views they return,
+// are only valid for as long as the document is.
+class Node {
+public:
+    Type type() const { return type_; }
+    bool is_null() const { return type_ == Type::NIL; }
+
+    // throw TypeError if the node isn't of that type
+    double as_number() const;
+    bool as_boolean() const;
+    std::string_view as_string() const;
+    std::span<const Node> as_array() const;
+    Object as_object() const;
+
+private:
+    template <typename>
+    friend class DocumentParser;
+
+    Type type_ = Type::NIL;
+    // the length of a string, or the number of elements
+    uint32_t size_ = 0;
+    union {
+        double number_;
+        bool boolean_;
+        const char* string_;
+        const Node* elements_;
+        const Member* members_;
+    };
+};
+
+struct Member {
+    std::string_view key;
+    Node value;
+};
+
+// the members of an object, in the order they were parsed. lookups are
+// a linear scan, which beats hashing for the handful of keys most
+// objects have. iterate over large ones instead.
+class Object {
+public:
+    explicit Object(std::span<const Member> members) : members_(members) {}
+
+    // returns the value of the first member named |key|, or throws
+    // KeyNotFoundError
+    const Node& at(std::string_view key) const;
+    // returns the value of the first member named |key|, or null
+    const Node* find(std::string_view key) const;
+    bool contains(std::string_view key) const { return find(key) != nullptr; }
+
+    size_t size() const { return members_.size(); }
+    bool empty() const { return members_.empty(); }
+    const Member* begin() const { return members_.data(); }
+    const Member* end() const { return members_.data() + members_.size(); }
+
+private:
+    std::span<const Member> members_;
+};
+
+std::ostream& operator<<(std::ostream& os, const Node& node);
+std::string to_string(const Node& node);
+// objects are equal if they have the same members in any order
+bool operator==(const Node& lhs, const Node& rhs);
+
+// a parsed json document, which owns its nodes and, unless it was
+// parsed with ParseBorrowed, its source.
+//
+// unlike Value, which allocates each node separately and copies each
+// string, parsing a document makes a handful of large allocations, and
+// only copies strings with escapes in them.
+//
+// the nodes are allocated from a monotonic arena, which takes its
+// blocks from |upstream|. a connection's arena can be passed in, so
+// that a request body is parsed without touching the heap, as long as
+// the document doesn't outlive the request.
+class Document {
+public:
+    // throws ParsingError if |json| isn't valid
+    static Document Parse(
+        std::string json,
+        std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+    static Document ParseFile(const std::filesystem::path& path);
+    // parses |json| without copying it, so it must outlive the document
+    static Document ParseBorrowed(
+        std::string_view json,
+        std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+
+    const Node& root() const { return *state_->root; }
+
+private:
+    // kept on the heap, so that moving the document doesn't move a
+    // short source out from under the nodes that point into it
+    struct State {
+        explicit State(std::pmr::memory_resource* upstream)
+            : arena(upstream) {}
+
+        std::string source;
+        std::pmr::monotonic_buffer_resource arena;
+        const Node* root = nullptr;
+    };
+
+    static Document Parse(std::unique_ptr<State> state, std::string_view json);
+
+    explicit Document(std::unique_ptr<State> state)
+        : state_(std::move(state)) {}
+
+    std::unique_ptr<State> state_;
+};
+
+inline Object Node::as_object() const {
+    if (type_ != Type::OBJ) throw TypeError(Type::OBJ, type_);
+    return Object(std::span(members_, size_));
+}
+
+}  // namespace json
+}  // namespace gabby
+
+#endif  // GABBY_JSON_DOCUMENT_H_
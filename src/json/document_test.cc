@@ -0,0 +1,229 @@
+#include "json/document.h"
+
+#include <array>
+#include <cstddef>
+#include <format>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "json/json.h"
+#include "test/test.h"
+
+namespace gabby {
+namespace json {
+
+namespace {
+
+// whether |json| fails to parse, followed by |pad| spaces
+bool Rejects(std::string_view json, size_t pad = 0) {
+    try {
+        Document::Parse(std::string(json) + std::string(pad, ' '));
+    } catch (const ParsingError& e) {
+        return true;
+    }
+    return false;
+}
+
+}  // namespace
+
+TEST(Document, ParseScalars) {
+    EXPECT_TRUE(Document::Parse("null").root().is_null());
+    EXPECT_EQ(true, Document::Parse("true").root().as_boolean());
+    EXPECT_EQ(false, Document::Parse(" false ").root().as_boolean());
+    EXPECT_EQ(17, Document::Parse("17").root().as_number());
+    EXPECT_FLOAT_EQ(-32.4, Document::Parse("-32.4").root().as_number(), 0.001);
+    EXPECT_FLOAT_EQ(1e-17, Document::Parse("1e-17").root().as_number(),
+                    0.000000000001);
+    EXPECT_EQ("foo bar", Document::Parse("\"foo bar\"").root().as_string());
+    EXPECT_EQ("", Document::Parse("\"\"").root().as_string());
+}
+
+TEST(Document, StringsPointIntoTheSource) {
+    // Arrange
+    std::string json = R"({"plain": "abc", "escaped": "a\"b"})";
+
+    // Act
+    auto doc = Document::ParseBorrowed(json);
+    auto obj = doc.root().as_object();
+
+    // Assert
+    // Only strings with escapes need to be copied.
+    std::string_view plain = obj.at("plain").as_string();
+    EXPECT_TRUE(plain.data() >= json.data() &&
+                plain.data() < json.data() + json.size());
+    std::string_view escaped = obj.at("escaped").as_string();
+    EXPECT_EQ("a\"b", escaped);
+    EXPECT_FALSE(escaped.data() >= json.data() &&
+                 escaped.data() < json.data() + json.size());
+}
+
+TEST(Document, ParseEscapes) {
+    auto parse = [](std::string_view json) {
+        return std::string(
+            Document::Parse(std::string(json)).root().as_string());
+    };
+    EXPECT_EQ(R"(""")", parse(R"("\"\"\"")"));
+    EXPECT_EQ(R"(\\")", parse(R"("\\\\\"")"));
+    EXPECT_EQ("a/b\nc\td\r\b\f", parse(R"("a\/b\nc\td\r\b\f")"));
+    EXPECT_EQ("\xc3\xa9 \xe2\x82\xac", parse(R"("\u00e9 \u20AC")"));
+    // A surrogate pair, for a character outside the basic plane.
+    EXPECT_EQ("\xf0\x9f\x98\x80", parse(R"("\ud83d\ude00")"));
+}
+
+TEST(Document, ParseArray) {
+    // Arrange
+    auto doc = Document::Parse(R"([true, "abc", [], [1, [2]]])");
+
+    // Act
+    auto array = doc.root().as_array();
+
+    // Assert
+    EXPECT_EQ(4, array.size());
+    EXPECT_EQ(true, array[0].as_boolean());
+    EXPECT_EQ("abc", array[1].as_string());
+    EXPECT_TRUE(array[2].as_array().empty());
+    EXPECT_EQ(2, array[3].as_array()[1].as_array()[0].as_number());
+}
+
+TEST(Document, ParseObject) {
+    // Arrange
+    auto doc = Document::Parse(R"({"a": "b", "c": {"d": null}, "e": {}})");
+
+    // Act
+    auto obj = doc.root().as_object();
+
+    // Assert
+    EXPECT_EQ(3, obj.size());
+    EXPECT_EQ("b", obj.at("a").as_string());
+    EXPECT_TRUE(obj.at("c").as_object().at("d").is_null());
+    EXPECT_TRUE(obj.at("e").as_object().empty());
+    EXPECT_FALSE(obj.contains("f"));
+    std::vector<std::string_view> keys;
+    for (const auto& [key, value] : obj) keys.push_back(key);
+    EXPECT_EQ((std::vector<std::string_view>{"a", "c", "e"}), keys);
+}
+
+TEST(Document, WrongTypesAndMissingKeys) {
+    // Arrange
+    auto doc = Document::Parse(R"({"a": 1})");
+    auto obj = doc.root().as_object();
+
+    // Act
+    bool type_error = false, key_error = false;
+    try {
+        obj.at("a").as_string();
+    } catch (const TypeError& e) {
+        type_error = true;
+    }
+    try {
+        obj.at("b");
+    } catch (const KeyNotFoundError& e) {
+        key_error = true;
+    }
+
+    // Assert
+    EXPECT_TRUE(type_error);
+    EXPECT_TRUE(key_error);
+}
+
+TEST(Document, PrintsAndCompares) {
+    // Arrange
+    auto doc = Document::Parse(R"({"a": [1, "x\ny"], "b": null})");
+    auto reordered = Document::Parse(R"({"b": null, "a": [1, "x\ny"]})");
+    auto different = Document::Parse(R"({"b": null, "a": [1, "x"]})");
+
+    // Act
+    auto printed = to_string(doc.root());
+
+    // Assert
+    EXPECT_EQ(R"({"a": [1, "x\ny"], "b": null})", printed);
+    EXPECT_TRUE(doc.root() == Document::Parse(printed).root());
+    EXPECT_TRUE(doc.root() == reordered.root());
+    EXPECT_FALSE(doc.root() == different.root());
+}
+
+TEST(Document, SurvivesMoves) {
+    // Arrange
+    // Short enough to be kept inside a std::string, rather than on the
+    // heap.
+    auto doc = Document::Parse("\"abc\"");
+
+    // Act
+    std::vector<Document> docs;
+    docs.push_back(std::move(doc));
+    for (int i = 0; i < 10; i++) docs.push_back(Document::Parse("1"));
+
+    // Assert
+    EXPECT_EQ("abc", docs[0].root().as_string());
+}
+
+TEST(Document, AllocatesFromUpstream) {
+    // Arrange
+    // Like a connection's arena, with nowhere to go once it's full.
+    std::array<std::byte, 4096> buffer;
+    std::pmr::monotonic_buffer_resource upstream(
+        buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+
+    // Act
+    auto doc = Document::ParseBorrowed(R"({"a": [1, "x\ny"]})", &upstream);
+
+    // Assert
+    EXPECT_EQ("x\ny", doc.root().as_object().at("a").as_array()[1].as_string());
+}
+
+TEST(Document, RejectsMalformedDocuments) {
+    // Large documents are parsed from a structural index instead, so
+    // everything is also checked padded out to that size.
+    for (size_t pad : {size_t(0), size_t(64 * 1024)}) {
+        EXPECT_TRUE(Rejects("", pad));
+        EXPECT_TRUE(Rejects("[", pad));
+        EXPECT_TRUE(Rejects("[1,]", pad));
+        EXPECT_TRUE(Rejects("[1 2]", pad));
+        EXPECT_TRUE(Rejects("[1-2]", pad));
+        EXPECT_TRUE(Rejects("[true-1]", pad));
+        EXPECT_TRUE(Rejects("{\"a\" 1}", pad));
+        EXPECT_TRUE(Rejects("{\"a\": 1,}", pad));
+        EXPECT_TRUE(Rejects("{1: 1}", pad));
+        EXPECT_TRUE(Rejects("\"abc", pad));
+        EXPECT_TRUE(Rejects("\"a\nb\"", pad));
+        EXPECT_TRUE(Rejects(R"("\x")", pad));
+        EXPECT_TRUE(Rejects(R"("\u12")", pad));
+        EXPECT_TRUE(Rejects(R"("\udc00")", pad));
+        EXPECT_TRUE(Rejects("-", pad));
+        EXPECT_TRUE(Rejects("1x", pad));
+        EXPECT_TRUE(Rejects("1e", pad));
+        EXPECT_TRUE(Rejects("tru", pad));
+        EXPECT_TRUE(Rejects("nullx", pad));
+        EXPECT_TRUE(Rejects("1 2", pad));
+        EXPECT_TRUE(
+            Rejects(std::string(1000, '[') + std::string(1000, ']'), pad));
+        EXPECT_FALSE(
+            Rejects(std::string(100, '[') + std::string(100, ']'), pad));
+    }
+}
+
+TEST(Document, ParseLargeDocument) {
+    // Arrange
+    std::string json = "[";
+    for (int i = 0; i < 5000; i++) {
+        if (i > 0) json += ",\n  ";
+        json += std::format(R"({{"id": {}, "s": "a\"b", "ok": true}})", i);
+    }
+    json += "]";
+
+    // Act
+    auto doc = Document::Parse(json);
+
+    // Assert
+    auto elements = doc.root().as_array();
+    EXPECT_EQ(5000, elements.size());
+    EXPECT_EQ(4999, elements[4999].as_object().at("id").as_number());
+    EXPECT_EQ("a\"b", elements[4999].as_object().at("s").as_string());
+    EXPECT_TRUE(doc.root() == Document::Parse(to_string(doc.root())).root());
+}
+
+}  // namespace json
+}  // namespace gabby
@@ -15,7 +15,7 @@ std::ostream& operator<<(std::ostream& os, Type type) {
     switch (type) {
         case Type::NUM: return os << "NUM";
         case Type::BOOL: return os << "BOOL";
-        case Type::STR: return os << "BOOL";
+        case Type::STR: return os << "STR";
         case Type::ARRAY: return os << "ARRAY";
         case Type::OBJ: return os << "OBJ";
         case Type::NIL: return os << "NIL";
@@ -29,6 +29,26 @@ std::string to_string(Type type) {
     return ss.str();
 }
 
+std::ostream& PrintQuoted(std::ostream& os, std::string_view s) {
+    os << '"';
+    for (char c : s) {
+        switch (c) {
+            case '"': os << "\\\""; break;
+            case '\\': os << "\\\\"; break;
+            case '\n': os << "\\n"; break;
+            case '\r': os << "\\r"; break;
+            case '\t': os << "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    os << std::format("\\u{:04x}", int(c));
+                } else {
+                    os << c;
+                }
+        }
+    }
+    return os << '"';
+}
+
 std::ostream& operator<<(std::ostream& os, const Value& value) {
     return value.print(os);
 }
@@ -7,6 +7,7 @@
 #include <iostream>
 #include <memory>
 #include <stdexcept>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -25,6 +26,9 @@ enum class Type {
 std::ostream& operator<<(std::ostream& os, Type type);
 std::string to_string(Type type);
 
+// writes |s| as a quoted json string, escaping it as needed
+std::ostream& PrintQuoted(std::ostream& os, std::string_view s);
+
 class JSONError : public ::std::runtime_error {
 public:
     explicit JSONError(const std::string& s) : ::std::runtime_error(s) {}
@@ -170,7 +174,7 @@ public:
     }
     StringValue& as_string() override { return *this; }
     std::ostream& print(std::ostream& os) const override {
-        return os << '"' << get() << '"';
+        return PrintQuoted(os, get());
     }
 
     const std::string& operator*() const { return get(); }
@@ -270,7 +274,7 @@ public:
         bool first = true;
         for (const auto& [k, v] : get()) {
             if (!first) os << ", ";
-            os << '"' << k << "\": " << *v;
+            PrintQuoted(os, k) << ": " << *v;
             first = false;
         }
         return os << "}";
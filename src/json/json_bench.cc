@@ -0,0 +1,281 @@
+#include <malloc.h>
+
+#include <cctype>
+#include <cstdio>
+#include <format>
+#include <optional>
+#include <string>
+
+#include "chat_completions.h"
+#include "json/bind.h"
+#include "json/document.h"
+#include "json/json.h"
+#include "json/parser.h"
+#include "json/stream.h"
+#include "json/structural.h"
+#include "test/bench.h"
+
+namespace gabby {
+namespace json {
+
+namespace {
+
+constexpr std::string_view kRequest = R"({
+    "model": "gabby-1",
+    "messages": [
+        {"role": "system", "content": "You are a helpful assistant."},
+        {"role": "user", "content": "Hello! Tell me about \"llamas\"."}
+    ],
+    "stream": true,
+    "temperature": 0.7
+})";
+
+// shaped like tokenizer.json: a large vocabulary object and a large
+// array of merges, about 4 MB in all
+std::string TokenizerJson() {
+    std::string vocab, merges;
+    for (int i = 0; i < 100'000; i++) {
+        if (i > 0) vocab += ", ", merges += ", ";
+        vocab += std::format("\"tok\\u0120{}\": {}", i, i);
+        merges += std::format("\"tok{} en{}\"", i, i + 1);
+    }
+    return std::format(
+        R"({{"version": "1.0", "added_tokens": [{{"id": 128000, )"
+        R"("content": "<|begin_of_text|>", "special": true}}], )"
+        R"("model": {{"type": "BPE", "vocab": {{{}}}, "merges": [{}]}}}})",
+        vocab, merges);
+}
+
+// shaped like a file of batched requests: mostly message text, with
+// indentation, about 4 MB in all
+std::string BatchJson() {
+    std::string batch = "[";
+    for (int i = 0; i < 2000; i++) {
+        if (i > 0) batch += ",";
+        batch += std::format(R"(
+    {{
+        "custom_id": "request-{}",
+        "body": {{
+            "model": "gabby-1",
+            "messages": [
+                {{"role": "system", "content": "{}"}},
+                {{"role": "user", "content": "{}"}}
+            ]
+        }}
+    }})",
+                             i, std::string(200, 's'),
+                             std::string(1800, 'u'));
+    }
+    return batch + "\n]";
+}
+
+// the fgetc-based scanner that Scanner replaced, kept here as a
+// baseline. it returns only the type of each token.
+namespace legacy {
+
+class Scanner {
+public:
+    Scanner(FILE* f, int size) : f_(f), size_(size) {}
+
+    std::optional<TokenType> Scan() {
+        using enum TokenType;
+        SkipWhitespace();
+        int c = GetChar();
+        if (c == EOF) return {};
+        switch (c) {
+            case '[': return LBRACKET;
+            case ']': return RBRACKET;
+            case '{': return LBRACE;
+            case '}': return RBRACE;
+            case ',': return COMMA;
+            case ':': return COLON;
+            case '"': {
+                std::string s;
+                bool escaped = false;
+                while ((c = GetChar()) != EOF) {
+                    if (c == '"' && !escaped) break;
+                    escaped = c == '\\' && !escaped;
+                    if (!escaped) s.push_back(c);
+                }
+                DoNotOptimize(s);
+                return STR;
+            }
+        }
+        std::string s(1, c);
+        while ((c = GetChar()) != EOF && (isalnum(c) || c == '.' ||
+                                           c == '-' || c == '+')) {
+            s.push_back(c);
+        }
+        if (c != EOF) UngetChar(c);
+        if (s == "true" || s == "false") return BOOL;
+        if (s == "null") return NIL;
+        DoNotOptimize(std::stod(s));
+        return NUM;
+    }
+
+private:
+    int GetChar() {
+        clearerr(f_);
+        if (lookahead_.has_value()) {
+            int c = *lookahead_;
+            lookahead_.reset();
+            ++pos_;
+            return c;
+        }
+        if (pos_ >= size_) return EOF;
+        int c = fgetc(f_);
+        if (c != EOF) ++pos_;
+        return c;
+    }
+
+    void UngetChar(int c) {
+        --pos_;
+        lookahead_ = c;
+    }
+
+    void SkipWhitespace() {
+        int c;
+        while ((c = GetChar()) != EOF && isspace(c)) {
+        }
+        if (c != EOF) UngetChar(c);
+    }
+
+    FILE* f_;
+    int size_;
+    int pos_ = 0;
+    std::optional<int> lookahead_;
+};
+
+}  // namespace legacy
+
+// counts the events of a document, and keeps nothing
+class Counter : public Handler {
+public:
+    void Key(std::string_view) override { events++; }
+    void String(std::string_view) override { events++; }
+    void Number(double) override { events++; }
+
+    int events = 0;
+};
+
+// how much more of the heap is in use once |parse| has returned. only
+// meaningful for large documents, since malloc keeps small blocks that
+// have been freed on hand and counts them as in use.
+template <typename F>
+double HeapBytes(const std::string& json, F parse) {
+    size_t before = mallinfo2().uordblks;
+    auto parsed = parse(json);
+    DoNotOptimize(parsed);
+    return double(mallinfo2().uordblks - before);
+}
+
+template <typename F>
+void Measure(BenchmarkState& state, const std::string& json, F parse) {
+    state.SetBytesPerIteration(json.size());
+    while (state.KeepRunning()) {
+        auto parsed = parse(json);
+        DoNotOptimize(parsed);
+    }
+}
+
+// how long building the structural index of the tokenizer takes, if
+// this cpu has |isa|
+void MeasureIndex(BenchmarkState& state, Isa isa) {
+    if (!Supported(isa)) return;
+    std::string json = TokenizerJson();
+    state.SetBytesPerIteration(json.size());
+    while (state.KeepRunning()) {
+        auto index = BuildStructuralIndex(json, isa);
+        DoNotOptimize(index);
+    }
+}
+
+}  // namespace
+
+BENCHMARK(JSON, LegacyScanTokenizer) {
+    std::string json = TokenizerJson();
+    state.SetBytesPerIteration(json.size());
+    while (state.KeepRunning()) {
+        FILE* f = fmemopen(json.data(), json.size(), "r");
+        legacy::Scanner scanner(f, json.size());
+        int tokens = 0;
+        while (scanner.Scan().has_value()) tokens++;
+        DoNotOptimize(tokens);
+        fclose(f);
+    }
+}
+
+BENCHMARK(JSON, ScanTokenizer) {
+    std::string json = TokenizerJson();
+    state.SetBytesPerIteration(json.size());
+    while (state.KeepRunning()) {
+        Scanner scanner(json);
+        int tokens = 0;
+        while (scanner.ScanSkipWhitespace().has_value()) tokens++;
+        DoNotOptimize(tokens);
+    }
+}
+
+BENCHMARK(JSON, IndexTokenizerScalar) { MeasureIndex(state, Isa::Scalar); }
+
+BENCHMARK(JSON, IndexTokenizerSse42) { MeasureIndex(state, Isa::Sse42); }
+
+BENCHMARK(JSON, IndexTokenizerAvx2) { MeasureIndex(state, Isa::Avx2); }
+
+BENCHMARK(JSON, ValueRequest) {
+    Measure(state, std::string(kRequest),
+            [](const std::string& json) { return Parse(json); });
+}
+
+BENCHMARK(JSON, DocumentRequest) {
+    Measure(state, std::string(kRequest), [](const std::string& json) {
+        return Document::ParseBorrowed(json);
+    });
+}
+
+BENCHMARK(JSON, BindRequest) {
+    Measure(state, std::string(kRequest), [](const std::string& json) {
+        return Read<ChatCompletionRequest>(json);
+    });
+}
+
+BENCHMARK(JSON, DocumentBatch) {
+    Measure(state, BatchJson(), [](const std::string& json) {
+        return Document::ParseBorrowed(json);
+    });
+}
+
+BENCHMARK(JSON, ValueTokenizer) {
+    auto parse = [](const std::string& json) { return Parse(json); };
+    std::string json = TokenizerJson();
+    state.counters["heap_bytes"] = HeapBytes(json, parse);
+    Measure(state, json, parse);
+}
+
+BENCHMARK(JSON, DocumentTokenizer) {
+    auto parse = [](const std::string& json) {
+        return Document::ParseBorrowed(json);
+    };
+    std::string json = TokenizerJson();
+    state.counters["heap_bytes"] = HeapBytes(json, parse);
+    Measure(state, json, parse);
+}
+
+BENCHMARK(JSON, StreamTokenizer) {
+    auto parse = [](const std::string& json) {
+        Counter counter;
+        // fed in pieces, as it would be from a file
+        StreamParser parser(counter);
+        for (size_t i = 0; i < json.size(); i += 64 * 1024) {
+            parser.Feed(std::string_view(json).substr(i, 64 * 1024));
+        }
+        parser.Finish();
+        return counter.events;
+    };
+    std::string json = TokenizerJson();
+    state.counters["heap_bytes"] = HeapBytes(json, parse);
+    Measure(state, json, parse);
+}
+
+}  // namespace json
+}  // namespace gabby
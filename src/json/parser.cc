@@ -5,6 +5,7 @@
 #include <cstring>
 #include <format>
 
+#include "json/scan.h"
 #include "utils/logging.h"
 #include "utils/pointers.h"
 
@@ -28,166 +29,56 @@ constexpr const std::string_view to_string(TokenType type) {
     assert(false);
 }
 
-int Scanner::GetChar() {
-    clearerr(f_);
-    if (lookahead_.has_value()) {
-        int c = *lookahead_;
-        lookahead_.reset();
-        ++pos_;
-        return c;
-    }
-    if (pos_ >= size_) {
-        return EOF;
-    }
-    int c = fgetc(f_);
-    if (c != EOF) ++pos_;
-    return c;
-}
-
-void Scanner::UngetChar(int c) {
-    assert(!lookahead_.has_value());
-    --pos_;
-    lookahead_ = c;
-}
-
-void Scanner::SkipWhitespace() {
-    while (true) {
-        int c = GetChar();
-        if (c == EOF) return;
-        if (!isspace(c)) {
-            UngetChar(c);
-            return;
-        }
-    }
-}
-
-std::optional<char> Scanner::Peek() {
-    int c = GetChar();
-    if (c == EOF) {
-        if (errno == EAGAIN || errno == EWOULDBLOCK) return {};
-        if (ferror(f_)) throw SystemError(errno);
-        return {};
-    }
-    UngetChar(c);
-    return c;
-}
-
-char Scanner::Advance() {
-    int c = GetChar();
-    if (c == EOF) {
-        if (ferror(f_)) throw SystemError(errno);
-        else throw ParsingError("unexpected eof");
-    }
-    return c;
-}
-
-bool is_delim(std::optional<char> c) { return !c.has_value() || !isalnum(*c); }
-
 std::optional<Token> Scanner::ScanSkipWhitespace() {
     auto tok = Scan();
-    SkipWhitespace();
+    p_ = SkipWhitespace(p_, end_);
     return tok;
 }
 
 std::optional<Token> Scanner::Scan() {
     using enum TokenType;
-    SkipWhitespace();
-    std::optional<char> maybe_c = Peek();
-    if (!maybe_c.has_value()) return {};
-    int c = *maybe_c;
-
-    switch (c) {
-        case '[': return Token{.type = LBRACKET, .cargo = Advance()};
-        case ']': return Token{.type = RBRACKET, .cargo = Advance()};
-        case '{': return Token{.type = LBRACE, .cargo = Advance()};
-        case '}': return Token{.type = RBRACE, .cargo = Advance()};
-        case ',': return Token{.type = COMMA, .cargo = Advance()};
-        case ':': return Token{.type = COLON, .cargo = Advance()};
+    p_ = SkipWhitespace(p_, end_);
+    if (p_ == end_) return {};
+
+    switch (char c = *p_) {
+        case '[': ++p_; return Token{.type = LBRACKET};
+        case ']': ++p_; return Token{.type = RBRACKET};
+        case '{': ++p_; return Token{.type = LBRACE};
+        case '}': ++p_; return Token{.type = RBRACE};
+        case ',': ++p_; return Token{.type = COMMA};
+        case ':': ++p_; return Token{.type = COLON};
+        case 't':
+            p_ = ScanLiteral(p_, end_, "true");
+            return Token{.type = BOOL, .boolean = true};
+        case 'f':
+            p_ = ScanLiteral(p_, end_, "false");
+            return Token{.type = BOOL, .boolean = false};
+        case 'n': p_ = ScanLiteral(p_, end_, "null"); return Token{.type = NIL};
 
         // strings
         case '"': {
-            Advance();
-            std::string s;
+            const char* start = ++p_;
             bool escaped = false;
-            while (true) {
-                c = Advance();
-                if ((c == '"' && !escaped) || c == '\n') break;
-                if (c == '\\' && !escaped) {
-                    escaped = true;
-                    continue;
-                }
-                escaped = false;
-                s.push_back(c);
-            }
-            if (c != '"') throw ParsingError("unterminated string");
-            return Token{.type = STR, .cargo = s};
-        }
-    }
-
-    // numbers
-    if (c == '-' || isdigit(c)) {
-        std::string s;
-
-        // sign
-        if (c == '-') s.push_back(Advance());
-
-        // integral part
-        do {
-            s.push_back(Advance());
-        } while (!is_delim(Peek()) && *Peek() != 'e');
-
-        // decimal
-        if (Peek() == std::optional('.')) {
-            s.push_back(Advance());
-
-            // fractional part
-            while (!is_delim(Peek()) && *Peek() != 'e') {
-                s.push_back(Advance());
-            }
+            const char* stop = FindStringEnd(p_, end_, &escaped);
+            p_ = stop + 1;
+            std::string_view raw(start, stop);
+            if (!escaped) return Token{.type = STR, .str = raw};
+            // decoding only ever shrinks a string
+            unescaped_.resize(raw.size());
+            char* out = Unescape(raw, unescaped_.data());
+            unescaped_.resize(out - unescaped_.data());
+            return Token{.type = STR, .str = unescaped_};
         }
 
-        // scientific notation
-        if (Peek() == std::optional('e')) {
-            s.push_back(Advance());
-
-            // sign
-            if (maybe_c = Peek();
-                maybe_c == std::optional('+') || std::optional('-')) {
-                s.push_back(Advance());
-            }
-
-            // exponent
-            while (!is_delim(Peek())) {
-                s.push_back(Advance());
+        // numbers
+        default:
+            if (c == '-' || IsDigit(c)) {
+                Token tok{.type = NUM};
+                p_ = ScanNumber(p_, end_, &tok.num);
+                return tok;
             }
-        }
-
-        // parse
-        double value;
-        try {
-            value = std::stod(s);
-        } catch (...) {
-            throw ParsingError("bad number: " + s);
-        }
-
-        return Token{.type = NUM, .cargo = value};
+            throw ParsingError(std::format("bad token: {}", c));
     }
-
-    // null, booleans
-    if (isalpha(c)) {
-        std::string s;
-        do {
-            s.push_back(Advance());
-        } while (!is_delim(Peek()));
-        if (s == "true" || s == "false") {
-            return Token{.type = BOOL, .cargo = (s == "true")};
-        }
-        if (s == "null") {
-            return Token{.type = NIL, .cargo = "null"};
-        }
-    }
-
-    throw ParsingError(std::format("bad token: {}", char(c)));
 }
 
 std::optional<Token> Parser::Peek() {
@@ -216,9 +107,9 @@ ValuePtr Parser::Value() {
     std::optional<Token> tok = Peek();
     if (!tok.has_value()) throw ParsingError("unexpected eof");
     switch (tok->type) {
-        case NUM: return Value::Number(std::get<double>(Next().cargo));
-        case STR: return Value::String(std::get<std::string>(Next().cargo));
-        case BOOL: return Value::Boolean(std::get<bool>(Next().cargo));
+        case NUM: return Value::Number(Next().num);
+        case STR: return Value::String(std::string(Next().str));
+        case BOOL: return Value::Boolean(Next().boolean);
         case NIL: {
             Next();
             return Value::Nil();
@@ -246,7 +137,7 @@ ValuePtr Parser::Value() {
                 if (!next.has_value()) break;
                 if (next->type == RBRACE) break;
                 if (!values.empty()) Eat(COMMA);
-                auto key = std::get<std::string>(Eat(STR).cargo);
+                auto key = std::string(Eat(STR).str);
                 Eat(COLON);
                 auto value = Value();
                 values[key] = value;
@@ -261,18 +152,20 @@ ValuePtr Parser::Value() {
     }
 }
 
-ValuePtr Parse(FILE* f, int size) {
-    auto parser = Parser(f, size);
+ValuePtr Parse(std::string_view s) {
+    auto parser = Parser(s);
     auto value = parser.Value();
-    if (parser.pos() != size) throw ParsingError("unexpected trailing data");
+    if (size_t(parser.pos()) != s.size()) {
+        throw ParsingError("unexpected trailing data");
+    }
     return value;
 }
 
-ValuePtr Parse(const std::string& s) {
-    std::unique_ptr<FILE, decltype(&fclose)> f(
-        fmemopen((void*)s.data(), s.size(), "r"), fclose);
-    if (f.get() == nullptr) throw SystemError(errno);
-    return Parse(f.get(), s.size());
+ValuePtr Parse(FILE* f, int size) {
+    std::string s(size, '\0');
+    s.resize(fread(s.data(), 1, size, f));
+    if (ferror(f)) throw SystemError(errno);
+    return Parse(s);
 }
 
 ValuePtr ParseFile(const std::filesystem::path& path) {
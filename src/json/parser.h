@@ -6,7 +6,7 @@
 #include <memory>
 #include <optional>
 #include <string>
-#include <variant>
+#include <string_view>
 
 #include "json/json.h"
 
@@ -28,32 +28,39 @@ enum class TokenType {
 
 struct Token {
     TokenType type;
-    std::variant<double, bool, char, std::string> cargo;
+    // a string's contents, with any escapes decoded. it's only valid
+    // until the next token is scanned.
+    std::string_view str;
+    double num = 0;
+    bool boolean = false;
 };
 
+// splits a buffer of json into tokens
 class Scanner {
 public:
-    Scanner(FILE* f, int size) : f_(f), size_(size) {}
+    // |json| must outlive the scanner
+    explicit Scanner(std::string_view json)
+        : begin_(json.data()),
+          p_(json.data()),
+          end_(json.data() + json.size()) {}
+
+    // returns the next token, or nothing at the end of the buffer
     std::optional<Token> ScanSkipWhitespace();
-    int pos() const { return pos_; }
+    int pos() const { return p_ - begin_; }
 
 private:
-    void SkipWhitespace();
-    std::optional<char> Peek();
-    char Advance();
-    int GetChar();
-    void UngetChar(int c);
     std::optional<Token> Scan();
 
-    FILE* f_;
-    int size_;
-    int pos_ = 0;
-    std::optional<int> lookahead_;
+    const char* begin_;
+    const char* p_;
+    const char* end_;
+    // where strings with escapes are decoded
+    std::string unescaped_;
 };
 
 class Parser {
 public:
-    Parser(FILE* f, int size) : scan_(Scanner(f, size)) {}
+    explicit Parser(std::string_view json) : scan_(json) {}
 
     ValuePtr Value();
     int pos() const { return scan_.pos(); }
@@ -68,8 +75,9 @@ private:
 };
 
 ValuePtr ParseFile(const std::filesystem::path& path);
+ValuePtr Parse(std::string_view s);
+// reads |size| bytes from |f|, and parses them
 ValuePtr Parse(FILE* f, int size);
-ValuePtr Parse(const std::string& s);
 
 }  // namespace json
 }  // namespace gabby
@@ -1,5 +1,9 @@
 #include "json/parser.h"
 
+#include <cstdio>
+#include <string>
+#include <vector>
+
 #include "json/json.h"
 #include "test/test.h"
 
@@ -11,6 +15,11 @@ TEST(JSON, ParseEscapes) {
     EXPECT_EQ(*Value::String(R"(\\")"), *Parse(R"("\\\\\"")"));
 }
 
+TEST(JSON, PrintEscapes) {
+    EXPECT_EQ(R"("a\"b\\c\nd\u0001")",
+              to_string(*Value::String("a\"b\\c\nd\x01")));
+}
+
 TEST(JSON, ParseNull) { EXPECT_EQ(*Value::Nil(), *Parse("null")); }
 
 TEST(JSON, ParseNumber) {
@@ -49,6 +58,48 @@ TEST(JSON, ParseObject) {
               *Parse("{\"a\": \"b\", \"c\": 1}"));
 }
 
+TEST(JSON, ScanTokens) {
+    // Arrange
+    using enum TokenType;
+    Scanner scanner(R"( {"a\tb": [1.5, true, null]}  )");
+
+    // Act
+    std::vector<TokenType> types;
+    std::vector<std::string> strs;
+    std::vector<double> nums;
+    while (auto tok = scanner.ScanSkipWhitespace()) {
+        types.push_back(tok->type);
+        if (tok->type == STR) strs.push_back(std::string(tok->str));
+        if (tok->type == NUM) nums.push_back(tok->num);
+    }
+
+    // Assert
+    EXPECT_EQ((std::vector<TokenType>{LBRACE, STR, COLON, LBRACKET, NUM,
+                                      COMMA, BOOL, COMMA, NIL, RBRACKET,
+                                      RBRACE}),
+              types);
+    EXPECT_EQ(std::vector<std::string>{"a\tb"}, strs);
+    EXPECT_EQ(std::vector<double>{1.5}, nums);
+    EXPECT_EQ(30, scanner.pos());
+}
+
+TEST(JSON, ParseFromStream) {
+    // Arrange
+    std::string json = R"({"a": [1, "b"]} trailing)";
+    FILE* f = fmemopen(json.data(), json.size(), "r");
+
+    // Act
+    // Only the first |size| bytes are read.
+    auto value = Parse(f, 15);
+    fclose(f);
+
+    // Assert
+    EXPECT_EQ(*Value::Object({
+                  {"a", Value::Array({Value::Number(1), Value::String("b")})},
+              }),
+              *value);
+}
+
 TEST(JSON, ParseCompletionRequest) {
     ScopedLogLevel scope(LogLevel::DEBUG);
     EXPECT_EQ(
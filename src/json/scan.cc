@@ -0,0 +1,206 @@
+#include "json/scan.h"
+
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <string>
+
+#include "json/json.h"
+
+namespace gabby {
+namespace json {
+
+namespace {
+
+constexpr uint64_t kOnes = 0x0101010101010101;
+constexpr uint64_t kLows = 0x7f7f7f7f7f7f7f7f;
+constexpr uint64_t kHighs = 0x8080808080808080;
+
+uint64_t Load(const char* p) {
+    uint64_t x;
+    std::memcpy(&x, p, sizeof(x));
+    return x;
+}
+
+// sets the high bit of each zero byte of |x|, and only those. the
+// usual (x - ones) & ~x trick is cheaper, but it can also flag the
+// bytes after the first zero one.
+uint64_t ZeroBytes(uint64_t x) { return ~(((x & kLows) + kLows) | x | kLows); }
+
+uint64_t Equal(uint64_t x, char c) {
+    return ZeroBytes(x ^ (kOnes * static_cast<uint8_t>(c)));
+}
+
+// the offset of the first flagged byte. bytes are loaded little-endian,
+// so that's the lowest.
+int FirstByte(uint64_t flags) { return std::countr_zero(flags) / 8; }
+
+int HexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// writes |cp| to |out| as utf-8, and returns the end of what it wrote
+char* AppendUtf8(char* out, uint32_t cp) {
+    if (cp < 0x80) {
+        *out++ = char(cp);
+    } else if (cp < 0x800) {
+        *out++ = char(0xc0 | cp >> 6);
+        *out++ = char(0x80 | (cp & 0x3f));
+    } else if (cp < 0x10000) {
+        *out++ = char(0xe0 | cp >> 12);
+        *out++ = char(0x80 | (cp >> 6 & 0x3f));
+        *out++ = char(0x80 | (cp & 0x3f));
+    } else {
+        *out++ = char(0xf0 | cp >> 18);
+        *out++ = char(0x80 | (cp >> 12 & 0x3f));
+        *out++ = char(0x80 | (cp >> 6 & 0x3f));
+        *out++ = char(0x80 | (cp & 0x3f));
+    }
+    return out;
+}
+
+bool IsWordChar(char c) { return std::isalnum(static_cast<unsigned char>(c)); }
+
+}  // namespace
+
+const char* SkipWhitespace(const char* p, const char* end) {
+    // most values follow a single space, or none at all
+    if (p != end && !IsSpace(*p)) return p;
+    while (end - p >= 8) {
+        uint64_t x = Load(p);
+        uint64_t space =
+            Equal(x, ' ') | Equal(x, '\n') | Equal(x, '\r') | Equal(x, '\t');
+        if (uint64_t other = ~space & kHighs) return p + FirstByte(other);
+        p += 8;
+    }
+    while (p != end && IsSpace(*p)) ++p;
+    return p;
+}
+
+const char* SkipStringContents(const char* p, const char* end) {
+    while (end - p >= 8) {
+        uint64_t x = Load(p);
+        uint64_t special =
+            Equal(x, '"') | Equal(x, '\\') | ZeroBytes(x & (kOnes * 0xe0));
+        if (special) return p + FirstByte(special);
+        p += 8;
+    }
+    while (p != end && *p != '"' && *p != '\\' &&
+           static_cast<unsigned char>(*p) >= 0x20) {
+        ++p;
+    }
+    return p;
+}
+
+const char* FindStringEnd(const char* p, const char* end, bool* escaped) {
+    *escaped = false;
+    while (true) {
+        p = SkipStringContents(p, end);
+        // a raw newline most likely means the quote was left off
+        if (p == end || (*p != '"' && *p != '\\')) {
+            throw ParsingError("unterminated string");
+        }
+        if (*p == '"') return p;
+        *escaped = true;
+        if (end - p < 2) throw ParsingError("unterminated string");
+        p += 2;
+    }
+}
+
+char* Unescape(std::string_view raw, char* out) {
+    const char* s = raw.data();
+    const char* stop = raw.data() + raw.size();
+    while (s != stop) {
+        const char* backslash =
+            static_cast<const char*>(std::memchr(s, '\\', stop - s));
+        if (backslash == nullptr) backslash = stop;
+        std::memcpy(out, s, backslash - s);
+        out += backslash - s;
+        s = backslash;
+        if (s == stop) break;
+        ++s;
+        switch (char c = *s++) {
+            case '"':
+            case '\\':
+            case '/': *out++ = c; break;
+            case 'b': *out++ = '\b'; break;
+            case 'f': *out++ = '\f'; break;
+            case 'n': *out++ = '\n'; break;
+            case 'r': *out++ = '\r'; break;
+            case 't': *out++ = '\t'; break;
+            case 'u': {
+                auto hex4 = [&s, stop]() {
+                    uint32_t cp = 0;
+                    for (int i = 0; i < 4; i++) {
+                        int d = s == stop ? -1 : HexDigit(*s++);
+                        if (d < 0) throw ParsingError("bad unicode escape");
+                        cp = cp << 4 | d;
+                    }
+                    return cp;
+                };
+                uint32_t cp = hex4();
+                if (cp >= 0xd800 && cp < 0xdc00) {
+                    // the first half of a surrogate pair
+                    if (stop - s < 2 || s[0] != '\\' || s[1] != 'u') {
+                        throw ParsingError("bad unicode escape");
+                    }
+                    s += 2;
+                    uint32_t low = hex4();
+                    if (low < 0xdc00 || low >= 0xe000) {
+                        throw ParsingError("bad unicode escape");
+                    }
+                    cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+                } else if (cp >= 0xdc00 && cp < 0xe000) {
+                    throw ParsingError("bad unicode escape");
+                }
+                out = AppendUtf8(out, cp);
+                break;
+            }
+            default: throw ParsingError(std::format("bad escape: \\{}", c));
+        }
+    }
+    return out;
+}
+
+const char* ScanNumber(const char* p, const char* end, double* value) {
+    const char* start = p;
+    if (p != end && *p == '-') ++p;
+    if (p == end || !IsDigit(*p)) {
+        throw ParsingError(std::format("bad number: {}",
+                                       std::string_view(start, p)));
+    }
+    auto [stop, ec] = std::from_chars(start, end, *value);
+    if (ec == std::errc::invalid_argument) {
+        throw ParsingError(std::format("bad number: {}",
+                                       std::string_view(start, p + 1)));
+    }
+    // out of range: from_chars leaves the number alone, but says where
+    // it ended. json has no infinities, so we saturate like strtod.
+    if (ec == std::errc::result_out_of_range) {
+        *value = std::strtod(std::string(start, stop).c_str(), nullptr);
+    }
+    if (stop != end && (IsWordChar(*stop) || *stop == '.')) {
+        throw ParsingError(std::format("bad number: {}",
+                                       std::string_view(start, stop + 1)));
+    }
+    return stop;
+}
+
+const char* ScanLiteral(const char* p, const char* end, std::string_view word) {
+    size_t left = end - p;
+    if (left < word.size() || std::string_view(p, word.size()) != word ||
+        (left > word.size() && IsWordChar(p[word.size()]))) {
+        throw ParsingError(std::format("bad token: {}", *p));
+    }
+    return p + word.size();
+}
+
+}  // namespace json
+}  // namespace gabby
@@ -0,0 +1,48 @@
+#ifndef GABBY_JSON_SCAN_H_
+#define GABBY_JSON_SCAN_H_
+
+#include <string_view>
+
+// the pieces of json's grammar that every parser needs, over a buffer.
+// each takes the next byte to look at, |p|, and the end of the buffer,
+// and returns where it stopped. the loops that run over long stretches
+// of input, whitespace and strings, look at 8 bytes at a time.
+
+namespace gabby {
+namespace json {
+
+inline bool IsSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+inline bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+// returns the first byte that isn't whitespace, or |end|
+const char* SkipWhitespace(const char* p, const char* end);
+
+// returns the first quote, backslash or control character at or after
+// |p|, which is inside a string, or |end| if there isn't one
+const char* SkipStringContents(const char* p, const char* end);
+
+// |p| is just after a string's opening quote. returns its closing
+// quote, and sets |escaped| if there are escapes in between. throws
+// ParsingError if the string isn't terminated.
+const char* FindStringEnd(const char* p, const char* end, bool* escaped);
+
+// decodes the escapes in the contents of a string, |raw|, into |out|,
+// which must have room for raw.size() bytes. returns the end of what
+// it wrote. throws ParsingError if an escape is invalid.
+char* Unescape(std::string_view raw, char* out);
+
+// parses the number at |p| into |value|. throws ParsingError if it
+// isn't one, or runs into the next word.
+const char* ScanNumber(const char* p, const char* end, double* value);
+
+// returns the end of the word (true, false, null) at |p|, or throws
+// ParsingError if it isn't |word|
+const char* ScanLiteral(const char* p, const char* end, std::string_view word);
+
+}  // namespace json
+}  // namespace gabby
+
+#endif  // GABBY_JSON_SCAN_H_
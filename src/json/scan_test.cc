@@ -0,0 +1,62 @@
+#include "json/scan.h"
+
+#include <string>
+
+#include "json/json.h"
+#include "test/test.h"
+
+namespace gabby {
+namespace json {
+
+TEST(Scan, SkipWhitespace) {
+    for (int n = 0; n < 20; n++) {
+        // Arrange
+        // Runs of every length, ending anywhere within 8 bytes.
+        std::string s = std::string(n, ' ') + "\n\t\r" + std::string(n, ' ');
+        s += "x" + std::string(20, ' ');
+        const char* p = s.data();
+
+        // Act
+        const char* stop = SkipWhitespace(p, p + s.size());
+        const char* all = SkipWhitespace(stop + 1, p + s.size());
+
+        // Assert
+        EXPECT_EQ(2 * n + 3, stop - p);
+        EXPECT_EQ(p + s.size(), all);
+    }
+}
+
+TEST(Scan, FindStringEnd) {
+    for (int n = 0; n < 20; n++) {
+        // Arrange
+        std::string plain = std::string(n, 'a') + "\xc3\xa9\"" + "tail\"";
+        std::string escaped = std::string(n, 'a') + "\\\"b\\\\\"tail";
+        std::string unterminated = std::string(n, 'a') + "\nb\"";
+        bool plain_escaped = true, escaped_escaped = false;
+
+        // Act
+        const char* plain_end = FindStringEnd(
+            plain.data(), plain.data() + plain.size(), &plain_escaped);
+        const char* escaped_end =
+            FindStringEnd(escaped.data(), escaped.data() + escaped.size(),
+                          &escaped_escaped);
+        bool threw = false;
+        try {
+            bool ignored;
+            FindStringEnd(unterminated.data(),
+                          unterminated.data() + unterminated.size(), &ignored);
+        } catch (const ParsingError& e) {
+            threw = true;
+        }
+
+        // Assert
+        EXPECT_EQ(n + 2, plain_end - plain.data());
+        EXPECT_FALSE(plain_escaped);
+        EXPECT_EQ(n + 5, escaped_end - escaped.data());
+        EXPECT_TRUE(escaped_escaped);
+        EXPECT_TRUE(threw);
+    }
+}
+
+}  // namespace json
+}  // namespace gabby
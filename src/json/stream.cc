@@ -0,0 +1,248 @@
+#include "json/stream.h"
+
+#include <cctype>
+#include <cerrno>
+#include <format>
+#include <vector>
+
+#include "json/json.h"
+#include "json/scan.h"
+#include "utils/logging.h"
+
+namespace gabby {
+namespace json {
+
+namespace {
+
+// how much of a file is read at a time
+constexpr size_t kChunkSize = 64 * 1024;
+
+// the bytes of a number or a literal, and of anything we'd reject
+// that's in the way of one
+bool IsScalarByte(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '-' ||
+           c == '+' || c == '.';
+}
+
+}  // namespace
+
+void StreamParser::Feed(std::string_view chunk) {
+    const char* p = chunk.data();
+    const char* end = p + chunk.size();
+    if (p == end) return;
+    switch (partial_) {
+        case Partial::STRING:
+            if (escape_) {
+                pending_.push_back(*p++);
+                escape_ = false;
+            }
+            p = String(p, end);
+            break;
+        case Partial::SCALAR: p = Scalar(p, end); break;
+        case Partial::NONE: break;
+    }
+    // each token returns null if it was cut off at the end
+    while (p != nullptr) {
+        p = SkipWhitespace(p, end);
+        if (p == end) return;
+        p = Token(p, end);
+    }
+}
+
+void StreamParser::Finish() {
+    if (partial_ == Partial::STRING) throw ParsingError("unterminated string");
+    if (partial_ == Partial::SCALAR) {
+        // a number at the very end, which nothing else could end
+        partial_ = Partial::NONE;
+        EmitScalar(pending_);
+        pending_.clear();
+    }
+    if (state_ != State::DONE) throw ParsingError("unexpected eof");
+}
+
+const char* StreamParser::Token(const char* p, const char* end) {
+    char c = *p;
+    switch (state_) {
+        case State::DONE: throw ParsingError("unexpected trailing data");
+        case State::COLON:
+            if (c != ':') throw ParsingError(std::format("want :, got {}", c));
+            state_ = State::VALUE;
+            return p + 1;
+        case State::AFTER_VALUE:
+            if (c == ',') {
+                state_ = objects_[depth_ - 1] ? State::KEY : State::VALUE;
+            } else {
+                Close(c);
+            }
+            return p + 1;
+        case State::OBJECT_START:
+            if (c == '}') {
+                Close(c);
+                return p + 1;
+            }
+            [[fallthrough]];
+        case State::KEY:
+            if (c != '"') throw ParsingError(std::format("want key, got {}", c));
+            return String(p + 1, end);
+        case State::ARRAY_START:
+            if (c == ']') {
+                Close(c);
+                return p + 1;
+            }
+            break;
+        case State::VALUE: break;
+    }
+    return Value(p, end);
+}
+
+const char* StreamParser::Value(const char* p, const char* end) {
+    switch (*p) {
+        case '{': Open(true); return p + 1;
+        case '[': Open(false); return p + 1;
+        case '"': return String(p + 1, end);
+    }
+    return Scalar(p, end);
+}
+
+const char* StreamParser::String(const char* p, const char* end) {
+    const char* start = p;
+    while (true) {
+        p = SkipStringContents(p, end);
+        if (p == end) break;
+        if (*p == '"') {
+            if (partial_ == Partial::NONE) {
+                EmitString(std::string_view(start, p));
+            } else {
+                pending_.append(start, p);
+                partial_ = Partial::NONE;
+                EmitString(pending_);
+                pending_.clear();
+            }
+            return p + 1;
+        }
+        if (*p != '\\') throw ParsingError("unterminated string");
+        // the escaped byte may be in the next piece
+        if (++p == end) {
+            escape_ = true;
+            break;
+        }
+        ++p;
+    }
+    pending_.append(start, end);
+    partial_ = Partial::STRING;
+    return nullptr;
+}
+
+const char* StreamParser::Scalar(const char* p, const char* end) {
+    const char* start = p;
+    while (p != end && IsScalarByte(*p)) ++p;
+    if (p == end) {
+        pending_.append(start, end);
+        partial_ = Partial::SCALAR;
+        return nullptr;
+    }
+    if (partial_ == Partial::NONE) {
+        if (p == start) throw ParsingError(std::format("bad token: {}", *p));
+        EmitScalar(std::string_view(start, p));
+    } else {
+        pending_.append(start, p);
+        partial_ = Partial::NONE;
+        EmitScalar(pending_);
+        pending_.clear();
+    }
+    return p;
+}
+
+void StreamParser::EmitString(std::string_view raw) {
+    std::string_view s = raw;
+    if (raw.find('\\') != std::string_view::npos) {
+        // decoding only ever shrinks a string
+        unescaped_.resize(raw.size());
+        char* out = unescaped_.data();
+        s = std::string_view(out, Unescape(raw, out));
+    }
+    if (state_ == State::KEY || state_ == State::OBJECT_START) {
+        state_ = State::COLON;
+        handler_.Key(s);
+    } else {
+        AfterValue();
+        handler_.String(s);
+    }
+}
+
+void StreamParser::EmitScalar(std::string_view word) {
+    const char* p = word.data();
+    const char* end = p + word.size();
+    AfterValue();
+    switch (word[0]) {
+        case 't':
+            if (ScanLiteral(p, end, "true") != end) break;
+            handler_.Boolean(true);
+            return;
+        case 'f':
+            if (ScanLiteral(p, end, "false") != end) break;
+            handler_.Boolean(false);
+            return;
+        case 'n':
+            if (ScanLiteral(p, end, "null") != end) break;
+            handler_.Null();
+            return;
+    }
+    if (word[0] == '-' || IsDigit(word[0])) {
+        double n;
+        if (ScanNumber(p, end, &n) != end) {
+            throw ParsingError(std::format("bad number: {}", word));
+        }
+        handler_.Number(n);
+        return;
+    }
+    throw ParsingError(std::format("bad token: {}", word));
+}
+
+void StreamParser::Open(bool object) {
+    if (depth_ == kMaxDepth) throw ParsingError("nested too deeply");
+    objects_[depth_++] = object;
+    if (object) {
+        state_ = State::OBJECT_START;
+        handler_.StartObject();
+    } else {
+        state_ = State::ARRAY_START;
+        handler_.StartArray();
+    }
+}
+
+void StreamParser::Close(char c) {
+    bool object = objects_[depth_ - 1];
+    char want = object ? '}' : ']';
+    if (c != want) throw ParsingError(std::format("want {}, got {}", want, c));
+    --depth_;
+    AfterValue();
+    if (object) {
+        handler_.EndObject();
+    } else {
+        handler_.EndArray();
+    }
+}
+
+void StreamParser::AfterValue() {
+    state_ = depth_ == 0 ? State::DONE : State::AFTER_VALUE;
+}
+
+void ParseStream(std::string_view json, Handler& handler) {
+    StreamParser parser(handler);
+    parser.Feed(json);
+    parser.Finish();
+}
+
+void ParseStream(FILE* f, Handler& handler) {
+    StreamParser parser(handler);
+    std::vector<char> chunk(kChunkSize);
+    while (size_t n = fread(chunk.data(), 1, chunk.size(), f)) {
+        parser.Feed(std::string_view(chunk.data(), n));
+    }
+    if (ferror(f)) throw SystemError(errno);
+    parser.Finish();
+}
+
+}  // namespace json
+}  // namespace gabby
@@ -0,0 +1,96 @@
+#ifndef GABBY_JSON_STREAM_H_
+#define GABBY_JSON_STREAM_H_
+
+#include <bitset>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+namespace gabby {
+namespace json {
+
+// receives the events of a document as it's parsed, in order. strings
+// and keys are only valid until the call returns. the defaults ignore
+// everything, so handlers only override what they care about.
+class Handler {
+public:
+    virtual ~Handler() = default;
+
+    virtual void StartObject() {}
+    virtual void Key(std::string_view) {}
+    virtual void EndObject() {}
+    virtual void StartArray() {}
+    virtual void EndArray() {}
+    virtual void String(std::string_view) {}
+    virtual void Number(double) {}
+    virtual void Boolean(bool) {}
+    virtual void Null() {}
+};
+
+// parses a document that arrives in pieces, calling a handler as each
+// token is completed, without building anything. apart from the
+// handler, it only keeps the nesting of what it's in, and a token that
+// a piece cut off until the next one finishes it, so it runs in
+// constant memory for any document without very long strings.
+class StreamParser {
+public:
+    // |handler| must outlive the parser
+    explicit StreamParser(Handler& handler) : handler_(handler) {}
+
+    // parses the next piece of the document. throws ParsingError as
+    // soon as it isn't valid json.
+    void Feed(std::string_view chunk);
+
+    // ends the document, throwing ParsingError if it isn't complete
+    void Finish();
+
+private:
+    // what's allowed next
+    enum class State {
+        VALUE,
+        ARRAY_START,  // a value or ]
+        OBJECT_START,  // a key or }
+        KEY,
+        COLON,
+        AFTER_VALUE,  // a comma, or the end of what we're in
+        DONE,
+    };
+
+    // the kind of token cut off at the end of the last piece
+    enum class Partial { NONE, STRING, SCALAR };
+
+    const char* Token(const char* p, const char* end);
+    const char* Value(const char* p, const char* end);
+    const char* String(const char* p, const char* end);
+    const char* Scalar(const char* p, const char* end);
+    void EmitString(std::string_view raw);
+    void EmitScalar(std::string_view word);
+    void Open(bool object);
+    void Close(char c);
+    void AfterValue();
+
+    Handler& handler_;
+    State state_ = State::VALUE;
+    // bit i is set if the container at depth i is an object
+    static constexpr int kMaxDepth = 512;
+    std::bitset<kMaxDepth> objects_;
+    int depth_ = 0;
+    Partial partial_ = Partial::NONE;
+    // the last piece ended just after a backslash in a string
+    bool escape_ = false;
+    // the start of a token cut off at the end of the last piece
+    std::string pending_;
+    // where strings with escapes are decoded
+    std::string unescaped_;
+};
+
+// parses all of |json|
+void ParseStream(std::string_view json, Handler& handler);
+
+// parses everything left in |f|, a piece at a time
+void ParseStream(FILE* f, Handler& handler);
+
+}  // namespace json
+}  // namespace gabby
+
+#endif  // GABBY_JSON_STREAM_H_
@@ -0,0 +1,157 @@
+#include "json/stream.h"
+
+#include <cstdio>
+#include <format>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "json/json.h"
+#include "test/test.h"
+
+namespace gabby {
+namespace json {
+
+namespace {
+
+// writes down each event it gets
+class Recorder : public Handler {
+public:
+    void StartObject() override { events.push_back("{"); }
+    void Key(std::string_view key) override {
+        events.push_back(std::format("key {}", key));
+    }
+    void EndObject() override { events.push_back("}"); }
+    void StartArray() override { events.push_back("["); }
+    void EndArray() override { events.push_back("]"); }
+    void String(std::string_view s) override {
+        events.push_back(std::format("str {}", s));
+    }
+    void Number(double n) override {
+        events.push_back(std::format("num {}", n));
+    }
+    void Boolean(bool b) override {
+        events.push_back(std::format("bool {}", b));
+    }
+    void Null() override { events.push_back("null"); }
+
+    std::vector<std::string> events;
+};
+
+constexpr std::string_view kJson =
+    R"({"a": [1, -2.5e1, true, false, null], "b\n": {"c": "d\"é"},)"
+    R"( "e": [], "f": {}, "g": [[""]]})";
+
+const std::vector<std::string> kEvents = {
+    "{",
+    "key a", "[", "num 1", "num -25", "bool true", "bool false", "null", "]",
+    "key b\n", "{", "key c", "str d\"é", "}",
+    "key e", "[", "]",
+    "key f", "{", "}",
+    "key g", "[", "[", "str ", "]", "]",
+    "}",
+};
+
+bool Rejects(std::string_view json) {
+    try {
+        Handler ignore;
+        ParseStream(json, ignore);
+    } catch (const ParsingError& e) {
+        return true;
+    }
+    return false;
+}
+
+}  // namespace
+
+TEST(StreamParser, Events) {
+    // Arrange
+    Recorder recorder;
+
+    // Act
+    ParseStream(kJson, recorder);
+
+    // Assert
+    EXPECT_EQ(kEvents, recorder.events);
+}
+
+TEST(StreamParser, SplitAnywhere) {
+    for (size_t i = 0; i <= kJson.size(); i++) {
+        // Arrange
+        Recorder halves, bytes;
+        StreamParser halves_parser(halves), bytes_parser(bytes);
+
+        // Act
+        halves_parser.Feed(kJson.substr(0, i));
+        halves_parser.Feed(kJson.substr(i));
+        halves_parser.Finish();
+        for (char c : kJson) bytes_parser.Feed(std::string_view(&c, 1));
+        bytes_parser.Finish();
+
+        // Assert
+        EXPECT_EQ(kEvents, halves.events);
+        EXPECT_EQ(kEvents, bytes.events);
+    }
+}
+
+TEST(StreamParser, ScalarsAtTheEnd) {
+    // Arrange
+    Recorder recorder;
+    StreamParser parser(recorder);
+
+    // Act
+    // Nothing but the end can tell us the number is over.
+    parser.Feed("12");
+    parser.Feed("34");
+    parser.Finish();
+
+    // Assert
+    EXPECT_EQ(std::vector<std::string>{"num 1234"}, recorder.events);
+}
+
+TEST(StreamParser, ParseFile) {
+    // Arrange
+    // Several times bigger than the pieces it's read in.
+    std::string json = "[";
+    for (int i = 0; i < 50000; i++) {
+        json += std::format("{}\"item {}\"", i > 0 ? ", " : "", i);
+    }
+    json += "]";
+    FILE* f = fmemopen(json.data(), json.size(), "r");
+
+    // Act
+    Recorder recorder;
+    ParseStream(f, recorder);
+    fclose(f);
+
+    // Assert
+    EXPECT_EQ(50002, recorder.events.size());
+    EXPECT_EQ("str item 49999", recorder.events[50000]);
+}
+
+TEST(StreamParser, RejectsMalformedDocuments) {
+    EXPECT_TRUE(Rejects(""));
+    EXPECT_TRUE(Rejects("["));
+    EXPECT_TRUE(Rejects("[1,]"));
+    EXPECT_TRUE(Rejects("[1 2]"));
+    EXPECT_TRUE(Rejects("[1-2]"));
+    EXPECT_TRUE(Rejects("[1}"));
+    EXPECT_TRUE(Rejects("{\"a\" 1}"));
+    EXPECT_TRUE(Rejects("{\"a\": 1,}"));
+    EXPECT_TRUE(Rejects("{1: 1}"));
+    EXPECT_TRUE(Rejects("\"abc"));
+    EXPECT_TRUE(Rejects("\"a\nb\""));
+    EXPECT_TRUE(Rejects(R"("\x")"));
+    EXPECT_TRUE(Rejects(R"("\u12")"));
+    EXPECT_TRUE(Rejects("-"));
+    EXPECT_TRUE(Rejects("1x"));
+    EXPECT_TRUE(Rejects("1e"));
+    EXPECT_TRUE(Rejects("tru"));
+    EXPECT_TRUE(Rejects("nullx"));
+    EXPECT_TRUE(Rejects("1 2"));
+    EXPECT_TRUE(Rejects(std::string(1000, '[') + std::string(1000, ']')));
+    EXPECT_FALSE(Rejects(std::string(100, '[') + std::string(100, ']')));
+}
+
+}  // namespace json
+}  // namespace gabby
@@ -0,0 +1,282 @@
+#include "json/structural.h"
+
+#include <immintrin.h>
+
+#include <bit>
+#include <cstring>
+
+#include "json/json.h"
+#include "json/scan.h"
+
+namespace gabby {
+namespace json {
+
+namespace {
+
+constexpr size_t kBlockSize = 64;
+constexpr uint64_t kOddBits = 0xaaaaaaaaaaaaaaaa;
+
+// one bit per byte of a block, for each kind of byte we care about
+struct Masks {
+    uint64_t quote;
+    uint64_t backslash;
+    uint64_t op;  // {}[]:,
+    uint64_t space;
+    uint64_t control;  // below 0x20
+};
+
+// whitespace and {}[]:, are found by looking each byte up by its low
+// nibble, and checking that it's the byte that was found, like
+// simdjson does. each of the bytes we want has a different low nibble,
+// and or-ing in 0x20 turns [] into {}. the lookups also find 0x0c and
+// 0x1a, which are control characters and are taken out again.
+constexpr char kSpaceTable[16] = {' ', 100, 100, 100, 17,   100, 113, 2,
+                                  100, '\t', '\n', 112, 100, '\r', 100, 100};
+constexpr char kOpTable[16] = {0, 0,   0,   0,   0,   0, 0, 0,
+                               0, 0, ':', '{', ',', '}', 0, 0};
+
+// xors each bit with every bit below it, which turns a mask of quotes
+// into a mask of what's between them
+inline uint64_t PrefixXor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+// what's carried from one block to the next
+struct Carry {
+    uint64_t escaped = 0;  // 1 if the first byte is escaped
+    uint64_t in_string = 0;  // all ones if the block starts in a string
+    uint64_t scalar = 0;  // 1 if the last byte was part of a scalar
+};
+
+// works out which bytes of a block start tokens, from its masks
+inline uint64_t Structurals(const Masks& m, Carry& carry) {
+    // backslashes escape the next byte, unless they're escaped
+    // themselves. subtracting the backslashes that start each run from
+    // the odd bits carries through the run, which tells odd-length runs
+    // from even ones. (from simdjson's json_escape_scanner.)
+    uint64_t potential = m.backslash & ~carry.escaped;
+    uint64_t codes = (((potential << 1) | kOddBits) - potential) ^ kOddBits;
+    uint64_t escaped = codes ^ (m.backslash | carry.escaped);
+    carry.escaped = (codes & m.backslash) >> 63;
+
+    // the opening quote of each string is in it, and the closing one
+    // isn't
+    uint64_t quote = m.quote & ~escaped;
+    uint64_t in_string = PrefixXor(quote) ^ carry.in_string;
+    carry.in_string = uint64_t(int64_t(in_string) >> 63);
+    if (in_string & m.control) throw ParsingError("unterminated string");
+
+    uint64_t outside = ~(in_string | quote);
+    uint64_t scalar = outside & ~(m.op | m.space);
+    uint64_t scalar_start = scalar & ~((scalar << 1) | carry.scalar);
+    carry.scalar = scalar >> 63;
+    return (m.op & outside) | quote | scalar_start;
+}
+
+// appends the offsets of the bits that are set in |bits| to |index|,
+// after the first |n|, and returns how many there are now. they're
+// written eight at a time without checking how many are left, which
+// saves a branch per token, so |index| must have room for 64 more.
+inline size_t Flatten(uint64_t bits, uint32_t base,
+                      std::vector<uint32_t>& index, size_t n) {
+    uint32_t* out = index.data() + n;
+    int count = std::popcount(bits);
+    for (int i = 0; i < count; i += 8) {
+        for (int j = 0; j < 8; j++) {
+            out[i + j] = base + std::countr_zero(bits);
+            bits &= bits - 1;
+        }
+    }
+    return n + count;
+}
+
+// builds the index a block at a time. it's inlined into a function
+// compiled for the same instructions as |Classify|, so that everything
+// here can be inlined in turn.
+template <Masks (*Classify)(const char*)>
+[[gnu::always_inline]] inline std::vector<uint32_t> BuildWith(
+    std::string_view json) {
+    std::vector<uint32_t> index(json.size() / 4 + kBlockSize);
+    size_t n = 0;
+    Carry carry;
+    size_t i = 0;
+    for (; i + kBlockSize <= json.size(); i += kBlockSize) {
+        if (index.size() - n < kBlockSize) index.resize(2 * index.size());
+        n = Flatten(Structurals(Classify(json.data() + i), carry), i, index,
+                    n);
+    }
+    if (i < json.size()) {
+        // pad the last block with whitespace, which doesn't start tokens
+        char block[kBlockSize];
+        std::memset(block, ' ', kBlockSize);
+        std::memcpy(block, json.data() + i, json.size() - i);
+        if (index.size() - n < kBlockSize) index.resize(2 * index.size());
+        n = Flatten(Structurals(Classify(block), carry), i, index, n);
+    }
+    if (carry.in_string) throw ParsingError("unterminated string");
+    index.resize(n);
+    return index;
+}
+
+// only these functions may use the instructions they're compiled for,
+// and only once Supported says the cpu has them
+#pragma GCC push_options
+#pragma GCC target("avx2")
+
+inline __m256i Eq(__m256i v, char c) {
+    return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c));
+}
+
+inline uint64_t Bits(__m256i v) {
+    return uint64_t(uint32_t(_mm256_movemask_epi8(v)));
+}
+
+inline __m256i Table(const char* table) {
+    return _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(table)));
+}
+
+inline Masks ClassifyAvx2(const char* p) {
+    const __m256i space_table = Table(kSpaceTable);
+    const __m256i op_table = Table(kOpTable);
+    Masks m{};
+    for (int half = 0; half < 2; half++) {
+        __m256i v = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(p + 32 * half));
+        __m256i space =
+            _mm256_cmpeq_epi8(v, _mm256_shuffle_epi8(space_table, v));
+        __m256i curly = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        __m256i op =
+            _mm256_cmpeq_epi8(curly, _mm256_shuffle_epi8(op_table, curly));
+        __m256i control = _mm256_cmpeq_epi8(
+            _mm256_min_epu8(v, _mm256_set1_epi8(0x1f)), v);
+        int shift = 32 * half;
+        m.quote |= Bits(Eq(v, '"')) << shift;
+        m.backslash |= Bits(Eq(v, '\\')) << shift;
+        m.op |= Bits(op) << shift;
+        m.space |= Bits(space) << shift;
+        m.control |= Bits(control) << shift;
+    }
+    m.op &= ~m.control;
+    return m;
+}
+
+std::vector<uint32_t> BuildAvx2(std::string_view json) {
+    return BuildWith<ClassifyAvx2>(json);
+}
+
+#pragma GCC pop_options
+#pragma GCC push_options
+#pragma GCC target("sse4.2")
+
+inline __m128i Eq(__m128i v, char c) {
+    return _mm_cmpeq_epi8(v, _mm_set1_epi8(c));
+}
+
+inline uint64_t Bits(__m128i v) {
+    return uint64_t(uint16_t(_mm_movemask_epi8(v)));
+}
+
+inline Masks ClassifySse42(const char* p) {
+    const __m128i space_table =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(kSpaceTable));
+    const __m128i op_table =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(kOpTable));
+    Masks m{};
+    for (int quarter = 0; quarter < 4; quarter++) {
+        auto* at = reinterpret_cast<const __m128i*>(p + 16 * quarter);
+        __m128i v = _mm_loadu_si128(at);
+        __m128i space = _mm_cmpeq_epi8(v, _mm_shuffle_epi8(space_table, v));
+        __m128i curly = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        __m128i op = _mm_cmpeq_epi8(curly, _mm_shuffle_epi8(op_table, curly));
+        __m128i control =
+            _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(0x1f)), v);
+        int shift = 16 * quarter;
+        m.quote |= Bits(Eq(v, '"')) << shift;
+        m.backslash |= Bits(Eq(v, '\\')) << shift;
+        m.op |= Bits(op) << shift;
+        m.space |= Bits(space) << shift;
+        m.control |= Bits(control) << shift;
+    }
+    m.op &= ~m.control;
+    return m;
+}
+
+std::vector<uint32_t> BuildSse42(std::string_view json) {
+    return BuildWith<ClassifySse42>(json);
+}
+
+#pragma GCC pop_options
+
+bool IsOp(char c) {
+    return c == '{' || c == '}' || c == '[' || c == ']' || c == ':' ||
+           c == ',';
+}
+
+std::vector<uint32_t> BuildScalar(std::string_view json) {
+    std::vector<uint32_t> index;
+    index.reserve(json.size() / 4);
+    bool escaped = false, in_string = false, scalar = false;
+    for (uint32_t i = 0; i < json.size(); i++) {
+        char c = json[i];
+        bool is_escaped = escaped;
+        // escapes are followed outside of strings too, as they are by
+        // the simd versions
+        escaped = c == '\\' && !is_escaped;
+        if (c == '"' && !is_escaped) {
+            index.push_back(i);
+            in_string = !in_string;
+            scalar = false;
+        } else if (in_string) {
+            if (static_cast<unsigned char>(c) < 0x20) {
+                throw ParsingError("unterminated string");
+            }
+        } else if (IsOp(c)) {
+            index.push_back(i);
+            scalar = false;
+        } else if (IsSpace(c)) {
+            scalar = false;
+        } else {
+            if (!scalar) index.push_back(i);
+            scalar = true;
+        }
+    }
+    if (in_string) throw ParsingError("unterminated string");
+    return index;
+}
+
+}  // namespace
+
+bool Supported(Isa isa) {
+    switch (isa) {
+        case Isa::Scalar: return true;
+        case Isa::Sse42: return __builtin_cpu_supports("sse4.2");
+        case Isa::Avx2: return __builtin_cpu_supports("avx2");
+    }
+    return false;
+}
+
+Isa BestIsa() {
+    static const Isa best = Supported(Isa::Avx2)    ? Isa::Avx2
+                            : Supported(Isa::Sse42) ? Isa::Sse42
+                                                    : Isa::Scalar;
+    return best;
+}
+
+std::vector<uint32_t> BuildStructuralIndex(std::string_view json, Isa isa) {
+    switch (isa) {
+        case Isa::Avx2: return BuildAvx2(json);
+        case Isa::Sse42: return BuildSse42(json);
+        case Isa::Scalar: break;
+    }
+    return BuildScalar(json);
+}
+
+}  // namespace json
+}  // namespace gabby
@@ -0,0 +1,40 @@
+#ifndef GABBY_JSON_STRUCTURAL_H_
+#define GABBY_JSON_STRUCTURAL_H_
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace gabby {
+namespace json {
+
+// instruction sets that the structural index can be built with
+enum class Isa { Scalar, Sse42, Avx2 };
+
+// whether this cpu supports |isa|
+bool Supported(Isa isa);
+
+// the fastest instruction set this cpu supports
+Isa BestIsa();
+
+// finds where every token in |json| starts, in one pass over it, so
+// that a parser can go from one token to the next without looking at
+// the bytes in between: each of {}[]:, outside of strings, the opening
+// and closing quote of each string, and the first byte of each run of
+// other bytes outside of strings (numbers, true, false, null, and
+// anything that isn't json).
+//
+// with simd, 64 bytes are classified at a time, and which are inside
+// strings is worked out with bit operations on the masks, like
+// simdjson's first stage. the scalar version does the same byte by
+// byte.
+//
+// throws ParsingError if a string isn't terminated, or has a control
+// character in it. |json| must be smaller than 4 GB.
+std::vector<uint32_t> BuildStructuralIndex(std::string_view json,
+                                           Isa isa = BestIsa());
+
+}  // namespace json
+}  // namespace gabby
+
+#endif  // GABBY_JSON_STRUCTURAL_H_
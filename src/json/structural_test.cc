@@ -0,0 +1,80 @@
+#include "json/structural.h"
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "json/json.h"
+#include "test/test.h"
+
+namespace gabby {
+namespace json {
+
+namespace {
+
+// returns the index built with |isa|, or {-1} if it threw
+std::vector<int64_t> Index(const std::string& json, Isa isa) {
+    try {
+        auto index = BuildStructuralIndex(json, isa);
+        return std::vector<int64_t>(index.begin(), index.end());
+    } catch (const ParsingError& e) {
+        return {-1};
+    }
+}
+
+}  // namespace
+
+TEST(StructuralIndex, FindsTokens) {
+    for (Isa isa : {Isa::Scalar, Isa::Sse42, Isa::Avx2}) {
+        if (!Supported(isa)) continue;
+
+        // Arrange
+        std::string json = R"({"a\"[": [12, true], "b": null})";
+
+        // Act
+        auto index = Index(json, isa);
+
+        // Assert
+        // The [ in the string isn't a token, and nor is the escaped
+        // quote.
+        EXPECT_EQ((std::vector<int64_t>{0, 1, 6, 7, 9, 10, 12, 14, 18, 19,
+                                        21, 23, 24, 26, 30}),
+                  index);
+        EXPECT_EQ(std::vector<int64_t>{-1}, Index("[\"abc", isa));
+        EXPECT_EQ(std::vector<int64_t>{-1}, Index("[\"a\nb\"]", isa));
+    }
+}
+
+TEST(StructuralIndex, SimdMatchesScalar) {
+    // Arrange
+    // Random bytes that are mostly the interesting ones, in runs that
+    // cross block boundaries, including long runs of backslashes.
+    std::mt19937 rng(42);
+    const std::string alphabet = "\"\\\\\\{}[]:, \n\t ab1-.\x0c\x1a\xc3\xa9";
+    std::vector<std::string> inputs;
+    for (int i = 0; i < 2000; i++) {
+        std::string s;
+        int len = rng() % 300;
+        while (int(s.size()) < len) {
+            char c = alphabet[rng() % alphabet.size()];
+            s.append(rng() % 8 == 0 ? rng() % 70 : 1, c);
+        }
+        inputs.push_back(s);
+    }
+
+    for (Isa isa : {Isa::Sse42, Isa::Avx2}) {
+        if (!Supported(isa)) continue;
+        // Act
+        int mismatches = 0;
+        for (const std::string& s : inputs) {
+            if (Index(s, isa) != Index(s, Isa::Scalar)) mismatches++;
+        }
+
+        // Assert
+        EXPECT_EQ(0, mismatches);
+    }
+}
+
+}  // namespace json
+}  // namespace gabby
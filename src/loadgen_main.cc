@@ -0,0 +1,142 @@
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include "http/load_generator.h"
+
+namespace gabby {
+namespace {
+
+// a chat completion request, but for the closing brace
+constexpr std::string_view kChatRequest =
+    R"({"model": "gabby-1", "messages": [)"
+    R"({"role": "system", "content": "You are a helpful assistant."},)"
+    R"({"role": "user", "content": "Hello!"}])";
+
+[[noreturn]] void Die(const std::string_view message) {
+    std::cerr << message << std::endl;
+    std::exit(1);
+}
+
+[[noreturn]] void Usage() {
+    Die(R"(usage: gabby_loadgen [flags]
+
+sends requests to a gabby server at a fixed rate, and reports throughput
+and latency percentiles. by default, it posts a chat completion.
+
+  --host HOST               default 127.0.0.1
+  --port PORT               default 8080
+  --unix_socket PATH        connects to a unix socket instead, or with a
+                            leading @, an abstract one
+  --path PATH               default /v1/chat/completions
+  --get                     sends GET requests without a body
+  --body JSON               the request body
+  --body_file FILE          reads the request body from FILE
+  --stream                  asks for the chat completion to be streamed
+  --rate N                  requests per second, default 100
+  --poisson                 sends requests at random, rather than evenly
+  --duration_seconds N      default 10
+  --timeout_seconds N       how long to wait for the last responses
+  --connections N           default 16
+  --threads N               default 1
+  --no_keep_alive           opens a new connection for each request)");
+}
+
+std::string ReadFile(const std::string& name) {
+    std::ifstream in(name);
+    if (!in) Die(std::format("couldn't read {}", name));
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+http::LoadConfig ParseConfig(int argc, char* argv[]) {
+    http::LoadConfig config{
+        .method = http::Method::POST,
+        .path = "/v1/chat/completions",
+        .headers = {{"Content-Type", "application/json"}},
+    };
+    bool stream = false;
+    bool body_set = false;
+    for (int i = 1; i < argc; i++) {
+        std::string_view flag = argv[i];
+        // every flag but these takes an argument
+        if (flag == "--get") {
+            config.method = http::Method::GET;
+            continue;
+        } else if (flag == "--stream") {
+            stream = true;
+            continue;
+        } else if (flag == "--poisson") {
+            config.poisson = true;
+            continue;
+        } else if (flag == "--no_keep_alive") {
+            config.keep_alive = false;
+            continue;
+        } else if (flag == "--help") {
+            Usage();
+        }
+        if (i + 1 == argc) Die(std::format("missing argument for {}", flag));
+        std::string arg = argv[++i];
+        if (flag == "--host") {
+            config.host = arg;
+        } else if (flag == "--port") {
+            config.port = std::stoi(arg);
+        } else if (flag == "--unix_socket") {
+            config.unix_socket = arg;
+        } else if (flag == "--path") {
+            config.path = arg;
+        } else if (flag == "--body") {
+            config.body = arg;
+            body_set = true;
+        } else if (flag == "--body_file") {
+            config.body = ReadFile(arg);
+            body_set = true;
+        } else if (flag == "--rate") {
+            config.rate = std::stod(arg);
+        } else if (flag == "--duration_seconds") {
+            config.duration_millis = std::stod(arg) * 1000;
+        } else if (flag == "--timeout_seconds") {
+            config.timeout_millis = std::stod(arg) * 1000;
+        } else if (flag == "--connections") {
+            config.connections = std::stoi(arg);
+        } else if (flag == "--threads") {
+            config.threads = std::stoi(arg);
+        } else {
+            Die(std::format("invalid argument: {}", flag));
+        }
+    }
+    if (config.method == http::Method::GET) {
+        config.headers.clear();
+        config.body.clear();
+    } else if (!body_set) {
+        config.body = std::string(kChatRequest);
+        if (stream) config.body += R"(, "stream": true)";
+        config.body += "}";
+    }
+    return config;
+}
+
+void Run(int argc, char* argv[]) {
+    http::LoadConfig config = ParseConfig(argc, argv);
+    std::string server = config.unix_socket.empty()
+                             ? std::format("{}:{}", config.host, config.port)
+                             : config.unix_socket;
+    std::cerr << std::format(
+        "sending {} {} requests/s to {}{} for {}s on {} connections\n",
+        to_string(config.method), config.rate, server, config.path,
+        config.duration_millis / 1000.0, config.connections);
+    http::LoadReport report = http::RunLoad(config);
+    std::cout << report;
+    if (report.completed == 0) std::exit(1);
+}
+
+}  // namespace
+}  // namespace gabby
+
+int main(int argc, char* argv[]) { gabby::Run(argc, argv); }
@@ -1,3 +1,6 @@
+#include <pthread.h>
+
+#include <algorithm>
 #include <csignal>
 #include <cstdlib>
 #include <cstring>
@@ -24,6 +27,7 @@ namespace fs = std::filesystem;
 std::ostream& operator<<(std::ostream& os, const Config& config) {
     return os << "{ server_config: " << config.server_config  //
               << ", log_level: " << config.log_level          //
+              << ", log_file: " << config.log_file            //
               << ", model_dir: " << config.model_dir          //
               << " }";
 }
@@ -36,7 +40,8 @@ Config DefaultConfig() {
                 .port = 8080,
                 .read_timeout_millis = 5'000,
                 .write_timeout_millis = 10'000,
-                .worker_threads = std::thread::hardware_concurrency() - 1,
+                .worker_threads =
+                    std::max(1u, std::thread::hardware_concurrency() - 1),
             },
         .model_dir = "",
     };
@@ -69,16 +74,45 @@ Config ParseConfig(int argc, char* argv[]) {
                          &config.server_config.port)) {
         } else if (ParseIntFlag(argc, argv, "--read_timeout_millis", &i,
                                 &config.server_config.read_timeout_millis)) {
+        } else if (ParseIntFlag(argc, argv, "--body_timeout_millis", &i,
+                                &config.server_config.body_timeout_millis)) {
         } else if (ParseIntFlag(argc, argv, "--write_timeout_millis", &i,
                                 &config.server_config.write_timeout_millis)) {
+        } else if (ParseIntFlag(argc, argv, "--max_body_bytes", &i,
+                                &config.server_config.max_body_bytes)) {
+        } else if (ParseIntFlag(argc, argv, "--max_connections", &i,
+                                &config.server_config.max_connections)) {
+        } else if (ParseIntFlag(
+                       argc, argv, "--keep_alive_timeout_millis", &i,
+                       &config.server_config.keep_alive_timeout_millis)) {
+        } else if (ParseIntFlag(
+                       argc, argv, "--max_requests_per_connection", &i,
+                       &config.server_config.max_requests_per_connection)) {
+        } else if (ParseIntFlag(argc, argv, "--max_queued_requests", &i,
+                                &config.server_config.max_queued_requests)) {
+        } else if (ParseIntFlag(argc, argv, "--max_queue_wait_millis", &i,
+                                &config.server_config.max_queue_wait_millis)) {
+        } else if (ParseIntFlag(argc, argv, "--retry_after_seconds", &i,
+                                &config.server_config.retry_after_seconds)) {
+        } else if (ParseIntFlag(argc, argv, "--listeners", &i,
+                                &config.server_config.listeners)) {
+        } else if (std::string path; ParseStrFlag(argc, argv, "--unix_socket",
+                                                  &i, &path)) {
+            config.server_config.unix_sockets.push_back(path);
+        } else if (strcmp(argv[i], "--pin_threads") == 0) {
+            config.server_config.pin_threads = true;
         } else if (strcmp(argv[i], "--info") == 0) {
             config.log_level = LogLevel::INFO;
         } else if (strcmp(argv[i], "--warn") == 0) {
             config.log_level = LogLevel::WARN;
         } else if (strcmp(argv[i], "--debug") == 0) {
             config.log_level = LogLevel::DEBUG;
+        } else if (ParseIntFlag(argc, argv, "--drain_timeout_millis", &i,
+                                &config.server_config.drain_timeout_millis)) {
         } else if (ParseIntFlag(argc, argv, "--workers", &i,
                                 &config.server_config.worker_threads)) {
+        } else if (ParseStrFlag(argc, argv, "--log_file", &i,
+                                &config.log_file)) {
         } else if (ParseStrFlag(argc, argv, "--model-dir", &i,
                                 &config.model_dir)) {
         } else {
@@ -91,8 +125,6 @@ Config ParseConfig(int argc, char* argv[]) {
     return config;
 }
 
-static InferenceService* service = nullptr;
-
 constexpr const char* signame(int signal) {
     switch (signal) {
         case SIGINT: return "SIGINT";
@@ -101,21 +133,41 @@ constexpr const char* signame(int signal) {
     }
 }
 
-void shutdown(int signal) {
-    LOG(INFO) << "received " << signame(signal);
-    service->Stop();
+// handles |signals| on a thread of its own, outside of signal handler
+// context. SIGTERM drains the service, and SIGINT stops it right away.
+void HandleSignals(sigset_t signals, InferenceService* service) {
+    while (true) {
+        int signal;
+        if (sigwait(&signals, &signal) != 0) continue;
+        LOG(INFO) << "received " << signame(signal);
+        if (signal == SIGTERM) {
+            service->Drain();
+        } else {
+            service->Stop();
+            return;
+        }
+    }
 }
 
 void Run(int argc, char* argv[]) {
     auto config = ParseConfig(argc, argv);
+    // every thread we start inherits this, so that the signals are only
+    // ever delivered to sigwait
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
     SetGlobalLogLevel(config.log_level);
+    StartAsyncLogging(config.log_file);
     LOG(INFO) << "server config: " << config;
-    service = new InferenceService(config);
-    std::signal(SIGINT, shutdown);
-    std::signal(SIGTERM, shutdown);
+    auto* service = new InferenceService(config);
+    std::thread(HandleSignals, signals, service).detach();
     service->Start();
     service->Wait();
     LOG(INFO) << "exiting";
+    StopAsyncLogging();
 }
 
 }  // namespace
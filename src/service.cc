@@ -1,15 +1,19 @@
 #include "service.h"
 
+#include <algorithm>
+#include <chrono>
 #include <cstdio>
 #include <format>
 #include <string>
-#include <unordered_set>
+#include <utility>
+#include <vector>
 
+#include "chat_completions.h"
 #include "http/router.h"
 #include "inference/config.h"
-#include "json/json.h"
-#include "json/parser.h"
+#include "json/bind.h"
 #include "utils/logging.h"
+#include "utils/metrics.h"
 
 namespace gabby {
 
@@ -25,94 +29,125 @@ std::string ReadAll(FILE* stream) {
     return data;
 }
 
-const std::string& GetHeader(const http::Request& req, const std::string& key) {
-    auto it = req.headers.find(key);
-    if (it == req.headers.end()) {
-        throw http::BadRequestException("missing header: " + key);
-    }
-    return it->second;
-}
-
-int GetIntHeader(const http::Request& req, const std::string& key) {
-    const std::string& value = GetHeader(req, key);
-    try {
-        return std::stoi(value);
-    } catch (...) {
-        throw http::BadRequestException(
-            std::format("invalid value for header {}: {}", key, value));
-    }
-}
-
-void CheckMethod(const std::unordered_set<http::Method>& supported,
-                 http::Method method) {
-    if (!supported.contains(method)) {
-        throw http::NotFoundError();
-    }
-}
-
-inference::Message FindMessageForRole(const std::string_view role,
-                                      json::ArrayValue& msgs) {
-    auto it =
-        std::find_if(msgs.begin(), msgs.end(), [role](json::ValuePtr val) {
-            return *val->as_object().at("role")->as_string() == role;
-        });
+// takes the first message with |role| out of |msgs|
+inference::Message TakeMessageForRole(const std::string_view role,
+                                      std::vector<ChatMessage>& msgs) {
+    auto it = std::find_if(
+        msgs.begin(), msgs.end(),
+        [role](const ChatMessage& msg) { return msg.role == role; });
     if (it == msgs.end()) {
         throw http::BadRequestException(std::format("role {} not found", role));
     }
-    auto msg = (*it)->as_object();
     return inference::Message{
-        .role = *msg.at("role")->as_string(),
-        .content = *msg.at("content")->as_string(),
+        .role = std::move(it->role),
+        .content = std::move(it->content),
     };
 }
 
-inference::Request ExtractRequest(json::ValuePtr json_request) {
-    auto msgs = json_request->as_object().at("messages")->as_array();
-    inference::Message system = FindMessageForRole("system", msgs);
-    inference::Message user = FindMessageForRole("user", msgs);
+inference::Request ExtractRequest(ChatCompletionRequest& request) {
+    inference::Message system =
+        TakeMessageForRole("system", request.messages);
+    inference::Message user = TakeMessageForRole("user", request.messages);
     return inference::Request{
-        .system_message = system,
-        .user_message = user,
+        .system_message = std::move(system),
+        .user_message = std::move(user),
     };
 }
 
-json::ValuePtr StubResponse() {
-    return json::Parse(R"(
-    {
-        "id": "gabby-completion-123",
-        "object": "chat.completion",
-        "created": 1111111111,
-        "model": "gabby-model",
-        "system_fingerprint": "fp_1111111111",
-        "choices": [
-        ],
-        "usage": {
-            "prompt_tokens": 1,
-            "completion_tokens": 1,
-            "total_tokens": 1,
-            "completion_tokens_details": {
-                "reasoning_tokens": 1,
-                "accepted_prediction_tokens": 0,
-                "rejected_prediction_tokens": 0
-            }
-        }
-    }
-)");
+ChatCompletionResponse MakeResponse(inference::Message answer) {
+    ChatCompletionResponse response;
+    response.choices.push_back(ChatCompletionChoice{
+        .message =
+            ChatMessage{
+                .role = std::move(answer.role),
+                .content = std::move(answer.content),
+            },
+    });
+    return response;
+}
+
+// the service's metrics, registered on first use
+struct ServiceMetrics {
+    Counter& tokens = GlobalMetrics().counter("generated_tokens_total",
+                                              "tokens generated");
+    Histogram& duration = GlobalMetrics().histogram(
+        "generation_duration_microseconds",
+        "how long generating a whole response took");
+    Histogram& first_token = GlobalMetrics().histogram(
+        "time_to_first_token_microseconds",
+        "how long the first token of a response took");
+    Histogram& inter_token = GlobalMetrics().histogram(
+        "inter_token_latency_microseconds",
+        "the time between consecutive tokens of a response");
+};
+
+ServiceMetrics& Stats() {
+    static ServiceMetrics* metrics = new ServiceMetrics();
+    return *metrics;
+}
+
+int64_t MicrosSince(std::chrono::steady_clock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - t)
+        .count();
 }
 
-json::ValuePtr MakeResponse(const inference::Message& answer) {
-    auto response = StubResponse();
-    auto choice = json::Value::Object({
-        {"index", json::Value::Number(0)},
-        {"logprobs", json::Value::Nil()},
-        {"finish_reason", json::Value::String("stop")},
-        {"message", json::Value::Object({
-                        {"role", json::Value::String(answer.role)},
-                        {"content", json::Value::String(answer.content)},
-                    })},
+// generates a response to |question| with |generator|, and records how
+// long it took
+inference::Message Generate(
+    inference::Generator& generator, const inference::Request& question,
+    const inference::Generator::TokenCallback& on_token) {
+    auto start = std::chrono::steady_clock::now();
+    auto last = start;
+    int64_t tokens = 0;
+    inference::Message answer = generator.Generate(
+        question, [&](std::string_view token) {
+            if (tokens++ == 0) Stats().first_token.Record(MicrosSince(start));
+            else Stats().inter_token.Record(MicrosSince(last));
+            last = std::chrono::steady_clock::now();
+            on_token(token);
+        });
+    Stats().tokens.Add(tokens);
+    Stats().duration.Record(MicrosSince(start));
+    return answer;
+}
+
+// writes |chunk| as a server-sent event and sends it right away.
+// |buf| is reused from one event to the next.
+void SendEvent(http::ResponseWriter& resp, std::string& buf,
+               const ChatCompletionChunk& chunk) {
+    buf = "data: ";
+    json::Write(buf, chunk);
+    buf += "\n\n";
+    resp.WriteData(buf);
+    resp.Flush();
+}
+
+// streams the response as server-sent events, one chunk per token, in
+// the same format as the openai api
+void StreamCompletion(inference::Generator& generator,
+                      const inference::Request& question,
+                      http::ResponseWriter& resp) {
+    resp.WriteStatus(http::StatusCode::OK);
+    resp.WriteHeader("Content-Type", "text/event-stream");
+    resp.WriteHeader("Cache-Control", "no-cache");
+
+    // the same chunk is sent each time, with a different delta
+    std::string buf;
+    ChatCompletionChunk chunk;
+    chunk.choices.resize(1);
+    ChatCompletionChunkChoice& choice = chunk.choices[0];
+    choice.delta = ChatDelta{.role = "assistant", .content = ""};
+    SendEvent(resp, buf, chunk);
+    Generate(generator, question, [&](std::string_view token) {
+        choice.delta = ChatDelta{.content = token};
+        SendEvent(resp, buf, chunk);
     });
-    response->as_object().at("choices")->as_array().push_back(choice);
-    return response;
+    choice.delta = ChatDelta{};
+    choice.finish_reason = "stop";
+    SendEvent(resp, buf, chunk);
+    resp.WriteData("data: [DONE]\n\n");
+    resp.Flush();
 }
 
 }  // namespace
@@ -129,38 +164,61 @@ InferenceService::InferenceService(
     : server_(std::move(server)), generator_(std::move(generator)) {}
 
 http::Handler InferenceService::HealthCheck() {
+    return [this](http::Request& req, http::ResponseWriter& resp) {
+        // tells load balancers to stop sending us requests
+        resp.WriteStatus(server_->draining()
+                             ? http::StatusCode::ServiceUnavailable
+                             : http::StatusCode::OK);
+    };
+};
+
+http::Handler InferenceService::Statusz() {
     return [](http::Request& req, http::ResponseWriter& resp) {
+        std::string_view path = req.path;
+        std::string_view query =
+            path.substr(std::min(path.find('?'), path.size()));
+        bool prometheus =
+            query.find("format=prometheus") != std::string_view::npos;
         resp.WriteStatus(http::StatusCode::OK);
+        resp.WriteHeader("Content-Type", prometheus
+                                             ? "text/plain; version=0.0.4"
+                                             : "text/plain; charset=utf-8");
+        resp.WriteData(prometheus ? GlobalMetrics().Prometheus()
+                                  : GlobalMetrics().Text());
     };
-};
+}
 
 http::Handler InferenceService::ChatCompletions() {
     return [this](http::Request& req, http::ResponseWriter& resp) {
-        // TODO: lift this into http::Router
-        CheckMethod({http::Method::POST}, req.method);
-
-        // TODO: read the full body when content-length is specified,
-        // even if we don't use it, and lift this into http::Server
-        int content_length = GetIntHeader(req, "Content-Length");
-
-        auto json_req = json::Parse(req.stream, content_length);
-        LOG(DEBUG) << "completion request: " << *json_req;
+        if (req.body.empty()) {
+            throw http::BadRequestException("missing request body");
+        }
+        LOG(DEBUG) << "completion request: " << req.body;
+        auto request = json::Read<ChatCompletionRequest>(req.body);
 
-        inference::Request question = ExtractRequest(json_req);
-        inference::Message answer = generator_->Generate(question);
-        auto json_resp = MakeResponse(answer);
-        LOG(DEBUG) << "completion response: " << *json_resp;
+        inference::Request question = ExtractRequest(request);
+        if (request.stream) {
+            return StreamCompletion(*generator_, question, resp);
+        }
+        inference::Message answer =
+            Generate(*generator_, question, [](std::string_view) {});
+        std::string body;
+        json::Write(body, MakeResponse(std::move(answer)));
+        LOG(DEBUG) << "completion response: " << body;
 
         resp.WriteStatus(http::StatusCode::OK);
-        resp.WriteData(to_string(*json_resp));
+        resp.WriteHeader("Content-Type", "application/json");
+        resp.WriteData(body);
     };
 }
 
 void InferenceService::Start() {
     //
     server_->Start(http::Router::builder()
-                       .route("/healthz", HealthCheck())
-                       .route("/v1/chat/completions", ChatCompletions())
+                       .route(http::Method::GET, "/healthz", HealthCheck())
+                       .route(http::Method::GET, "/statusz", Statusz())
+                       .route(http::Method::POST, "/v1/chat/completions",
+                              ChatCompletions())
                        .build());
 }
 
@@ -174,4 +232,9 @@ void InferenceService::Stop() {
     server_->Stop();
 }
 
+void InferenceService::Drain() {
+    //
+    server_->Drain();
+}
+
 }  // namespace gabby
@@ -12,6 +12,8 @@ namespace gabby {
 
 struct Config {
     LogLevel log_level;
+    // logs go to stderr if empty
+    std::string log_file;
     http::ServerConfig server_config;
     std::string model_dir;
 };
@@ -27,11 +29,17 @@ public:
     void Start();
     void Wait();
     void Stop();
+    // reports unhealthy while the server finishes what it's doing. see
+    // HttpServer::Drain.
+    void Drain();
 
     int port() const { return server_->port(); }
 
 private:
     http::Handler HealthCheck();
+    // every metric in the process, as text, or for prometheus with
+    // ?format=prometheus
+    http::Handler Statusz();
     http::Handler ChatCompletions();
 
     Config config_;
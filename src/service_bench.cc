@@ -0,0 +1,142 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <new>
+#include <string_view>
+
+#include "http/server.h"
+#include "service.h"
+#include "test/bench.h"
+#include "utils/logging.h"
+
+// counts every allocation in the process, so that the benchmarks here
+// can report how many the server makes per request. this applies to the
+// whole benchmark binary, but a relaxed increment is too cheap to skew
+// the others.
+namespace {
+std::atomic<int64_t> allocations = 0;
+}  // namespace
+
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace gabby {
+
+namespace {
+
+constexpr std::string_view kHealthRequest =
+    "GET /healthz HTTP/1.1\r\n"
+    "Host: localhost:8080\r\n"
+    "User-Agent: gabby-bench\r\n"
+    "Accept: */*\r\n"
+    "\r\n";
+
+constexpr std::string_view kChatRequest =
+    "POST /v1/chat/completions HTTP/1.1\r\n"
+    "Host: localhost:8080\r\n"
+    "User-Agent: gabby-bench\r\n"
+    "Accept: application/json\r\n"
+    "Content-Type: application/json\r\n"
+    "Content-Length: 135\r\n"
+    "\r\n"
+    R"({"model": "gabby-1", "messages": [)"
+    R"({"role": "system", "content": "You are a helpful assistant."},)"
+    R"({"role": "user", "content": "Hello!"}]})";
+
+class EchoGenerator : public inference::Generator {
+public:
+    using Generator::Generate;
+    inference::Message Generate(const inference::Request& req,
+                                const TokenCallback& on_token) override {
+        return inference::Message{
+            .role = "assistant",
+            .content = req.user_message.content,
+        };
+    }
+};
+
+int Connect(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        throw SystemError(errno);
+    }
+    return fd;
+}
+
+// reads one response with a Content-Length from |fd| without
+// allocating, so that only the server's allocations are counted
+void ReadResponse(int fd) {
+    char buf[16 * 1024];
+    size_t len = 0;
+    while (true) {
+        ssize_t n = ::recv(fd, buf + len, sizeof(buf) - len, 0);
+        if (n <= 0) throw SystemError(errno);
+        len += n;
+        std::string_view resp(buf, len);
+        size_t head_end = resp.find("\r\n\r\n");
+        if (head_end == std::string_view::npos) continue;
+        size_t body_len = 0;
+        size_t pos = resp.find("Content-Length: ");
+        if (pos != std::string_view::npos && pos < head_end) {
+            const char* from = buf + pos + strlen("Content-Length: ");
+            std::from_chars(from, buf + head_end, body_len);
+        }
+        if (len >= head_end + 4 + body_len) return;
+    }
+}
+
+void RunRequests(BenchmarkState& state, std::string_view request) {
+    InferenceService service(
+        std::make_unique<http::HttpServer>(http::ServerConfig{
+            .worker_threads = 1,
+            .max_requests_per_connection = std::numeric_limits<int>::max(),
+        }),
+        std::make_unique<EchoGenerator>());
+    service.Start();
+    int fd = Connect(service.port());
+    // warm up the connection, so its buffers are already allocated
+    for (int i = 0; i < 10; i++) {
+        ::send(fd, request.data(), request.size(), MSG_NOSIGNAL);
+        ReadResponse(fd);
+    }
+
+    int64_t before = allocations.load();
+    while (state.KeepRunning()) {
+        ::send(fd, request.data(), request.size(), MSG_NOSIGNAL);
+        ReadResponse(fd);
+    }
+    int64_t after = allocations.load();
+    state.counters["allocs/request"] =
+        double(after - before) / state.iterations();
+
+    close(fd);
+    service.Stop();
+    service.Wait();
+}
+
+}  // namespace
+
+BENCHMARK(InferenceService, HealthCheck) { RunRequests(state, kHealthRequest); }
+
+BENCHMARK(InferenceService, ChatCompletion) {
+    RunRequests(state, kChatRequest);
+}
+
+}  // namespace gabby
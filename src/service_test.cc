@@ -1,5 +1,9 @@
 #include "service.h"
 
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
 #include "http/test_client.h"
 #include "http/types.h"
 #include "json/json.h"
@@ -12,12 +16,18 @@ http::ServerConfig kTestServerConfig = http::ServerConfig{
     .port = 0,
     .read_timeout_millis = 5'000,
     .write_timeout_millis = 10'000,
-    .worker_threads = std::thread::hardware_concurrency() - 1,
+    .worker_threads = std::max(1u, std::thread::hardware_concurrency() - 1),
 };
 
 class SimpleGenerator : public inference::Generator {
 public:
-    inference::Message Generate(const inference::Request& req) override {
+    using Generator::Generate;
+    inference::Message Generate(const inference::Request& req,
+                                const TokenCallback& on_token) override {
+        for (std::string_view token : {"this", " is", " a", " test",
+                                       " response"}) {
+            on_token(token);
+        }
         return inference::Message{
             .role = "assistant",
             .content = "this is a test response",
@@ -25,6 +35,15 @@ public:
     }
 };
 
+int CountSubstr(const std::string& haystack, const std::string& needle) {
+    int count = 0;
+    for (size_t pos = 0; (pos = haystack.find(needle, pos)) != std::string::npos;
+         pos += needle.size()) {
+        count++;
+    }
+    return count;
+}
+
 TEST(Service, ChatCompletion) {
     InferenceService service(
         std::make_unique<http::HttpServer>(kTestServerConfig),
@@ -56,4 +75,94 @@ TEST(Service, ChatCompletion) {
     service.Wait();
 }
 
+TEST(Service, StreamingChatCompletion) {
+    // Arrange
+    InferenceService service(
+        std::make_unique<http::HttpServer>(kTestServerConfig),
+        std::unique_ptr<inference::Generator>(new SimpleGenerator));
+    service.Start();
+
+    // Act
+    std::string result = http::Call(service.port(), http::Method::POST,
+                                    "/v1/chat/completions", {}, R"({
+        "model": "gabby-1",
+        "stream": true,
+        "messages": [{
+            "role": "system",
+            "content": "You are a helpful assistant."
+        },{
+            "role": "user",
+            "content": "Hello!"
+        }]
+    })");
+
+    // Assert
+    // There should be one event for the role, one per token, one to
+    // finish, and then the terminator.
+    EXPECT_SUBSTR(result, "Content-Type: text/event-stream");
+    EXPECT_SUBSTR(result, "Transfer-Encoding: chunked");
+    EXPECT_EQ(7, CountSubstr(result, "\"chat.completion.chunk\""));
+    EXPECT_SUBSTR(result, R"("content": " test")");
+    EXPECT_SUBSTR(result, R"("finish_reason": "stop")");
+    EXPECT_TRUE(result.ends_with("data: [DONE]\n\n\r\n0\r\n\r\n"));
+
+    service.Stop();
+    service.Wait();
+}
+
+TEST(Service, UnhealthyWhileDraining) {
+    // Arrange
+    InferenceService service(
+        std::make_unique<http::HttpServer>(kTestServerConfig),
+        std::unique_ptr<inference::Generator>(new SimpleGenerator));
+    service.Start();
+    auto healthy = http::Call(service.port(), http::Method::GET, "/healthz");
+    // Idle persistent connections are closed when the drain starts, so
+    // the check comes on a connection that hasn't sent anything yet.
+    http::UnbufferedClientSocket sock(service.port());
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    // Act
+    service.Drain();
+    sock.Write("GET /healthz HTTP/1.1\r\n\r\n");
+    auto draining = sock.ReadAll();
+    service.Wait();
+
+    // Assert
+    EXPECT_SUBSTR(healthy, "HTTP/1.1 200 OK");
+    EXPECT_SUBSTR(draining, "HTTP/1.1 503 Service Unavailable");
+    EXPECT_SUBSTR(draining, "Connection: close");
+}
+
+TEST(Service, Statusz) {
+    // Arrange
+    InferenceService service(
+        std::make_unique<http::HttpServer>(kTestServerConfig),
+        std::unique_ptr<inference::Generator>(new SimpleGenerator));
+    service.Start();
+    http::UnbufferedClientSocket sock(service.port());
+    sock.Write("GET /healthz HTTP/1.1\r\n\r\n");
+    sock.Read();
+
+    // Act
+    sock.Write("GET /statusz HTTP/1.1\r\nConnection: close\r\n\r\n");
+    auto text = sock.ReadAll();
+    http::UnbufferedClientSocket sock2(service.port());
+    sock2.Write(
+        "GET /statusz?format=prometheus HTTP/1.1\r\n"
+        "Connection: close\r\n\r\n");
+    auto prometheus = sock2.ReadAll();
+
+    // Assert
+    EXPECT_SUBSTR(text, "HTTP/1.1 200 OK");
+    EXPECT_SUBSTR(text, "http_requests_total (counter)");
+    EXPECT_SUBSTR(text, "route=\"/healthz\"");
+    EXPECT_SUBSTR(prometheus, "# TYPE http_requests_total counter");
+    EXPECT_SUBSTR(prometheus,
+                  "http_requests_total{route=\"/healthz\",status=\"200\"}");
+
+    service.Stop();
+    service.Wait();
+}
+
 }  // namespace gabby
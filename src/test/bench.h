@@ -0,0 +1,118 @@
+#ifndef GABBY_BENCH_H_
+#define GABBY_BENCH_H_
+
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace gabby {
+
+// keeps the compiler from optimizing away |value|
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+class BenchmarkState {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // returns true until the benchmark has run for long enough. usage:
+    //
+    //     while (state.KeepRunning()) { ... }
+    bool KeepRunning() {
+        if (iterations_ == 0) start_ = Clock::now();
+        if (iterations_ % check_every_ == 0 && iterations_ > 0) {
+            elapsed_ = Clock::now() - start_;
+            if (elapsed_ >= kMinTime) return false;
+            if (check_every_ < kMaxCheckEvery) check_every_ *= 2;
+        }
+        iterations_++;
+        return true;
+    }
+
+    // the number of bytes processed by each iteration, to report
+    // throughput
+    void SetBytesPerIteration(int64_t bytes) { bytes_ = bytes; }
+
+    // extra per-iteration values to report
+    std::map<std::string, double> counters;
+
+    int64_t iterations() const { return iterations_; }
+    double nanos_per_iteration() const {
+        return std::chrono::duration<double, std::nano>(elapsed_).count() /
+               iterations_;
+    }
+    double gigabytes_per_second() const {
+        return bytes_ / nanos_per_iteration();
+    }
+    int64_t bytes_per_iteration() const { return bytes_; }
+
+private:
+    static constexpr auto kMinTime = std::chrono::milliseconds(500);
+    static constexpr int64_t kMaxCheckEvery = 1024;
+
+    int64_t iterations_ = 0;
+    int64_t check_every_ = 1;
+    int64_t bytes_ = 0;
+    Clock::time_point start_;
+    Clock::duration elapsed_{};
+};
+
+class Benchmark {
+public:
+    virtual ~Benchmark() {}
+    virtual const std::string& suite() = 0;
+    virtual const std::string& name() = 0;
+    virtual void Run(BenchmarkState& state) = 0;
+
+    void RunAndReport() {
+        BenchmarkState state;
+        Run(state);
+        std::string line = std::format(
+            "BENCH: {}:{}: {} iterations, {:.1f} ns/op", suite(), name(),
+            state.iterations(), state.nanos_per_iteration());
+        if (state.bytes_per_iteration() > 0) {
+            line += std::format(", {:.3f} GB/s", state.gigabytes_per_second());
+        }
+        for (const auto& [key, value] : state.counters) {
+            line += std::format(", {:.2f} {}", value, key);
+        }
+        std::cout << line << std::endl;
+    }
+};
+
+extern std::vector<Benchmark*>* kBenchmarks;
+
+#define BENCH_CONCAT_HELPER(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_HELPER(a, b)
+
+#define BENCH_CLASS(Suite, Case) BENCH_CONCAT(BENCH_CONCAT(Bench, Suite), Case)
+
+#define BENCHMARK(Suite, Case)                                      \
+    class BENCH_CLASS(Suite, Case) : public Benchmark {             \
+    public:                                                         \
+        BENCH_CLASS(Suite, Case)() {                                \
+            if (kBenchmarks == nullptr)                             \
+                kBenchmarks = new std::vector<Benchmark*>;          \
+            kBenchmarks->push_back(this);                           \
+        }                                                           \
+        void Run(BenchmarkState& state) override;                   \
+        const std::string& suite() override { return suite_; }      \
+        const std::string& name() override { return case_; }       \
+                                                                    \
+    private:                                                        \
+        std::string suite_ = #Suite;                                \
+        std::string case_ = #Case;                                  \
+    };                                                              \
+    BENCH_CLASS(Suite, Case)                                        \
+    BENCH_CONCAT(register_, BENCH_CLASS(Suite, Case));              \
+    void BENCH_CLASS(Suite, Case)::Run(BenchmarkState& state)
+
+}  // namespace gabby
+
+#endif  // GABBY_BENCH_H_
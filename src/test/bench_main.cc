@@ -0,0 +1,24 @@
+#include <cstring>
+#include <iostream>
+
+#include "test/bench.h"
+
+namespace gabby {
+
+std::vector<Benchmark*>* kBenchmarks = nullptr;
+
+}  // namespace gabby
+
+// usage: gabby_bench [filter]
+//
+// runs every benchmark whose "Suite:Case" name contains |filter|
+int main(int argc, char* argv[]) {
+    const char* filter = argc > 1 ? argv[1] : "";
+    if (gabby::kBenchmarks == nullptr) return EXIT_SUCCESS;
+    for (auto* bench : *gabby::kBenchmarks) {
+        std::string name = bench->suite() + ":" + bench->name();
+        if (name.find(filter) == std::string::npos) continue;
+        bench->RunAndReport();
+    }
+    return EXIT_SUCCESS;
+}
@@ -115,7 +115,7 @@ extern std::vector<TestCase*>* kTestCases;
     }
 
 #define EXPECT_SUBSTR(haystack, needle) \
-    EXPECT_TRUE((haystack).find(needle) >= 0)
+    EXPECT_TRUE((haystack).find(needle) != std::string::npos)
 
 }  // namespace gabby
 
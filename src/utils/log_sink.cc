@@ -0,0 +1,165 @@
+#include "utils/log_sink.h"
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <format>
+
+namespace gabby {
+
+namespace {
+
+// how long the background thread sleeps when there's nothing to write.
+// it backs off while idle so it doesn't spin, and starts over as soon
+// as there's more.
+constexpr auto kMinIdleSleep = std::chrono::milliseconds(1);
+constexpr auto kMaxIdleSleep = std::chrono::milliseconds(64);
+
+constexpr int kMaxBuffers = 64;
+
+std::atomic<uint64_t> next_sink_id = 1;
+
+// the ring the current thread writes to, and the sink it belongs to
+struct ThreadRing {
+    uint64_t sink_id = 0;
+    std::shared_ptr<LogRing> ring;
+
+    ~ThreadRing() {
+        if (ring != nullptr) ring->closed = true;
+    }
+};
+
+thread_local ThreadRing thread_ring;
+
+// writes all of |iov| to |fd|, giving up on errors
+void WriteAll(int fd, struct iovec* iov, int n) {
+    while (n > 0) {
+        ssize_t written = ::writev(fd, iov, n);
+        if (written < 0 && errno == EINTR) continue;
+        if (written < 0) return;
+        for (; n > 0 && size_t(written) >= iov->iov_len; iov++, n--) {
+            written -= iov->iov_len;
+        }
+        if (n > 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + written;
+            iov->iov_len -= written;
+        }
+    }
+}
+
+}  // namespace
+
+bool LogRing::Push(std::string_view line) {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    uint64_t tail = tail_.load(std::memory_order_acquire);
+    if (kSize - (head - tail) < line.size()) return false;
+    size_t pos = head % kSize;
+    size_t first = std::min(line.size(), kSize - pos);
+    std::memcpy(data_.get() + pos, line.data(), first);
+    std::memcpy(data_.get(), line.data() + first, line.size() - first);
+    head_.store(head + line.size(), std::memory_order_release);
+    return true;
+}
+
+std::pair<std::string_view, std::string_view> LogRing::Peek() const {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    uint64_t head = head_.load(std::memory_order_acquire);
+    size_t pos = tail % kSize;
+    size_t len = head - tail;
+    size_t first = std::min(len, kSize - pos);
+    return {std::string_view(data_.get() + pos, first),
+            std::string_view(data_.get(), len - first)};
+}
+
+LogSink::LogSink(int fd)
+    : fd_(fd), id_(next_sink_id.fetch_add(1)), thread_(&LogSink::Run, this) {}
+
+LogSink::~LogSink() {
+    done_ = true;
+    thread_.join();
+    Drain();
+}
+
+LogRing& LogSink::ThreadRing() {
+    if (thread_ring.sink_id != id_) {
+        if (thread_ring.ring != nullptr) thread_ring.ring->closed = true;
+        auto ring = std::make_shared<LogRing>();
+        {
+            std::lock_guard guard(rings_mux_);
+            rings_.push_back(ring);
+        }
+        thread_ring.sink_id = id_;
+        thread_ring.ring = std::move(ring);
+    }
+    return *thread_ring.ring;
+}
+
+void LogSink::Write(std::string_view line) {
+    LogRing& ring = ThreadRing();
+    if (!ring.Push(line)) {
+        ring.dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void LogSink::Flush() { Drain(); }
+
+size_t LogSink::Drain() {
+    std::lock_guard drain_guard(drain_mux_);
+    std::vector<std::shared_ptr<LogRing>> rings;
+    {
+        std::lock_guard guard(rings_mux_);
+        // rings whose threads have exited can go once they're empty,
+        // since nothing more can be pushed to them
+        std::erase_if(rings_, [](const std::shared_ptr<LogRing>& ring) {
+            return ring->closed && ring->empty();
+        });
+        rings = rings_;
+    }
+
+    size_t total = 0;
+    uint64_t dropped = 0;
+    for (size_t i = 0; i < rings.size();) {
+        // two pieces per ring
+        struct iovec iov[kMaxBuffers];
+        size_t sizes[kMaxBuffers / 2];
+        int n = 0;
+        for (; i < rings.size() && n < kMaxBuffers; i++) {
+            auto [first, second] = rings[i]->Peek();
+            iov[n] = {const_cast<char*>(first.data()), first.size()};
+            iov[n + 1] = {const_cast<char*>(second.data()), second.size()};
+            sizes[n / 2] = first.size() + second.size();
+            n += 2;
+            dropped += rings[i]->dropped.exchange(0);
+        }
+        WriteAll(fd_, iov, n);
+        for (int j = 0; j < n / 2; j++) {
+            rings[i - n / 2 + j]->Consume(sizes[j]);
+            total += sizes[j];
+        }
+    }
+    if (dropped > 0) {
+        std::string note = std::format("{} log lines dropped\n", dropped);
+        struct iovec iov = {note.data(), note.size()};
+        WriteAll(fd_, &iov, 1);
+        dropped_ += dropped;
+    }
+    return total;
+}
+
+void LogSink::Run() {
+    auto sleep = kMinIdleSleep;
+    while (!done_) {
+        if (Drain() > 0) {
+            sleep = kMinIdleSleep;
+            continue;
+        }
+        std::this_thread::sleep_for(sleep);
+        sleep = std::min(sleep * 2, kMaxIdleSleep);
+    }
+}
+
+}  // namespace gabby
@@ -0,0 +1,105 @@
+#ifndef GABBY_UTILS_LOG_SINK_H_
+#define GABBY_UTILS_LOG_SINK_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace gabby {
+
+// a lock-free ring of bytes with a single producer and a single
+// consumer. pushes are all or nothing, so whole lines are never split.
+class LogRing {
+public:
+    static constexpr size_t kSize = 128 * 1024;
+
+    LogRing() : data_(new char[kSize]) {}
+
+    // appends |line| if there's room for all of it. producer only.
+    bool Push(std::string_view line);
+
+    // returns the bytes pushed but not yet consumed, in at most two
+    // pieces since they may wrap around. consumer only.
+    std::pair<std::string_view, std::string_view> Peek() const;
+
+    // discards the first |n| bytes returned by Peek. consumer only.
+    void Consume(size_t n) {
+        tail_.store(tail_.load(std::memory_order_relaxed) + n,
+                    std::memory_order_release);
+    }
+
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) ==
+               tail_.load(std::memory_order_relaxed);
+    }
+
+    // lines that didn't fit, and were dropped, since the consumer last
+    // took the count
+    std::atomic<uint64_t> dropped = 0;
+
+    // set once the producer has exited, so the ring can be freed once
+    // it's been drained
+    std::atomic<bool> closed = false;
+
+private:
+    std::unique_ptr<char[]> data_;
+    // in bytes since the ring was created, so that they never wrap
+    alignas(64) std::atomic<uint64_t> head_ = 0;  // written by the producer
+    alignas(64) std::atomic<uint64_t> tail_ = 0;  // written by the consumer
+};
+
+// writes log lines to a file descriptor on a background thread. each
+// thread that logs gets its own ring, so writing a line never takes a
+// lock or makes a syscall. if a thread logs faster than the lines can
+// be written, the lines that don't fit are dropped and counted.
+class LogSink {
+public:
+    // |fd| must outlive the constructed instance
+    explicit LogSink(int fd);
+
+    // writes out everything logged so far
+    ~LogSink();
+
+    LogSink(const LogSink&) = delete;
+    LogSink& operator=(const LogSink&) = delete;
+
+    // queues |line|, which should end with a newline. thread-safe.
+    void Write(std::string_view line);
+
+    // writes out everything queued so far before returning. thread-safe.
+    void Flush();
+
+    // the number of lines dropped, as of the last time the rings were
+    // written out
+    uint64_t dropped() const { return dropped_; }
+
+private:
+    // returns the calling thread's ring, creating it if needed
+    LogRing& ThreadRing();
+
+    // writes out what's in the rings and returns the number of bytes
+    size_t Drain();
+    void Run();
+
+    int fd_;
+    uint64_t id_;  // to tell instances apart in thread-local caches
+
+    std::mutex rings_mux_;
+    std::vector<std::shared_ptr<LogRing>> rings_;
+
+    std::mutex drain_mux_;  // held while draining
+    std::atomic<uint64_t> dropped_ = 0;
+
+    std::atomic<bool> done_ = false;
+    std::thread thread_;
+};
+
+}  // namespace gabby
+
+#endif  // GABBY_UTILS_LOG_SINK_H_
@@ -0,0 +1,130 @@
+#include "utils/log_sink.h"
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <format>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "test/test.h"
+#include "utils/logging.h"
+
+namespace gabby {
+
+namespace {
+
+std::string ReadFile(FILE* file) {
+    std::string data;
+    std::rewind(file);
+    char buf[4096];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof(buf), file)) > 0) data.append(buf, n);
+    return data;
+}
+
+}  // namespace
+
+TEST(LogRing, WrapsAround) {
+    // Arrange
+    // Fill most of the ring and consume it, so the next line wraps.
+    LogRing ring;
+    std::string filler(LogRing::kSize - 3, 'x');
+    ring.Push(filler);
+    ring.Consume(filler.size());
+
+    // Act
+    bool pushed = ring.Push("hello\n");
+    auto [first, second] = ring.Peek();
+
+    // Assert
+    EXPECT_TRUE(pushed);
+    EXPECT_EQ("hel", first);
+    EXPECT_EQ("lo\n", second);
+}
+
+TEST(LogRing, RejectsLinesThatDontFit) {
+    // Arrange
+    LogRing ring;
+    std::string filler(LogRing::kSize - 3, 'x');
+    ring.Push(filler);
+
+    // Act
+    bool pushed = ring.Push("hello\n");
+
+    // Assert
+    // Nothing of the line should have been written.
+    EXPECT_FALSE(pushed);
+    EXPECT_EQ(filler.size(), ring.Peek().first.size());
+}
+
+TEST(LogSink, WritesLinesFromManyThreads) {
+    // Arrange
+    FILE* file = std::tmpfile();
+    std::vector<std::thread> threads;
+
+    // Act
+    {
+        LogSink sink(fileno(file));
+        for (int t = 0; t < 4; t++) {
+            threads.emplace_back([&sink, t] {
+                for (int i = 0; i < 1000; i++) {
+                    sink.Write(std::format("thread {} line {}\n", t, i));
+                }
+            });
+        }
+        for (auto& thread : threads) thread.join();
+    }
+    std::string data = ReadFile(file);
+    std::fclose(file);
+
+    // Assert
+    // Every line should be there, whole.
+    std::set<std::string> lines;
+    size_t pos = 0;
+    for (size_t end; (end = data.find('\n', pos)) != std::string::npos;
+         pos = end + 1) {
+        lines.insert(data.substr(pos, end - pos));
+    }
+    EXPECT_EQ(4000, lines.size());
+    EXPECT_TRUE(lines.contains("thread 3 line 999"));
+    EXPECT_EQ(data.size(), pos);
+}
+
+TEST(Logging, DisabledLogsAreNotEvaluated) {
+    // Arrange
+    ScopedLogLevel scope(LogLevel::ERROR);
+    int evaluated = 0;
+    auto expensive = [&evaluated] { return ++evaluated; };
+
+    // Act
+    LOG(DEBUG) << expensive();
+
+    // Assert
+    EXPECT_EQ(0, evaluated);
+}
+
+TEST(Logging, FlushesToAsyncSink) {
+    // Arrange
+    ScopedLogLevel scope(LogLevel::INFO);
+    char path[] = "/tmp/gabby_log_XXXXXX";
+    close(mkstemp(path));
+
+    // Act
+    StartAsyncLogging(path);
+    LOG(INFO) << "hello " << 42;
+    StopAsyncLogging();
+    FILE* file = std::fopen(path, "r");
+    std::string data = ReadFile(file);
+    std::fclose(file);
+    unlink(path);
+
+    // Assert
+    EXPECT_SUBSTR(data, "log_sink_test.cc");
+    EXPECT_SUBSTR(data, "INFO: hello 42\n");
+}
+
+}  // namespace gabby
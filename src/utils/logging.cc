@@ -1,14 +1,25 @@
 #include "utils/logging.h"
 
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
 #include <cassert>
+#include <charconv>
 #include <chrono>
 #include <cstring>
 #include <format>
 #include <iostream>
+#include <mutex>
+#include <streambuf>
+#include <string_view>
+
+#include "utils/log_sink.h"
+#include "utils/pointers.h"
 
 namespace gabby {
 
-LogLevel GlobalLogLevel = LogLevel::OFF;
+std::atomic<LogLevel> GlobalLogLevel = LogLevel::OFF;
 
 void SetGlobalLogLevel(LogLevel level) { GlobalLogLevel = level; }
 
@@ -23,22 +34,132 @@ std::ostream &operator<<(std::ostream &os, LogLevel level) {
     assert(false);
 }
 
+namespace {
+
+// longer lines are truncated
+constexpr size_t kMaxLineLen = 4096;
+
+// set while logging asynchronously
+std::atomic<LogSink *> async_sink = nullptr;
+std::mutex async_mux;
+std::unique_ptr<LogSink> owned_sink;
+OwnedFd log_file(nullptr, nullptr);
+
 const char *basename(const char *filename) {
     const char *slash = strrchr(filename, '/');
     return slash ? slash + 1 : filename;
 }
 
-Logger::Logger(const char *filename, int line, LogLevel level) : level_(level) {
-    auto ts = std::chrono::system_clock::now();
-    stream_ << std::format("{}", ts) << " " << basename(filename) << ":" << line
-            << " " << level << ": ";
+// a stream buffer over a fixed array, which drops anything that doesn't
+// fit, so that formatting a line never allocates
+class LineBuffer : public std::streambuf {
+public:
+    LineBuffer() { Reset(); }
+
+    void Reset() { setp(buf_, buf_ + kMaxLineLen); }
+
+    // ends the line and returns it
+    std::string_view Finish() {
+        *pptr() = '\n';
+        return std::string_view(pbase(), pptr() - pbase() + 1);
+    }
+
+protected:
+    int_type overflow(int_type c) override { return traits_type::not_eof(c); }
+
+private:
+    char buf_[kMaxLineLen + 1];  // with room for the newline
+};
+
+// writes the current time, like 2025-01-02 03:04:05.123456789. the date
+// and time only change once a second, so they're only formatted then.
+void WriteTimestamp(std::streambuf &buf) {
+    thread_local time_t cached_secs = -1;
+    thread_local char prefix[32];
+    thread_local size_t prefix_len = 0;
+
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    auto secs = std::chrono::floor<std::chrono::seconds>(now);
+    if (secs.count() != cached_secs) {
+        cached_secs = secs.count();
+        struct tm tm;
+        gmtime_r(&cached_secs, &tm);
+        prefix_len = strftime(prefix, sizeof(prefix), "%F %T.", &tm);
+    }
+    buf.sputn(prefix, prefix_len);
+
+    // zero-padded to nine digits
+    char nanos[16] = "000000000";
+    auto count = std::chrono::nanoseconds(now - secs).count();
+    char *end = std::to_chars(nanos + 9, nanos + sizeof(nanos), count).ptr;
+    size_t digits = end - (nanos + 9);
+    buf.sputn(nanos + digits, 9);
+}
+
+}  // namespace
+
+struct Logger::Line {
+    LineBuffer buf;
+    std::ostream stream{&buf};
+    bool busy = false;
+};
+
+namespace {
+thread_local Logger::Line thread_line;
+}  // namespace
+
+Logger::Logger(const char *filename, int line, LogLevel level) {
+    if (thread_line.busy) {
+        owned_ = std::make_unique<Line>();
+        line_ = owned_.get();
+    } else {
+        line_ = &thread_line;
+        line_->busy = true;
+    }
+    line_->buf.Reset();
+    // undo anything the last log on this thread did to the stream
+    std::ostream &os = line_->stream;
+    os.clear();
+    os.flags(std::ios_base::dec | std::ios_base::skipws);
+    os.precision(6);
+    os.fill(' ');
+
+    WriteTimestamp(line_->buf);
+    os << " " << basename(filename) << ":" << line << " " << level << ": ";
 }
 
 Logger::~Logger() {
-    if (level_ <= GlobalLogLevel) {
-        stream_ << std::endl;
-        std::cerr << stream_.str();
+    std::string_view text = line_->buf.Finish();
+    if (LogSink *sink = async_sink.load(std::memory_order_acquire)) {
+        sink->Write(text);
+    } else {
+        std::cerr.write(text.data(), text.size());
     }
+    if (line_ == &thread_line) thread_line.busy = false;
+}
+
+std::ostream &Logger::stream() { return line_->stream; }
+
+void StartAsyncLogging(const std::string &path) {
+    std::lock_guard guard(async_mux);
+    if (owned_sink != nullptr) return;
+    int fd = STDERR_FILENO;
+    if (!path.empty()) {
+        int file = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+                        0644);
+        if (file < 0) throw SystemError(errno);
+        log_file = Own(file);
+        fd = file;
+    }
+    owned_sink = std::make_unique<LogSink>(fd);
+    async_sink.store(owned_sink.get(), std::memory_order_release);
+}
+
+void StopAsyncLogging() {
+    std::lock_guard guard(async_mux);
+    async_sink.store(nullptr, std::memory_order_release);
+    owned_sink.reset();
+    log_file.reset();
 }
 
 }  // namespace gabby
@@ -1,16 +1,35 @@
 #ifndef GABBY_UTILS_LOGGING_H_
 #define GABBY_UTILS_LOGGING_H_
 
+#include <atomic>
 #include <cstring>
 #include <format>
+#include <memory>
 #include <ostream>
 #include <source_location>
-#include <sstream>
+#include <string>
+
+// the most verbose level that's compiled in. anything more verbose
+// compiles to nothing, so it can be used to strip DEBUG logs from hot
+// paths entirely.
+#ifndef GABBY_MAX_LOG_LEVEL
+#define GABBY_MAX_LOG_LEVEL 4  // DEBUG
+#endif
 
 namespace gabby {
 
 // usage: LOG(INFO) << "hello, world";
-#define LOG(level) gabby::Logger(__FILE__, __LINE__, level).stream()
+//
+// nothing after the << is evaluated unless |level| is enabled. it's a
+// single expression, rather than an if, so that it can't take the else
+// of an if it's used in.
+#define LOG(level)                                  \
+    !gabby::LogEnabled(gabby::LogLevel::level)      \
+        ? (void)0                                   \
+        : gabby::LogVoidify() &                     \
+              gabby::Logger(__FILE__, __LINE__,     \
+                            gabby::LogLevel::level) \
+                  .stream()
 
 enum LogLevel {
     OFF = 0,
@@ -22,9 +41,30 @@ enum LogLevel {
 
 std::ostream& operator<<(std::ostream& os, LogLevel level);
 
-extern LogLevel GlobalLogLevel;
+extern std::atomic<LogLevel> GlobalLogLevel;
 void SetGlobalLogLevel(LogLevel level);
 
+inline bool LogEnabled(LogLevel level) {
+    return level <= GABBY_MAX_LOG_LEVEL &&
+           level <= GlobalLogLevel.load(std::memory_order_relaxed);
+}
+
+// turns the stream a log is written to into void, so that both sides
+// of the conditional in LOG have the same type. & binds less tightly
+// than <<, and more tightly than ?:.
+struct LogVoidify {
+    void operator&(std::ostream&) {}
+};
+
+// sends logs to a background thread, which writes them to |path|, or to
+// stderr if it's empty. until this is called, each log is written to
+// stderr as it's logged.
+void StartAsyncLogging(const std::string& path = "");
+
+// writes out all logs so far, and goes back to writing them as they're
+// logged. no other thread may be logging.
+void StopAsyncLogging();
+
 class ScopedLogLevel {
 public:
     ScopedLogLevel(LogLevel level) : prev_(GlobalLogLevel) {
@@ -36,15 +76,21 @@ private:
     LogLevel prev_;
 };
 
+// formats a single log line into a per-thread buffer, and writes it out
+// when it's destroyed
 class Logger {
 public:
     Logger(const char* filename, int line, LogLevel level);
     ~Logger();
-    std::ostream& stream() { return stream_; }
+    std::ostream& stream();
+
+    struct Line;
 
 private:
-    LogLevel level_;
-    std::ostringstream stream_;
+    Line* line_;
+    // only when another log is being formatted on this thread, like
+    // from a value's operator<<
+    std::unique_ptr<Line> owned_;
 };
 
 class SystemError : public std::exception {
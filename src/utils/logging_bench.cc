@@ -0,0 +1,82 @@
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <sstream>
+
+#include "test/bench.h"
+#include "utils/logging.h"
+
+namespace gabby {
+
+namespace {
+
+// the logger that LOG used to build, kept here as a baseline. it
+// formatted the whole line before checking the level.
+namespace legacy {
+
+class Logger {
+public:
+    Logger(const char* filename, int line, LogLevel level, std::ostream& out)
+        : level_(level), out_(out) {
+        auto ts = std::chrono::system_clock::now();
+        stream_ << std::format("{}", ts) << " " << filename << ":" << line
+                << " " << level << ": ";
+    }
+    ~Logger() {
+        if (level_ <= GlobalLogLevel) {
+            stream_ << std::endl;
+            out_ << stream_.str();
+        }
+    }
+    std::ostream& stream() { return stream_; }
+
+private:
+    LogLevel level_;
+    std::ostream& out_;
+    std::ostringstream stream_;
+};
+
+}  // namespace legacy
+
+// an access log line, as the server writes for each request
+#define ACCESS_LOG(log)                                                 \
+    log << "127.0.0.1" << " - " << "POST" << " " << "/v1/chat/completions" \
+        << " HTTP/1.1 " << 200 << " " << 1234 << " " << "curl/8.5.0"
+
+}  // namespace
+
+BENCHMARK(Logging, LegacyDisabled) {
+    ScopedLogLevel scope(LogLevel::OFF);
+    std::ofstream devnull("/dev/null");
+    while (state.KeepRunning()) {
+        ACCESS_LOG(legacy::Logger(__FILE__, __LINE__, LogLevel::INFO, devnull)
+                       .stream());
+    }
+}
+
+BENCHMARK(Logging, LegacyEnabled) {
+    ScopedLogLevel scope(LogLevel::INFO);
+    std::ofstream devnull("/dev/null");
+    while (state.KeepRunning()) {
+        ACCESS_LOG(legacy::Logger(__FILE__, __LINE__, LogLevel::INFO, devnull)
+                       .stream());
+    }
+}
+
+BENCHMARK(Logging, Disabled) {
+    ScopedLogLevel scope(LogLevel::OFF);
+    while (state.KeepRunning()) {
+        ACCESS_LOG(LOG(INFO));
+    }
+}
+
+BENCHMARK(Logging, EnabledAsync) {
+    ScopedLogLevel scope(LogLevel::INFO);
+    StartAsyncLogging("/dev/null");
+    while (state.KeepRunning()) {
+        ACCESS_LOG(LOG(INFO));
+    }
+    StopAsyncLogging();
+}
+
+}  // namespace gabby
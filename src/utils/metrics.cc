@@ -0,0 +1,221 @@
+#include "utils/metrics.h"
+
+#include <algorithm>
+#include <bit>
+#include <format>
+#include <stdexcept>
+
+namespace gabby {
+
+namespace {
+
+// renders |labels|, plus |extra| if it's set, as {k="v",...}
+std::string RenderLabels(const Labels& labels,
+                         std::pair<std::string_view, std::string> extra = {}) {
+    if (labels.empty() && extra.first.empty()) return "";
+    std::string out = "{";
+    auto add = [&out](std::string_view k, std::string_view v) {
+        if (out.size() > 1) out += ',';
+        out += std::format("{}=\"", k);
+        for (char c : v) {
+            if (c == '\\' || c == '"') out += '\\';
+            if (c == '\n') out += "\\n";
+            else out += c;
+        }
+        out += '"';
+    };
+    for (const auto& [k, v] : labels) add(k, v);
+    if (!extra.first.empty()) add(extra.first, extra.second);
+    out += '}';
+    return out;
+}
+
+}  // namespace
+
+int64_t Counter::value() const {
+    int64_t sum = 0;
+    for (const Shard& shard : shards_) {
+        sum += shard.value.load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+Histogram::Histogram() : shards_(new Shard[kMetricShards]) {}
+
+int Histogram::Bucket(int64_t value) {
+    value = std::clamp<int64_t>(value, 0, (int64_t(1) << kMaxBits) - 1);
+    if (value < kSubBuckets) return value;
+    int shift = std::bit_width(uint64_t(value)) - 1 - kSubBucketBits;
+    int sub = (value >> shift) & (kSubBuckets - 1);
+    return (shift + 1) * kSubBuckets + sub;
+}
+
+int64_t Histogram::LowerBound(int bucket) {
+    if (bucket < kSubBuckets) return bucket;
+    int shift = bucket / kSubBuckets - 1;
+    return int64_t(kSubBuckets + bucket % kSubBuckets) << shift;
+}
+
+int64_t Histogram::UpperBound(int bucket) {
+    if (bucket < kSubBuckets) return bucket + 1;
+    int shift = bucket / kSubBuckets - 1;
+    return int64_t(kSubBuckets + bucket % kSubBuckets + 1) << shift;
+}
+
+void Histogram::Record(int64_t value) {
+    value = std::max<int64_t>(value, 0);
+    Shard& shard = shards_[MetricShard()];
+    shard.counts[Bucket(value)].fetch_add(1, std::memory_order_relaxed);
+    shard.count.fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(value, std::memory_order_relaxed);
+    int64_t max = shard.max.load(std::memory_order_relaxed);
+    while (value > max && !shard.max.compare_exchange_weak(
+                              max, value, std::memory_order_relaxed)) {
+    }
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+    Snapshot snap;
+    snap.counts.resize(kBuckets);
+    for (int i = 0; i < kMetricShards; i++) {
+        const Shard& shard = shards_[i];
+        for (int b = 0; b < kBuckets; b++) {
+            snap.counts[b] += shard.counts[b].load(std::memory_order_relaxed);
+        }
+        snap.count += shard.count.load(std::memory_order_relaxed);
+        snap.sum += shard.sum.load(std::memory_order_relaxed);
+        snap.max = std::max(snap.max,
+                            shard.max.load(std::memory_order_relaxed));
+    }
+    return snap;
+}
+
+int64_t Histogram::Snapshot::Percentile(double q) const {
+    if (count == 0) return 0;
+    uint64_t rank = std::max<uint64_t>(1, q * count + 0.5);
+    uint64_t seen = 0;
+    for (int b = 0; b < kBuckets; b++) {
+        seen += counts[b];
+        // the top of the bucket, as no value in it is known to be lower
+        if (seen >= rank) return std::min(UpperBound(b) - 1, max);
+    }
+    return max;
+}
+
+std::string_view Metrics::TypeName(Type type) {
+    switch (type) {
+        case Type::Counter: return "counter";
+        case Type::Gauge: return "gauge";
+        case Type::Histogram: return "histogram";
+    }
+    return "";
+}
+
+Metrics::Family& Metrics::family(std::string_view name,
+                                 std::string_view help, Type type) {
+    auto it = families_.find(name);
+    if (it == families_.end()) {
+        it = families_.emplace(std::string(name),
+                               Family{.type = type, .help = std::string(help)})
+                 .first;
+    } else if (it->second.type != type) {
+        throw std::invalid_argument(
+            std::format("metric {} registered with two types", name));
+    }
+    return it->second;
+}
+
+Counter& Metrics::counter(std::string_view name, std::string_view help,
+                          const Labels& labels) {
+    std::lock_guard guard(mux_);
+    auto& counter = family(name, help, Type::Counter).counters[labels];
+    if (!counter) counter = std::make_unique<Counter>();
+    return *counter;
+}
+
+Counter& Metrics::gauge(std::string_view name, std::string_view help,
+                        const Labels& labels) {
+    std::lock_guard guard(mux_);
+    auto& gauge = family(name, help, Type::Gauge).counters[labels];
+    if (!gauge) gauge = std::make_unique<Counter>();
+    return *gauge;
+}
+
+Histogram& Metrics::histogram(std::string_view name, std::string_view help,
+                              const Labels& labels) {
+    std::lock_guard guard(mux_);
+    auto& histogram = family(name, help, Type::Histogram).histograms[labels];
+    if (!histogram) histogram = std::make_unique<Histogram>();
+    return *histogram;
+}
+
+std::string Metrics::Text() const {
+    std::lock_guard guard(mux_);
+    std::string out;
+    for (const auto& [name, family] : families_) {
+        out += std::format("{} ({}): {}\n", name, TypeName(family.type),
+                           family.help);
+        for (const auto& [labels, counter] : family.counters) {
+            out += std::format("  {} {}\n", RenderLabels(labels),
+                               counter->value());
+        }
+        for (const auto& [labels, histogram] : family.histograms) {
+            Histogram::Snapshot snap = histogram->snapshot();
+            out += std::format(
+                "  {} count={} mean={:.1f} p50={} p90={} p99={} p999={} "
+                "max={}\n",
+                RenderLabels(labels), snap.count, snap.mean(),
+                snap.Percentile(0.5), snap.Percentile(0.9),
+                snap.Percentile(0.99), snap.Percentile(0.999), snap.max);
+        }
+    }
+    return out;
+}
+
+std::string Metrics::Prometheus() const {
+    std::lock_guard guard(mux_);
+    std::string out;
+    for (const auto& [name, family] : families_) {
+        out += std::format("# HELP {} {}\n", name, family.help);
+        out += std::format("# TYPE {} {}\n", name, TypeName(family.type));
+        for (const auto& [labels, counter] : family.counters) {
+            out += std::format("{}{} {}\n", name, RenderLabels(labels),
+                               counter->value());
+        }
+        for (const auto& [labels, histogram] : family.histograms) {
+            Histogram::Snapshot snap = histogram->snapshot();
+            // buckets are cumulative, up to the first power of two that
+            // holds everything
+            uint64_t seen = 0;
+            int bucket = 0;
+            for (int bits = 0; seen < snap.count && bits <= Histogram::kMaxBits;
+                 bits++) {
+                int64_t le = int64_t(1) << bits;
+                for (; bucket < Histogram::kBuckets &&
+                       Histogram::UpperBound(bucket) <= le;
+                     bucket++) {
+                    seen += snap.counts[bucket];
+                }
+                out += std::format("{}_bucket{} {}\n", name,
+                                   RenderLabels(labels, {"le", std::to_string(
+                                                               le - 1)}),
+                                   seen);
+            }
+            out += std::format("{}_bucket{} {}\n", name,
+                               RenderLabels(labels, {"le", "+Inf"}),
+                               snap.count);
+            out += std::format("{}_sum{} {}\n", name, RenderLabels(labels),
+                               snap.sum);
+            out += std::format("{}_count{} {}\n", name, RenderLabels(labels),
+                               snap.count);
+        }
+    }
+    return out;
+}
+
+Metrics& GlobalMetrics() {
+    static Metrics* metrics = new Metrics();
+    return *metrics;
+}
+
+}  // namespace gabby
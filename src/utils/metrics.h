@@ -0,0 +1,143 @@
+#ifndef GABBY_UTILS_METRICS_H_
+#define GABBY_UTILS_METRICS_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace gabby {
+
+// metrics are recorded into one of a fixed number of shards, picked by
+// the recording thread, and merged when they're read. as long as there
+// are no more threads than shards, recording never touches a cache
+// line that another thread writes to.
+constexpr int kMetricShards = 16;
+
+// the shard that the calling thread records into
+inline int MetricShard() {
+    static std::atomic<int> next = 0;
+    thread_local int shard =
+        next.fetch_add(1, std::memory_order_relaxed) % kMetricShards;
+    return shard;
+}
+
+// a sum that's cheap to add to from any thread. used both for counts
+// that only go up, and for gauges like the number of open connections
+// that go up and down.
+class Counter {
+public:
+    void Add(int64_t n = 1) {
+        shards_[MetricShard()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    int64_t value() const;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<int64_t> value = 0;
+    };
+
+    std::array<Shard, kMetricShards> shards_;
+};
+
+// a log-linear histogram of non-negative values, in the style of
+// HdrHistogram. values below 16 are counted exactly, and larger ones in
+// buckets 1/16th of a power of two wide, so every value is known to
+// within about 6%. values of 2^40 and above are counted as 2^40 - 1.
+class Histogram {
+public:
+    static constexpr int kSubBucketBits = 4;
+    static constexpr int kSubBuckets = 1 << kSubBucketBits;
+    static constexpr int kMaxBits = 40;
+    static constexpr int kBuckets = (kMaxBits - kSubBucketBits + 1) *
+                                    kSubBuckets;
+
+    // everything recorded so far, merged across shards
+    struct Snapshot {
+        std::vector<uint64_t> counts;
+        uint64_t count = 0;
+        int64_t sum = 0;
+        int64_t max = 0;
+
+        double mean() const { return count == 0 ? 0 : double(sum) / count; }
+
+        // the smallest value that at least |q| of the values are at or
+        // below, give or take the width of its bucket. 0 <= q <= 1.
+        int64_t Percentile(double q) const;
+    };
+
+    Histogram();
+
+    void Record(int64_t value);
+
+    Snapshot snapshot() const;
+
+    static int Bucket(int64_t value);
+    // the values in |bucket| are in [LowerBound, UpperBound)
+    static int64_t LowerBound(int bucket);
+    static int64_t UpperBound(int bucket);
+
+private:
+    struct alignas(64) Shard {
+        std::array<std::atomic<uint64_t>, kBuckets> counts{};
+        std::atomic<uint64_t> count = 0;
+        std::atomic<int64_t> sum = 0;
+        std::atomic<int64_t> max = 0;
+    };
+
+    std::unique_ptr<Shard[]> shards_;
+};
+
+// name="value" pairs that tell metrics of the same name apart
+using Labels = std::vector<std::pair<std::string, std::string>>;
+
+// every metric in the process, by name and labels. looking one up takes
+// a lock, so it should be done once up front rather than for every
+// recording. metrics are never removed, so references to them stay
+// valid.
+class Metrics {
+public:
+    Counter& counter(std::string_view name, std::string_view help,
+                     const Labels& labels = {});
+    Counter& gauge(std::string_view name, std::string_view help,
+                   const Labels& labels = {});
+    Histogram& histogram(std::string_view name, std::string_view help,
+                         const Labels& labels = {});
+
+    // renders every metric for people to read, with percentiles for the
+    // histograms
+    std::string Text() const;
+
+    // renders every metric in the prometheus text exposition format.
+    // histograms are reported with a bucket for each power of two.
+    std::string Prometheus() const;
+
+private:
+    enum class Type { Counter, Gauge, Histogram };
+
+    struct Family {
+        Type type;
+        std::string help;
+        std::map<Labels, std::unique_ptr<Counter>> counters;
+        std::map<Labels, std::unique_ptr<Histogram>> histograms;
+    };
+
+    static std::string_view TypeName(Type type);
+    Family& family(std::string_view name, std::string_view help, Type type);
+
+    mutable std::mutex mux_;
+    std::map<std::string, Family, std::less<>> families_;
+};
+
+Metrics& GlobalMetrics();
+
+}  // namespace gabby
+
+#endif  // GABBY_UTILS_METRICS_H_
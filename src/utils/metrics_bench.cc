@@ -0,0 +1,67 @@
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "test/bench.h"
+#include "utils/metrics.h"
+
+namespace gabby {
+
+namespace {
+
+// calls |record| in a loop on |threads| - 1 other threads while it's
+// measured on this one, like request handlers recording the same metric
+template <typename F>
+void RunContended(BenchmarkState& state, int threads, F record) {
+    std::atomic<bool> stop = false;
+    std::vector<std::thread> others;
+    for (int i = 1; i < threads; i++) {
+        others.emplace_back([&stop, &record] {
+            while (!stop.load(std::memory_order_relaxed)) record();
+        });
+    }
+    while (state.KeepRunning()) record();
+    stop = true;
+    for (auto& thread : others) thread.join();
+}
+
+}  // namespace
+
+// a single atomic that every thread adds to, as a baseline
+BENCHMARK(Metrics, LegacyAtomic1Thread) {
+    std::atomic<int64_t> counter = 0;
+    RunContended(state, 1, [&counter] {
+        counter.fetch_add(1, std::memory_order_relaxed);
+    });
+}
+BENCHMARK(Metrics, LegacyAtomic4Threads) {
+    std::atomic<int64_t> counter = 0;
+    RunContended(state, 4, [&counter] {
+        counter.fetch_add(1, std::memory_order_relaxed);
+    });
+}
+
+BENCHMARK(Metrics, Counter1Thread) {
+    Counter counter;
+    RunContended(state, 1, [&counter] { counter.Add(); });
+}
+BENCHMARK(Metrics, Counter4Threads) {
+    Counter counter;
+    RunContended(state, 4, [&counter] { counter.Add(); });
+}
+
+BENCHMARK(Metrics, Histogram1Thread) {
+    Histogram histogram;
+    int64_t x = 0;
+    RunContended(state, 1, [&histogram, &x] { histogram.Record(x++ & 4095); });
+}
+BENCHMARK(Metrics, Histogram4Threads) {
+    Histogram histogram;
+    RunContended(state, 4, [&histogram] {
+        thread_local int64_t x = 0;
+        histogram.Record(x++ & 4095);
+    });
+}
+
+}  // namespace gabby
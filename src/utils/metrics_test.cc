@@ -0,0 +1,122 @@
+#include "utils/metrics.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test/test.h"
+
+namespace gabby {
+
+TEST(Counter, SumsAcrossThreads) {
+    // Arrange
+    Counter counter;
+    std::vector<std::thread> threads;
+
+    // Act
+    for (int i = 0; i < 2 * kMetricShards; i++) {
+        threads.emplace_back([&counter] {
+            for (int j = 0; j < 1000; j++) counter.Add();
+        });
+    }
+    for (auto& thread : threads) thread.join();
+
+    // Assert
+    EXPECT_EQ(2 * kMetricShards * 1000, counter.value());
+}
+
+TEST(Histogram, BucketsCoverEveryValue) {
+    // Arrange
+    // Values around the edges of the exact range and of a few buckets.
+    std::vector<int64_t> values = {0,    1,    15,   16,    17,
+                                   31,   32,   33,   1000,  4095,
+                                   4096, 4097, 1'000'000, (1ll << 40) - 1};
+
+    // Act & Assert
+    for (int64_t value : values) {
+        int bucket = Histogram::Bucket(value);
+        EXPECT_TRUE(bucket >= 0 && bucket < Histogram::kBuckets);
+        EXPECT_TRUE(Histogram::LowerBound(bucket) <= value);
+        EXPECT_TRUE(value < Histogram::UpperBound(bucket));
+    }
+    EXPECT_EQ(Histogram::UpperBound(0), Histogram::LowerBound(1));
+    EXPECT_EQ(Histogram::kBuckets - 1, Histogram::Bucket(1ll << 50));
+}
+
+TEST(Histogram, Percentiles) {
+    // Arrange
+    Histogram histogram;
+
+    // Act
+    for (int i = 1; i <= 1000; i++) histogram.Record(i);
+    auto snapshot = histogram.snapshot();
+
+    // Assert
+    EXPECT_EQ(1000, snapshot.count);
+    EXPECT_EQ(500500, snapshot.sum);
+    EXPECT_EQ(1000, snapshot.max);
+    // Each is within the ~6% width of its bucket.
+    EXPECT_TRUE(snapshot.Percentile(0.5) >= 470);
+    EXPECT_TRUE(snapshot.Percentile(0.5) <= 530);
+    EXPECT_TRUE(snapshot.Percentile(0.99) >= 930);
+    EXPECT_TRUE(snapshot.Percentile(0.99) <= 1000);
+    EXPECT_EQ(1000, snapshot.Percentile(1));
+}
+
+TEST(Metrics, SameNameAndLabelsAreTheSameMetric) {
+    // Arrange
+    Metrics metrics;
+
+    // Act
+    Counter& a = metrics.counter("requests_total", "requests", {{"a", "1"}});
+    Counter& b = metrics.counter("requests_total", "requests", {{"a", "1"}});
+    Counter& c = metrics.counter("requests_total", "requests", {{"a", "2"}});
+
+    // Assert
+    EXPECT_TRUE(&a == &b);
+    EXPECT_TRUE(&a != &c);
+}
+
+TEST(Metrics, Text) {
+    // Arrange
+    Metrics metrics;
+    metrics.counter("requests_total", "requests handled", {{"route", "/"}})
+        .Add(3);
+    metrics.histogram("latency_microseconds", "how long they took")
+        .Record(100);
+
+    // Act
+    std::string text = metrics.Text();
+
+    // Assert
+    EXPECT_SUBSTR(text, "requests_total (counter): requests handled");
+    EXPECT_SUBSTR(text, "{route=\"/\"} 3");
+    EXPECT_SUBSTR(text, "latency_microseconds (histogram): how long they took");
+    EXPECT_SUBSTR(text, "p99");
+}
+
+TEST(Metrics, Prometheus) {
+    // Arrange
+    Metrics metrics;
+    metrics.gauge("connections_open", "open connections").Add(2);
+    auto& histogram =
+        metrics.histogram("latency_microseconds", "latency", {{"a", "b"}});
+    histogram.Record(1);
+    histogram.Record(100);
+
+    // Act
+    std::string text = metrics.Prometheus();
+
+    // Assert
+    EXPECT_SUBSTR(text, "# HELP connections_open open connections\n");
+    EXPECT_SUBSTR(text, "# TYPE connections_open gauge\n");
+    EXPECT_SUBSTR(text, "connections_open 2\n");
+    EXPECT_SUBSTR(text, "# TYPE latency_microseconds histogram\n");
+    EXPECT_SUBSTR(text, "latency_microseconds_bucket{a=\"b\",le=\"1\"} 1\n");
+    EXPECT_SUBSTR(text, "latency_microseconds_bucket{a=\"b\",le=\"127\"} 2\n");
+    EXPECT_SUBSTR(text, "latency_microseconds_bucket{a=\"b\",le=\"+Inf\"} 2\n");
+    EXPECT_SUBSTR(text, "latency_microseconds_sum{a=\"b\"} 101\n");
+    EXPECT_SUBSTR(text, "latency_microseconds_count{a=\"b\"} 2\n");
+}
+
+}  // namespace gabby
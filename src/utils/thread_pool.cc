@@ -0,0 +1,111 @@
+#include "utils/thread_pool.h"
+
+#include <format>
+
+#include "utils/logging.h"
+#include "utils/metrics.h"
+
+namespace gabby {
+
+namespace {
+
+// the pool and queue that the current thread works on, if any
+thread_local ThreadPool* current_pool = nullptr;
+thread_local int current_id = -1;
+
+Counter& TasksRun() {
+    static Counter& counter = GlobalMetrics().counter(
+        "thread_pool_tasks_total", "tasks run by thread pool workers");
+    return counter;
+}
+
+Counter& TasksStolen() {
+    static Counter& counter = GlobalMetrics().counter(
+        "thread_pool_steals_total",
+        "tasks taken from another worker's queue");
+    return counter;
+}
+
+}  // namespace
+
+ThreadPool::ThreadPool(int num, std::function<void(int id)> init)
+    : init_(std::move(init)) {
+    if (num < 1) {
+        throw std::invalid_argument("minimum thread pool size is 1");
+    }
+    for (int i = 0; i < num; i++) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    LOG(DEBUG) << std::format("starting {} threads", num);
+    for (int i = 0; i < num; i++) {
+        threads_.emplace_back(&ThreadPool::ThreadRun, this, i);
+    }
+}
+
+std::optional<Task> ThreadPool::Take(int id, bool* contended) {
+    // our own queue first, then steal from the others, oldest first
+    int n = queues_.size();
+    for (int i = 0; i < n; i++) {
+        Queue& q = *queues_[(id + i) % n];
+        std::unique_lock guard(q.mux, std::try_to_lock);
+        if (!guard.owns_lock()) {
+            *contended = true;
+            continue;
+        }
+        if (q.tasks.empty()) continue;
+        Task task = std::move(q.tasks.front());
+        q.tasks.pop_front();
+        if (i > 0) TasksStolen().Add();
+        return task;
+    }
+    return std::nullopt;
+}
+
+void ThreadPool::ThreadRun(int id) {
+    LOG(DEBUG) << std::format("thread {} starting", id);
+    current_pool = this;
+    current_id = id;
+    if (init_) init_(id);
+    while (!done_) {
+        uint32_t seen = signal_.load();
+        bool contended = false;
+        if (std::optional<Task> task = Take(id, &contended)) {
+            TasksRun().Add();
+            (*task)();
+            continue;
+        }
+        // a queue we skipped may have had work in it
+        if (contended) {
+            std::this_thread::yield();
+            continue;
+        }
+        signal_.wait(seen);
+    }
+    LOG(DEBUG) << std::format("thread {} stopping", id);
+}
+
+ThreadPool::~ThreadPool() {
+    LOG(DEBUG) << "shutting down all threads";
+    done_ = true;
+    signal_.fetch_add(1);
+    signal_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+    LOG(DEBUG) << "all threads shut down";
+}
+
+void ThreadPool::Offer(Task task) {
+    int n = queues_.size();
+    int id = current_pool == this
+                 ? current_id
+                 : next_.fetch_add(1, std::memory_order_relaxed) % n;
+    {
+        std::lock_guard guard(queues_[id]->mux);
+        queues_[id]->tasks.push_back(std::move(task));
+    }
+    signal_.fetch_add(1);
+    signal_.notify_one();
+}
+
+}  // namespace gabby
@@ -0,0 +1,142 @@
+#ifndef GABBY_UTILS_THREAD_POOL_H_
+#define GABBY_UTILS_THREAD_POOL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace gabby {
+
+// a move-only type-erased callable, like std::move_only_function<void()>.
+// small callables are stored inline to avoid allocating.
+class Task {
+public:
+    Task() = default;
+
+    template <typename F>
+        requires(!std::is_same_v<std::decay_t<F>, Task> &&
+                 std::is_invocable_v<std::decay_t<F>&>)
+    Task(F&& f) {
+        using Fn = std::decay_t<F>;
+        if constexpr (sizeof(Fn) <= kInlineSize &&
+                      alignof(Fn) <= alignof(std::max_align_t) &&
+                      std::is_nothrow_move_constructible_v<Fn>) {
+            new (buf_) Fn(std::forward<F>(f));
+            ops_ = &kInlineOps<Fn>;
+        } else {
+            new (buf_) Fn*(new Fn(std::forward<F>(f)));
+            ops_ = &kHeapOps<Fn>;
+        }
+    }
+
+    Task(Task&& other) noexcept { *this = std::move(other); }
+
+    Task& operator=(Task&& other) noexcept {
+        if (this == &other) return *this;
+        reset();
+        if (other.ops_) {
+            other.ops_->move(buf_, other.buf_);
+            ops_ = std::exchange(other.ops_, nullptr);
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() { reset(); }
+
+    void operator()() { ops_->invoke(buf_); }
+    explicit operator bool() const { return ops_ != nullptr; }
+
+private:
+    static constexpr size_t kInlineSize = 48;
+
+    struct Ops {
+        void (*invoke)(void* self);
+        void (*move)(void* dst, void* src);
+        void (*destroy)(void* self);
+    };
+
+    template <typename Fn>
+    static constexpr Ops kInlineOps = {
+        .invoke = [](void* self) { (*static_cast<Fn*>(self))(); },
+        .move =
+            [](void* dst, void* src) {
+                new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+                static_cast<Fn*>(src)->~Fn();
+            },
+        .destroy = [](void* self) { static_cast<Fn*>(self)->~Fn(); },
+    };
+
+    template <typename Fn>
+    static constexpr Ops kHeapOps = {
+        .invoke = [](void* self) { (**static_cast<Fn**>(self))(); },
+        .move =
+            [](void* dst, void* src) {
+                new (dst) Fn*(*static_cast<Fn**>(src));
+            },
+        .destroy = [](void* self) { delete *static_cast<Fn**>(self); },
+    };
+
+    void reset() {
+        if (ops_) ops_->destroy(buf_);
+        ops_ = nullptr;
+    }
+
+    alignas(std::max_align_t) unsigned char buf_[kInlineSize];
+    const Ops* ops_ = nullptr;
+};
+
+// a work-stealing thread pool. each worker has its own queue, and
+// workers with nothing to do steal from the others. tasks offered from
+// outside the pool are spread over the queues round-robin, and tasks
+// offered from a worker go on its own queue, so submitters rarely
+// contend with each other. tasks are run outside of any lock.
+//
+// tasks still queued when the pool is destroyed are dropped.
+class ThreadPool {
+public:
+    // |init| is called on each worker thread before it runs any tasks
+    explicit ThreadPool(int num, std::function<void(int id)> init = {});
+    ~ThreadPool();
+
+    void Offer(Task task);
+
+    int size() const { return threads_.size(); }
+
+private:
+    // padded so that workers don't share cache lines
+    struct alignas(64) Queue {
+        std::mutex mux;
+        std::deque<Task> tasks;
+    };
+
+    void ThreadRun(int id);
+    std::optional<Task> Take(int id, bool* contended);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::atomic<size_t> next_ = 0;
+
+    // bumped on every Offer and on shutdown. idle workers wait for it
+    // to change.
+    std::atomic<uint32_t> signal_ = 0;
+    std::atomic<bool> done_ = false;
+    std::function<void(int id)> init_;
+
+    std::vector<std::thread> threads_;
+};
+
+}  // namespace gabby
+
+#endif  // GABBY_UTILS_THREAD_POOL_H_
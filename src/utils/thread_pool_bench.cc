@@ -0,0 +1,123 @@
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <latch>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "test/bench.h"
+#include "utils/thread_pool.h"
+
+namespace gabby {
+
+namespace {
+
+constexpr int kTasksPerIteration = 10'000;
+
+// the pool that ThreadPool replaced, kept here as a baseline. it runs
+// tasks while holding the queue lock.
+class LegacyThreadPool {
+public:
+    explicit LegacyThreadPool(int num) : threads_(num) {
+        for (int i = 0; i < num; i++) {
+            threads_[i] = std::thread(&LegacyThreadPool::ThreadRun, this);
+        }
+    }
+
+    ~LegacyThreadPool() {
+        {
+            std::lock_guard guard(mux_);
+            done_ = true;
+        }
+        cnd_.notify_all();
+        for (auto& thread : threads_) thread.join();
+    }
+
+    void Offer(std::function<void()> task) {
+        {
+            std::lock_guard guard(mux_);
+            tasks_.push_back(task);
+        }
+        cnd_.notify_one();
+    }
+
+private:
+    void ThreadRun() {
+        while (true) {
+            std::unique_lock guard(mux_);
+            cnd_.wait(guard, [this] { return done_ || !tasks_.empty(); });
+            if (done_) break;
+            auto task = tasks_.front();
+            tasks_.pop_front();
+            task();
+        }
+    }
+
+    std::mutex mux_;
+    bool done_ = false;
+    std::deque<std::function<void()>> tasks_;
+    std::condition_variable cnd_;
+    std::vector<std::thread> threads_;
+};
+
+// about a microsecond of arithmetic
+uint64_t Spin() {
+    uint64_t x = 0x9e3779b97f4a7c15;
+    for (int i = 0; i < 1000; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+    }
+    return x;
+}
+
+template <typename Pool>
+void RunTasks(BenchmarkState& state, int threads, bool cpu_bound) {
+    Pool pool(threads);
+    std::atomic<uint64_t> sink = 0;
+    while (state.KeepRunning()) {
+        std::latch done(kTasksPerIteration);
+        for (int i = 0; i < kTasksPerIteration; i++) {
+            pool.Offer([&done, &sink, cpu_bound] {
+                if (cpu_bound) {
+                    sink.fetch_add(Spin(), std::memory_order_relaxed);
+                }
+                done.count_down();
+            });
+        }
+        done.wait();
+    }
+    state.counters["Mtasks/s"] =
+        kTasksPerIteration / state.nanos_per_iteration() * 1000;
+}
+
+}  // namespace
+
+BENCHMARK(ThreadPool, LegacyNoop4Threads) {
+    RunTasks<LegacyThreadPool>(state, 4, false);
+}
+BENCHMARK(ThreadPool, LegacyCpuBound4Threads) {
+    RunTasks<LegacyThreadPool>(state, 4, true);
+}
+
+BENCHMARK(ThreadPool, Noop1Thread) { RunTasks<ThreadPool>(state, 1, false); }
+BENCHMARK(ThreadPool, Noop2Threads) { RunTasks<ThreadPool>(state, 2, false); }
+BENCHMARK(ThreadPool, Noop4Threads) { RunTasks<ThreadPool>(state, 4, false); }
+BENCHMARK(ThreadPool, Noop8Threads) { RunTasks<ThreadPool>(state, 8, false); }
+
+BENCHMARK(ThreadPool, CpuBound1Thread) {
+    RunTasks<ThreadPool>(state, 1, true);
+}
+BENCHMARK(ThreadPool, CpuBound2Threads) {
+    RunTasks<ThreadPool>(state, 2, true);
+}
+BENCHMARK(ThreadPool, CpuBound4Threads) {
+    RunTasks<ThreadPool>(state, 4, true);
+}
+BENCHMARK(ThreadPool, CpuBound8Threads) {
+    RunTasks<ThreadPool>(state, 8, true);
+}
+
+}  // namespace gabby
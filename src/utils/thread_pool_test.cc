@@ -0,0 +1,77 @@
+#include "utils/thread_pool.h"
+
+#include <array>
+#include <atomic>
+#include <latch>
+#include <memory>
+
+#include "test/test.h"
+
+namespace gabby {
+
+TEST(Task, MoveOnlyCallables) {
+    int result = 0;
+    auto value = std::make_unique<int>(42);
+    Task task([&result, value = std::move(value)] { result = *value; });
+    Task moved = std::move(task);
+    EXPECT_FALSE(task);
+    moved();
+    EXPECT_EQ(42, result);
+}
+
+TEST(Task, LargeCallables) {
+    std::array<int, 64> values{};
+    values[63] = 7;
+    int result = 0;
+    Task task([&result, values] { result = values[63]; });
+    Task moved = std::move(task);
+    moved();
+    EXPECT_EQ(7, result);
+}
+
+TEST(ThreadPool, RunsAllTasks) {
+    std::atomic<int> count = 0;
+    std::latch done(1000);
+    ThreadPool pool(4);
+    for (int i = 0; i < 1000; i++) {
+        pool.Offer([&count, &done] {
+            count++;
+            done.count_down();
+        });
+    }
+    done.wait();
+    EXPECT_EQ(1000, count);
+}
+
+TEST(ThreadPool, RunsTasksConcurrently) {
+    // Each task waits for the other, so this only finishes if both
+    // run at the same time.
+    std::latch both(2);
+    std::latch done(2);
+    ThreadPool pool(2);
+    for (int i = 0; i < 2; i++) {
+        pool.Offer([&both, &done] {
+            both.arrive_and_wait();
+            done.count_down();
+        });
+    }
+    done.wait();
+}
+
+TEST(ThreadPool, TasksOfferedFromWorkers) {
+    // The first task blocks its worker, so the tasks it offers to its
+    // own queue have to be stolen by the other worker.
+    std::latch done(10);
+    std::latch release(1);
+    ThreadPool pool(2);
+    pool.Offer([&pool, &done, &release] {
+        for (int i = 0; i < 10; i++) {
+            pool.Offer([&done] { done.count_down(); });
+        }
+        done.wait();
+        release.count_down();
+    });
+    release.wait();
+}
+
+}  // namespace gabby
@@ -0,0 +1,87 @@
+#include "utils/timer_wheel.h"
+
+#include <algorithm>
+
+namespace gabby {
+
+void TimerWheel::Schedule(Timer* timer, Clock::time_point deadline) {
+    Cancel(timer);
+    // round up, so that timers never expire early
+    uint64_t expiry = 0;
+    if (deadline > start_) {
+        auto since = deadline - start_;
+        expiry = since / tick_ + (since % tick_ != Clock::duration::zero());
+    }
+    uint64_t max = now_ + (uint64_t(1) << (kBits * kLevels)) - 1;
+    timer->expiry = std::clamp(expiry, now_ + 1, max);
+    Insert(timer);
+    size_++;
+}
+
+void TimerWheel::Cancel(Timer* timer) {
+    if (!timer->scheduled()) return;
+    Unlink(timer);
+}
+
+void TimerWheel::Insert(Timer* timer) {
+    uint64_t delta = timer->expiry - now_;
+    int level = 0;
+    while (level < kLevels - 1 &&
+           delta >= uint64_t(1) << (kBits * (level + 1))) {
+        level++;
+    }
+    int slot = (timer->expiry >> (kBits * level)) & kMask;
+    Timer*& head = slots_[level][slot];
+    timer->next = head;
+    if (head != nullptr) head->pprev = &timer->next;
+    head = timer;
+    timer->pprev = &head;
+    timer->level = level;
+    timer->slot = slot;
+    occupied_[level] |= uint64_t(1) << slot;
+}
+
+void TimerWheel::Unlink(Timer* timer) {
+    *timer->pprev = timer->next;
+    if (timer->next != nullptr) timer->next->pprev = timer->pprev;
+    if (slots_[timer->level][timer->slot] == nullptr) {
+        occupied_[timer->level] &= ~(uint64_t(1) << timer->slot);
+    }
+    timer->next = nullptr;
+    timer->pprev = nullptr;
+    size_--;
+}
+
+void TimerWheel::Cascade(int level) {
+    if (level >= kLevels) return;
+    int slot = (now_ >> (kBits * level)) & kMask;
+    // the level above wraps around at the same time
+    if (slot == 0) Cascade(level + 1);
+    Timer* timer = slots_[level][slot];
+    slots_[level][slot] = nullptr;
+    occupied_[level] &= ~(uint64_t(1) << slot);
+    while (timer != nullptr) {
+        Timer* next = timer->next;
+        Insert(timer);
+        timer = next;
+    }
+}
+
+std::optional<TimerWheel::Clock::time_point> TimerWheel::NextExpiry() const {
+    std::optional<uint64_t> next;
+    if (occupied_[0] != 0) {
+        // the first occupied slot after the current one
+        int from = (now_ + 1) & kMask;
+        next = now_ + 1 + std::countr_zero(std::rotr(occupied_[0], from));
+    }
+    for (int level = 1; level < kLevels; level++) {
+        if (occupied_[level] == 0) continue;
+        uint64_t cascade = (now_ | kMask) + 1;
+        next = std::min(next.value_or(cascade), cascade);
+        break;
+    }
+    if (!next.has_value()) return std::nullopt;
+    return start_ + *next * tick_;
+}
+
+}  // namespace gabby
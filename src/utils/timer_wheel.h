@@ -0,0 +1,121 @@
+#ifndef GABBY_UTILS_TIMER_WHEEL_H_
+#define GABBY_UTILS_TIMER_WHEEL_H_
+
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+namespace gabby {
+
+// a hierarchical timer wheel. timers are intrusive, so scheduling and
+// cancelling them is O(1) and never allocates, which keeps deadlines
+// cheap with tens of thousands of connections.
+//
+// there are four levels of 64 slots each. a timer goes into the level
+// whose span covers its deadline, and is moved down a level as that
+// level's slot comes around, until it expires from the first level.
+// deadlines are rounded up to the next tick, and ones further out than
+// 64^4 ticks (about 4.6 hours at 1ms) are clamped.
+//
+// not thread-safe.
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // embed one of these in anything that needs a deadline. it must not
+    // be moved or destroyed while it's scheduled.
+    struct Timer {
+        Timer() = default;
+        Timer(const Timer&) {}
+        Timer& operator=(const Timer&) { return *this; }
+
+        bool scheduled() const { return pprev != nullptr; }
+
+        // for the owner to find itself when the timer expires
+        void* owner = nullptr;
+
+    private:
+        friend class TimerWheel;
+        Timer* next = nullptr;
+        Timer** pprev = nullptr;
+        uint64_t expiry = 0;
+        uint8_t level = 0;
+        uint8_t slot = 0;
+    };
+
+    explicit TimerWheel(Clock::duration tick = std::chrono::milliseconds(1),
+                        Clock::time_point now = Clock::now())
+        : tick_(tick), start_(now) {}
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    // schedules |timer| to expire at |deadline|, rescheduling it if it
+    // was already scheduled
+    void Schedule(Timer* timer, Clock::time_point deadline);
+
+    // unschedules |timer|, if it's scheduled
+    void Cancel(Timer* timer);
+
+    // advances the wheel to |now| and calls |expire| with each timer
+    // that's due, after unscheduling it. |expire| may schedule and
+    // cancel timers.
+    template <typename F>
+    void Advance(Clock::time_point now, F&& expire);
+
+    // when the next timer might be due, if any are scheduled. waking up
+    // then and calling Advance is enough to expire every timer on time.
+    std::optional<Clock::time_point> NextExpiry() const;
+
+    size_t size() const { return size_; }
+
+private:
+    static constexpr int kLevels = 4;
+    static constexpr int kBits = 6;
+    static constexpr uint64_t kSlots = 1 << kBits;
+    static constexpr uint64_t kMask = kSlots - 1;
+
+    void Insert(Timer* timer);
+    void Unlink(Timer* timer);
+
+    // moves the timers in the current slot of |level| down a level
+    void Cascade(int level);
+
+    Clock::duration tick_;
+    Clock::time_point start_;
+    uint64_t now_ = 0;  // in ticks since |start_|
+    size_t size_ = 0;
+    std::array<std::array<Timer*, kSlots>, kLevels> slots_{};
+    // a bit per slot, set when it isn't empty
+    std::array<uint64_t, kLevels> occupied_{};
+};
+
+template <typename F>
+void TimerWheel::Advance(Clock::time_point now, F&& expire) {
+    if (now < start_) return;
+    uint64_t target = (now - start_) / tick_;
+    while (now_ < target) {
+        // nothing is due before the next cascade, so skip ahead
+        if (occupied_[0] == 0) {
+            uint64_t last = now_ | kMask;
+            if (last >= target) {
+                now_ = target;
+                break;
+            }
+            now_ = last;
+        }
+        now_++;
+        if ((now_ & kMask) == 0) Cascade(1);
+        size_t slot = now_ & kMask;
+        while (Timer* timer = slots_[0][slot]) {
+            Unlink(timer);
+            expire(timer);
+        }
+    }
+}
+
+}  // namespace gabby
+
+#endif  // GABBY_UTILS_TIMER_WHEEL_H_
@@ -0,0 +1,85 @@
+#include <chrono>
+#include <cstdint>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "test/bench.h"
+#include "utils/timer_wheel.h"
+
+namespace gabby {
+
+namespace {
+
+using Clock = TimerWheel::Clock;
+
+// enough open connections to make a busy server
+constexpr int kConnections = 50'000;
+
+// spreads deadlines over the next ten seconds
+std::chrono::milliseconds RandomTimeout(uint64_t* x) {
+    *x ^= *x << 13;
+    *x ^= *x >> 7;
+    *x ^= *x << 17;
+    return std::chrono::milliseconds(*x % 10'000);
+}
+
+}  // namespace
+
+// what the event loop used before, as a baseline. moving a deadline
+// means finding and erasing the old entry in the tree.
+BENCHMARK(TimerWheel, LegacySetReschedule) {
+    auto now = Clock::now();
+    uint64_t x = 0x9e3779b97f4a7c15;
+    std::set<std::pair<Clock::time_point, int>> deadlines;
+    std::vector<Clock::time_point> conns(kConnections);
+    for (int i = 0; i < kConnections; i++) {
+        conns[i] = now + RandomTimeout(&x);
+        deadlines.emplace(conns[i], i);
+    }
+    int i = 0;
+    while (state.KeepRunning()) {
+        deadlines.erase({conns[i], i});
+        conns[i] = now + RandomTimeout(&x);
+        deadlines.emplace(conns[i], i);
+        i = (i + 1) % kConnections;
+    }
+    DoNotOptimize(deadlines.size());
+}
+
+BENCHMARK(TimerWheel, Reschedule) {
+    auto now = Clock::now();
+    uint64_t x = 0x9e3779b97f4a7c15;
+    TimerWheel wheel(std::chrono::milliseconds(1), now);
+    std::vector<TimerWheel::Timer> timers(kConnections);
+    for (auto& timer : timers) wheel.Schedule(&timer, now + RandomTimeout(&x));
+    int i = 0;
+    while (state.KeepRunning()) {
+        wheel.Schedule(&timers[i], now + RandomTimeout(&x));
+        i = (i + 1) % kConnections;
+    }
+    DoNotOptimize(wheel.size());
+}
+
+// every connection's deadline passing, a millisecond at a time, which
+// is the worst case for how often the loop wakes up
+BENCHMARK(TimerWheel, ExpireAll) {
+    uint64_t x = 0x9e3779b97f4a7c15;
+    std::vector<TimerWheel::Timer> timers(kConnections);
+    int64_t expired = 0;
+    while (state.KeepRunning()) {
+        auto now = Clock::now();
+        TimerWheel wheel(std::chrono::milliseconds(1), now);
+        for (auto& timer : timers) {
+            wheel.Schedule(&timer, now + RandomTimeout(&x));
+        }
+        for (int ms = 1; ms <= 10'000; ms++) {
+            wheel.Advance(now + std::chrono::milliseconds(ms),
+                          [&expired](TimerWheel::Timer*) { expired++; });
+        }
+    }
+    DoNotOptimize(expired);
+    state.counters["ns/timer"] = state.nanos_per_iteration() / kConnections;
+}
+
+}  // namespace gabby
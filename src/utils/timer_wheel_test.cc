@@ -0,0 +1,137 @@
+#include "utils/timer_wheel.h"
+
+#include <chrono>
+#include <vector>
+
+#include "test/test.h"
+
+namespace gabby {
+
+namespace {
+
+using std::chrono::milliseconds;
+using Clock = TimerWheel::Clock;
+
+// advances |wheel| to |now| and returns the ids of the expired timers
+std::vector<int> Expire(TimerWheel& wheel, Clock::time_point now) {
+    std::vector<int> expired;
+    wheel.Advance(now, [&expired](TimerWheel::Timer* timer) {
+        expired.push_back(*static_cast<int*>(timer->owner));
+    });
+    return expired;
+}
+
+}  // namespace
+
+TEST(TimerWheel, ExpiresTimersAtTheirDeadlines) {
+    // Arrange
+    // Deadlines that land in each level of the wheel.
+    auto start = Clock::now();
+    TimerWheel wheel(milliseconds(1), start);
+    std::vector<int> ids = {3, 70, 5000, 300'000};
+    std::vector<TimerWheel::Timer> timers(ids.size());
+    for (size_t i = 0; i < ids.size(); i++) {
+        timers[i].owner = &ids[i];
+        wheel.Schedule(&timers[i], start + milliseconds(ids[i]));
+    }
+
+    // Act & Assert
+    // Each one should expire at its deadline and not a tick before.
+    for (int id : ids) {
+        EXPECT_EQ(0, Expire(wheel, start + milliseconds(id - 1)).size());
+        auto expired = Expire(wheel, start + milliseconds(id));
+        EXPECT_EQ(1, expired.size());
+        EXPECT_EQ(id, expired[0]);
+    }
+    EXPECT_EQ(0, wheel.size());
+}
+
+TEST(TimerWheel, ExpiresLateTimersInOneAdvance) {
+    // Arrange
+    auto start = Clock::now();
+    TimerWheel wheel(milliseconds(1), start);
+    std::vector<int> ids = {1, 64, 65, 4096, 4097, 100'000};
+    std::vector<TimerWheel::Timer> timers(ids.size());
+    for (size_t i = 0; i < ids.size(); i++) {
+        timers[i].owner = &ids[i];
+        wheel.Schedule(&timers[i], start + milliseconds(ids[i]));
+    }
+
+    // Act
+    auto expired = Expire(wheel, start + milliseconds(200'000));
+
+    // Assert
+    // They should all expire, in order.
+    EXPECT_EQ(ids.size(), expired.size());
+    for (size_t i = 0; i < ids.size() && i < expired.size(); i++) {
+        EXPECT_EQ(ids[i], expired[i]);
+    }
+}
+
+TEST(TimerWheel, CancelAndReschedule) {
+    // Arrange
+    auto start = Clock::now();
+    TimerWheel wheel(milliseconds(1), start);
+    int a = 1, b = 2;
+    TimerWheel::Timer ta, tb;
+    ta.owner = &a;
+    tb.owner = &b;
+    wheel.Schedule(&ta, start + milliseconds(10));
+    wheel.Schedule(&tb, start + milliseconds(10));
+
+    // Act
+    wheel.Cancel(&ta);
+    wheel.Schedule(&tb, start + milliseconds(1000));
+
+    // Assert
+    EXPECT_FALSE(ta.scheduled());
+    EXPECT_EQ(1, wheel.size());
+    EXPECT_EQ(0, Expire(wheel, start + milliseconds(999)).size());
+    EXPECT_EQ(1, Expire(wheel, start + milliseconds(1000)).size());
+    EXPECT_FALSE(tb.scheduled());
+}
+
+TEST(TimerWheel, NextExpiry) {
+    // Arrange
+    auto start = Clock::now();
+    TimerWheel wheel(milliseconds(1), start);
+    TimerWheel::Timer near, far;
+    bool empty = !wheel.NextExpiry().has_value();
+
+    // Act
+    wheel.Schedule(&far, start + milliseconds(10'000));
+    auto cascade = wheel.NextExpiry();
+    wheel.Schedule(&near, start + milliseconds(20));
+    auto next = wheel.NextExpiry();
+
+    // Assert
+    // With only a far away timer, the wheel needs to wake up when it
+    // next cascades timers down a level.
+    EXPECT_TRUE(empty);
+    EXPECT_TRUE(*cascade == start + milliseconds(64));
+    EXPECT_TRUE(*next == start + milliseconds(20));
+}
+
+TEST(TimerWheel, ScheduleFromCallback) {
+    // Arrange
+    auto start = Clock::now();
+    TimerWheel wheel(milliseconds(1), start);
+    TimerWheel::Timer timer;
+    int fired = 0;
+
+    // Act
+    // Each time it fires, the timer is rescheduled a tick later.
+    wheel.Schedule(&timer, start + milliseconds(1));
+    for (int i = 1; i <= 100; i++) {
+        wheel.Advance(start + milliseconds(i), [&](TimerWheel::Timer* t) {
+            fired++;
+            wheel.Schedule(t, start + milliseconds(i + 1));
+        });
+    }
+
+    // Assert
+    EXPECT_EQ(100, fired);
+    EXPECT_TRUE(timer.scheduled());
+}
+
+}  // namespace gabby